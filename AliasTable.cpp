@@ -0,0 +1,118 @@
+#include "AliasTable.h"
+
+#ifdef LEARNER_FIXED_POINT
+void alias_build_row(const prob_t* row, prob_t* keep_prob, uint8_t* alias) {
+  uint32_t sum = 0;
+  for (int i = 0; i < NUM_STATES; ++i) {
+    sum += row[i];
+  }
+
+  // Scale by NUM_STATES so the average column holds exactly `sum`, then sort
+  // the columns into those below and those at or above average. Everything
+  // stays an integer, so there is no rounding error to clean up.
+  uint32_t scaled[NUM_STATES];
+  uint8_t small[NUM_STATES];
+  uint8_t large[NUM_STATES];
+  int num_small = 0;
+  int num_large = 0;
+  for (int i = 0; i < NUM_STATES; ++i) {
+    scaled[i] = sum > 0 ? static_cast<uint32_t>(row[i]) * NUM_STATES : 1;
+    if (scaled[i] < sum) {
+      small[num_small++] = i;
+    } else {
+      large[num_large++] = i;
+    }
+  }
+  sum = sum > 0 ? sum : 1;
+
+  // Top up each small column with a piece of a large column. Normalized rows
+  // sum to exactly PROB_ONE, so the keep probability is already Q15.
+  while (num_small > 0 && num_large > 0) {
+    uint8_t s = small[--num_small];
+    uint8_t l = large[--num_large];
+    keep_prob[s] = static_cast<prob_t>(
+        sum == PROB_ONE
+            ? scaled[s]
+            : static_cast<uint64_t>(scaled[s]) * PROB_ONE / sum);
+    alias[s] = l;
+    scaled[l] = (scaled[l] + scaled[s]) - sum;
+    if (scaled[l] < sum) {
+      small[num_small++] = l;
+    } else {
+      large[num_large++] = l;
+    }
+  }
+
+  // Whatever is left is full
+  while (num_large > 0) {
+    uint8_t l = large[--num_large];
+    keep_prob[l] = PROB_ONE;
+    alias[l] = l;
+  }
+  while (num_small > 0) {
+    uint8_t s = small[--num_small];
+    keep_prob[s] = PROB_ONE;
+    alias[s] = s;
+  }
+
+  for (int i = NUM_STATES; i < LEARNER_ROW_STRIDE; ++i) {
+    keep_prob[i] = 0;
+    alias[i] = 0;
+  }
+}
+#else
+void alias_build_row(const float* row, float* keep_prob, uint8_t* alias) {
+  float sum = 0.0f;
+  for (int i = 0; i < NUM_STATES; ++i) {
+    sum += row[i];
+  }
+
+  // Scale so the average column holds exactly 1.0, then sort the columns into
+  // those below and those at or above average
+  float scaled[NUM_STATES];
+  uint8_t small[NUM_STATES];
+  uint8_t large[NUM_STATES];
+  int num_small = 0;
+  int num_large = 0;
+  float scale = sum > 0.0f ? static_cast<float>(NUM_STATES) / sum : 0.0f;
+  for (int i = 0; i < NUM_STATES; ++i) {
+    scaled[i] = sum > 0.0f ? row[i] * scale : 1.0f;
+    if (scaled[i] < 1.0f) {
+      small[num_small++] = i;
+    } else {
+      large[num_large++] = i;
+    }
+  }
+
+  // Top up each small column with a piece of a large column
+  while (num_small > 0 && num_large > 0) {
+    uint8_t s = small[--num_small];
+    uint8_t l = large[--num_large];
+    keep_prob[s] = scaled[s];
+    alias[s] = l;
+    scaled[l] = (scaled[l] + scaled[s]) - 1.0f;
+    if (scaled[l] < 1.0f) {
+      small[num_small++] = l;
+    } else {
+      large[num_large++] = l;
+    }
+  }
+
+  // Whatever is left is full up to rounding error
+  while (num_large > 0) {
+    uint8_t l = large[--num_large];
+    keep_prob[l] = 1.0f;
+    alias[l] = l;
+  }
+  while (num_small > 0) {
+    uint8_t s = small[--num_small];
+    keep_prob[s] = 1.0f;
+    alias[s] = s;
+  }
+
+  for (int i = NUM_STATES; i < LEARNER_ROW_STRIDE; ++i) {
+    keep_prob[i] = 0.0f;
+    alias[i] = 0;
+  }
+}
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+
+#include "Globals.h"
+#include "LearnerKernels.h"
+#include "StateRegistry.h"
+
+static_assert(NUM_STATES <= 256, "Alias indices are stored as uint8_t");
+
+/*
+ * Walker/Vose alias tables for drawing from one row of the probability table
+ * in O(1). A table is two padded arrays of `LEARNER_ROW_STRIDE` entries: the
+ * probability of keeping each column, and the state to use instead. Keep
+ * probabilities use the same `prob_t` format as the probability table.
+ */
+
+/**
+ * @brief Builds the alias table for a row using Vose's method in
+ * O(NUM_STATES).
+ * @param row A padded row of `LEARNER_ROW_STRIDE` probabilities. Does not
+ * need to sum to exactly `PROB_ONE`.
+ * @param keep_prob Output, the probability of keeping each column.
+ * @param alias Output, the state to use for each column when not kept.
+ */
+void alias_build_row(const prob_t* row, prob_t* keep_prob, uint8_t* alias);
+
+/**
+ * @brief Draws a state from an alias table in O(1). A single uniform sample
+ * picks both the column (integer part) and whether to keep it (fractional
+ * part).
+ * @param keep_prob The table's keep probabilities.
+ * @param alias The table's alias states.
+ * @param sample A uniform sample.
+ * @returns The drawn state.
+ */
+inline StateEnum alias_sample_row(const prob_t* keep_prob,
+                                  const uint8_t* alias, sample_t sample) {
+#ifdef LEARNER_FIXED_POINT
+  // The high 16 bits of sample * NUM_STATES are the column, and the top 15
+  // bits of the low half are the Q15 fraction
+  uint32_t scaled = static_cast<uint32_t>(sample) * NUM_STATES;
+  int col = static_cast<int>(scaled >> 16);
+  uint32_t frac = (scaled & 0xFFFF) >> 1;
+  return static_cast<StateEnum>(frac < keep_prob[col] ? col : alias[col]);
+#else
+  float scaled = sample * static_cast<float>(NUM_STATES);
+  int col = static_cast<int>(scaled);
+  col = col < NUM_STATES ? col : NUM_STATES - 1;
+  float frac = scaled - static_cast<float>(col);
+  return static_cast<StateEnum>(frac < keep_prob[col] ? col : alias[col]);
+#endif
+}
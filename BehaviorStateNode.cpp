@@ -0,0 +1,46 @@
+#include "BehaviorStateNode.h"
+
+#include "BraitenbergController.h"
+#include "VehicleContext.h"
+
+template <StateEnum State>
+void BehaviorStateNode<State>::enter(VehicleContext& ctx) {
+#ifdef PRINT_DEBUG
+  printf("Entering behavior state %d\r\n", State);
+#endif
+  // Stop the motors before we start execution of the behavior.
+  ctx.set_motor_speeds(STOP, STOP, 0.0, 0.0);
+}
+
+template <StateEnum State>
+void BehaviorStateNode<State>::execute(VehicleContext& ctx) {
+#ifdef PRINT_DEBUG
+  printf("Executing behavior state %d\r\n", State);
+#endif
+  // Map the light levels to motor speeds with this behavior's coefficients.
+  ctx.drive(BRAITENBERG_TABLE[State]);
+
+  // After minimum time in state has elapsed, then transition to new state.
+  if (ctx.get_elapsed_time_in_state() >= ctx.get_min_duration(state)) {
+    StateEnum next_state = ctx.sample_next_state();
+
+    ctx.transition_to(next_state);
+    return;
+  }
+}
+
+template <StateEnum State>
+void BehaviorStateNode<State>::exit(VehicleContext& ctx) {
+#ifdef PRINT_DEBUG
+  printf("Exiting behavior state %d\r\n", State);
+#endif
+  // Stop the motors before a transition to another state.
+  ctx.set_motor_speeds(STOP, STOP, 0.0, 0.0);
+}
+
+// One instantiation per behavior in VEHICLE_STATES
+#define SKIP_STATE(name, Node)
+#define INSTANTIATE_BEHAVIOR(name) template class BehaviorStateNode<name>;
+VEHICLE_STATES(SKIP_STATE, INSTANTIATE_BEHAVIOR)
+#undef SKIP_STATE
+#undef INSTANTIATE_BEHAVIOR
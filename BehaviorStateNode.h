@@ -0,0 +1,42 @@
+#pragma once
+
+#include "StateNode.h"
+
+/**
+ * @brief A state that drives the motors with the Braitenberg controller, using
+ * the row of `BRAITENBERG_TABLE` for `State`.
+ * @note Defined in BehaviorStateNode.cpp, which instantiates it for every
+ * `BEHAVIOR` in `VEHICLE_STATES`.
+ */
+template <StateEnum State>
+class BehaviorStateNode : public StateNode {
+ public:
+  /**
+   * @brief Entry procedure for the behavior.
+   * Stops the motors before entering main procedure.
+   */
+  void enter(VehicleContext& ctx);
+
+  /**
+   * @brief Main procedure for the behavior.
+   * Executed every FSM tick. Drives the motors from the light levels, then
+   * transitions once the minimum time in state has elapsed.
+   */
+  void execute(VehicleContext& ctx);
+
+  /**
+   * @brief Exit procedure for the behavior.
+   * Stops the motors before any state transitions occur.
+   */
+  void exit(VehicleContext& ctx);
+
+  /**
+   * The state enum for the behavior.
+   */
+  static constexpr StateEnum state = State;
+
+  /**
+   * The minimum time spent in the behavior before transitioning.
+   */
+  static constexpr vehicle_duration min_duration = 5000ms;
+};
@@ -0,0 +1,28 @@
+#include "BraitenbergController.h"
+
+const std::array<BraitenbergCoeffs, NUM_STATES> BRAITENBERG_TABLE = {{
+    // IDLE: motors stay stopped
+    {{{0.0f, 0.0f}, {0.0f, 0.0f}}, {0.0f, 0.0f}, 0.0f},
+    // COWARD: each side speeds up with its own LDR, running away from light
+    // and speeding up the brighter it is
+    {{{1.0f, 0.0f}, {0.0f, 1.0f}}, {0.0f, 0.0f}, 1.0f},
+    // AGGRESSIVE: each side speeds up with the opposite LDR, running towards
+    // light and speeding up the brighter it is
+    {{{0.0f, 1.0f}, {1.0f, 0.0f}}, {0.0f, 0.0f}, 1.0f},
+    // LOVE: each side slows down with the opposite LDR, running towards light
+    // and slowing down the brighter it is
+    {{{0.0f, -1.0f}, {-1.0f, 0.0f}}, {1.0f, 1.0f}, 1.0f},
+    // EXPLORER: each side slows down with its own LDR, running away from light
+    // and slowing down the brighter it is
+    {{{-1.0f, 0.0f}, {0.0f, -1.0f}}, {1.0f, 1.0f}, 1.0f},
+}};
+
+void braitenberg_compute_batch(const StateEnum* states,
+                               const LightLevels* lvls, size_t count,
+                               float* __restrict pwm_l,
+                               float* __restrict pwm_r) {
+  for (size_t i = 0; i < count; ++i) {
+    braitenberg_compute(BRAITENBERG_TABLE[states[i]], lvls[i], &pwm_l[i],
+                        &pwm_r[i]);
+  }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <array>
+#include <cstddef>
+
+#include "Globals.h"
+#include "StateRegistry.h"
+
+/**
+ * @brief Coefficients of an affine map from the light levels to the motors:
+ * `pwm = bias + max_speed * (gain * lvls)` for each motor.
+ * @param gain The sensor-to-motor matrix, indexed `[motor][sensor]` where 0 is
+ * left and 1 is right.
+ * @param bias The output of each motor in the dark.
+ * @param max_speed Scales the contribution of the light levels.
+ */
+struct BraitenbergCoeffs {
+  float gain[2][2];
+  float bias[2];
+  float max_speed;
+};
+
+/**
+ * @brief The coefficients of every state, indexed by `StateEnum`. States that
+ * don't drive the motors (IDLE) have all-zero coefficients. New behaviors only
+ * need a row here and a `BEHAVIOR` in `VEHICLE_STATES`.
+ */
+extern const std::array<BraitenbergCoeffs, NUM_STATES> BRAITENBERG_TABLE;
+
+/**
+ * @brief Computes the motor outputs of one vehicle.
+ * @param coeffs The coefficients of the vehicle's state.
+ * @param lvls The normalized light levels of the vehicle.
+ * @param pwm_l Output, the left motor's PWM duty cycle. Negative means reverse.
+ * @param pwm_r Output, the right motor's PWM duty cycle. Negative means
+ * reverse.
+ */
+inline void braitenberg_compute(const BraitenbergCoeffs& coeffs,
+                                LightLevels lvls, float* pwm_l, float* pwm_r) {
+  *pwm_l = coeffs.bias[0] +
+           coeffs.max_speed * (coeffs.gain[0][0] * lvls.lvl_left +
+                               coeffs.gain[0][1] * lvls.lvl_right);
+  *pwm_r = coeffs.bias[1] +
+           coeffs.max_speed * (coeffs.gain[1][0] * lvls.lvl_left +
+                               coeffs.gain[1][1] * lvls.lvl_right);
+}
+
+/**
+ * @brief Computes the motor outputs of a batch of vehicles, looking up the
+ * coefficients of each vehicle's state in `BRAITENBERG_TABLE`. The loop has
+ * no branches, so it vectorizes (with gathers) on hosts built with `-O3
+ * -mavx2`.
+ * @param states The current state of each vehicle.
+ * @param lvls The normalized light levels of each vehicle.
+ * @param count The number of vehicles.
+ * @param pwm_l Output, the left motor's PWM duty cycle of each vehicle.
+ * @param pwm_r Output, the right motor's PWM duty cycle of each vehicle.
+ */
+void braitenberg_compute_batch(const StateEnum* states,
+                               const LightLevels* lvls, size_t count,
+                               float* pwm_l, float* pwm_r);
+
+/**
+ * @returns The direction to drive a motor in for a signed PWM duty cycle.
+ */
+inline Direction braitenberg_direction(float pwm) {
+  return pwm < 0.0f ? REVERSE : FORWARD;
+}
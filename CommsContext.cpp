@@ -1,81 +1,156 @@
 #include "CommsContext.h"
 
-CommsContext::CommsContext(PinName nrf_mosi, PinName nrf_miso, PinName nrf_sck,
-                           PinName nrf_ncs, PinName nrf_ce, nrf_address addr_tx,
-                           nrf_address addr_rx)
-    : nrf(nrf_mosi, nrf_miso, nrf_sck, nrf_ncs, nrf_ce) {
-  // When the context is created, set up and enable the transceiver.
-  nrf.powerUp();
-  nrf.setTxAddress(addr_tx);
-  nrf.setRxAddress(addr_rx);
-  nrf.setTransferSize(MSG_SIZE);
-  nrf.setReceiveMode();
-  nrf.disableAutoAcknowledge();
-  nrf.enable();
+#include "WireCodec.h"
+
+CommsContext::CommsContext(RadioInterface &radio, ClockInterface &clock,
+                           uint16_t sender_id)
+    : m_radio(radio),
+      m_clock(clock),
+      m_irq_driven(false),
+      m_sender_id(sender_id),
+      m_tx_seq(0),
+      m_tx_payload_pending(false) {
+  m_irq_driven =
+      m_radio.attach_irq(callback(this, &CommsContext::on_radio_irq));
+
+  // A payload may have arrived before the handler was attached, in which
+  // case the falling edge was missed, so check the transceiver once.
+  m_flags.set(FLAG_RADIO_IRQ);
 }
 
-void CommsContext::run_comms_cycle(void) {
-  // Read from the transceiver if available.
-  if (nrf.readable()) {
+bool CommsContext::run_comms_cycle(void) {
+  ProfileScope profile(m_profiler, PROFILE_COMMS_CYCLE);
+
+  // Drain the transceiver first. Its RX FIFO only holds a few payloads, so
+  // anything left there is lost as soon as more arrive. The burst is bounded
+  // so a steady stream of incoming payloads can't starve transmission.
+  int num_read = 0;
+  while (num_read < RX_BURST && m_radio.readable()) {
     char buffer[MSG_SIZE];
-    nrf.read(NRF24L01P_PIPE_P0, buffer, MSG_SIZE);
-    CommsMsg *msg = mail_incoming.try_alloc();
+    m_radio.read(buffer, MSG_SIZE);
+    ++num_read;
+    if (m_recorder != nullptr) {
+      m_recorder->record_rx(m_clock.now(), buffer);
+    }
 
-    // If the buffer is full (a nullptr was returned), just discard the message.
-    if (msg == nullptr) {
-      return;
+    // Decode the records straight out of the buffer.
+    WireView view(buffer);
+    if (!view.is_valid()) {
+      ++m_num_rx_invalid;
+      continue;
     }
 
-    // Otherwise, copy it over to the memory block and push to incoming mail
-    // queue for consumption later.
-    memcpy(msg, buffer, MSG_SIZE);
-    mail_incoming.put(msg);
-  } else {
-    // Otherwise, attempt to transmit any message requests.
-    CommsMsg *msg = mail_outgoing.try_get();
-    if (msg == nullptr) {
-      return;
+    // Our own broadcasts can't normally come back, but ignore them if they do.
+    if (view.get_sender_id() == m_sender_id) {
+      continue;
     }
+    m_neighbors.update(view.get_sender_id(), view.get_seq());
+    m_num_neighbors = m_neighbors.get_count();
+
+    // Fold every report into the influence summary straight away, so none
+    // of them wait in a queue to go stale.
+    vehicle_duration now = m_clock.now();
+    for (int i = 0; i < view.get_count(); ++i) {
+      CommsMsg msg = view.get_record(i);
+      float ldr_l_delta = msg.curr_lvls.lvl_left - msg.prev_lvls.lvl_left;
+      float ldr_r_delta = msg.curr_lvls.lvl_right - msg.prev_lvls.lvl_right;
+      float ldr_delta_avg = (ldr_l_delta + ldr_r_delta) / 2.0f;
+      m_influence.add(msg.prev_state, ldr_delta_avg, now);
 
-    int bytes_written = nrf.write(NRF24L01P_PIPE_P0, (char *)msg, MSG_SIZE);
+      if (m_trace != nullptr) {
+        m_trace->record(TRACE_MSG_RECEIVED, msg.prev_state, msg.sender_id,
+                        trace_value(ldr_delta_avg));
+      }
+    }
+    m_num_rx_reports += view.get_count();
+  }
+
+  // Then transmit a bounded burst of payloads, each packing as many message
+  // requests as fit.
+  int num_written = 0;
+  while (num_written < TX_BURST) {
+    if (!m_tx_payload_pending) {
+      WireEncoder encoder(m_tx_payload, m_sender_id, m_tx_seq);
+      while (!encoder.is_full()) {
+        const CommsMsg *msg = mail_outgoing.try_borrow();
+        if (msg == nullptr) {
+          break;
+        }
+        encoder.add(*msg);
+        mail_outgoing.release();
+      }
+      if (encoder.get_count() == 0) {
+        break;
+      }
+      ++m_tx_seq;
+      m_tx_payload_pending = true;
+    }
+
+    int bytes_written =
+        m_radio.write(m_tx_payload, MSG_SIZE, RADIO_BROADCAST_ID);
 #ifdef PRINT_DEBUG
     printf("Bytes written: %d\r\n", bytes_written);
 #endif
 
-    // If we fail to send the message, queue it for a re-attempt, otherwise
-    // remove the transmission request from queue.
+    // If we fail to send the payload, keep it for a re-attempt next cycle.
     if (bytes_written < MSG_SIZE) {
-      mail_outgoing.put(msg);
-    } else {
-      mail_outgoing.free(msg);
+      break;
     }
+    m_tx_payload_pending = false;
+    ++num_written;
   }
+
+  return num_read > 0 || num_written > 0;
 }
 
-bool CommsContext::try_queue_send(const CommsMsg msg_vals) {
-  // Only attempt to add a transmission request to the queue if the
-  // queue is not full.
-  CommsMsg *msg = mail_outgoing.try_alloc();
-  if (msg == nullptr) {
-    return false;
-  }
+void CommsContext::wait_for_activity(vehicle_duration timeout) {
+  m_flags.wait_any_for(FLAG_RADIO_IRQ | FLAG_TX_QUEUED, timeout);
+}
 
-  memcpy(msg, &msg_vals, MSG_SIZE);
-  mail_outgoing.put(msg);
+void CommsContext::set_trace(TraceRecorder *trace) { m_trace = trace; }
 
-  return true;
+void CommsContext::set_recorder(RunRecorder *recorder) {
+  m_recorder = recorder;
 }
 
-bool CommsContext::try_read(CommsMsg *out) {
-  // Only return a message if there is one to get from the queue.
-  CommsMsg *read_msg = mail_incoming.try_get();
-  if (read_msg == nullptr) {
-    out = nullptr;
+void CommsContext::set_profiler(Profiler *profiler) { m_profiler = profiler; }
+
+bool CommsContext::is_irq_driven(void) const { return m_irq_driven; }
+
+uint32_t CommsContext::get_num_rx_reports(void) const {
+  return m_num_rx_reports;
+}
+
+uint32_t CommsContext::get_num_tx_dropped(void) const {
+  return m_num_tx_dropped;
+}
+
+uint32_t CommsContext::get_num_rx_invalid(void) const {
+  return m_num_rx_invalid;
+}
+
+int CommsContext::get_num_neighbors(void) const { return m_num_neighbors; }
+
+const NeighborTable &CommsContext::get_neighbors(void) const {
+  return m_neighbors;
+}
+
+void CommsContext::on_radio_irq(void) { m_flags.set(FLAG_RADIO_IRQ); }
+
+bool CommsContext::try_queue_send(const CommsMsg msg) {
+  // Only attempt to add a transmission request to the queue if the
+  // queue is not full.
+  if (!mail_outgoing.try_push(msg)) {
+    ++m_num_tx_dropped;
     return false;
   }
 
-  memcpy(out, read_msg, MSG_SIZE);
-  mail_incoming.free(read_msg);
+  // Wake the comms thread to transmit it.
+  m_flags.set(FLAG_TX_QUEUED);
 
   return true;
 }
+
+bool CommsContext::try_read_influence(InfluenceSummary &out) const {
+  return m_influence.try_snapshot(m_clock.now(), out);
+}
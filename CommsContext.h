@@ -1,56 +1,169 @@
 #pragma once
-#include "Globals.h"
-#include "nRF24L01P.h"
+#include <atomic>
+#include <cstdint>
 
-using nrf_address = unsigned long long;
+#include "Globals.h"
+#include "HalInterfaces.h"
+#include "InfluenceAggregator.h"
+#include "NeighborTable.h"
+#include "Profiler.h"
+#include "RunRecorder.h"
+#include "SpscRing.h"
+#include "TraceRecorder.h"
 
 /**
- * @brief Main context class for communication using
- * nRF24L01P RF transceiver. Sets up mailboxes for incoming
- * and outgoing messages.
- * @note `addr_tx` and `addr_rx` must be different from each other.
- * @note `addr_tx` and `addr_rx` must be inverse pairs between the two vehicles.
+ * @brief Main context class for communication using an RF transceiver
+ * (nRF24L01P on the vehicle). Sets up a lock-free queue for outgoing messages
+ * and packs them into radio payloads with the codec in WireCodec.h. Incoming
+ * reports are folded into an `InfluenceAggregator` as they are received.
+ * Payloads are broadcast to every vehicle in range, and the senders of
+ * received payloads are tracked in a `NeighborTable`.
  */
 class CommsContext {
  public:
   /**
-   * @brief Constructor for communication context class.
-   * @param nrf_mosi SPI MOSI pin for the transceiver.
-   * @param nrf_miso SPI MISO pin for the transceiver.
-   * @param nrf_sck SPI SCK (clock) pin for the transceiver.
-   * @param nrf_ncs SPI NCS (chip select) pin for the transceiver.
-   * @param nrf_ce SPI CE (chip enable) pin for the transceiver.
-   * @param addr_tx Hexidecimal representation of transmission address from
-   * `0x0000000000` - `0xffffffffff`.
-   * @param addr_rx Hexidecimal representation of receiving address from
-   * `0x0000000000` - `0xffffffffff`.
+   * @brief Constructor for communication context class. Attaches to the
+   * transceiver's interrupt line if it has one.
+   * @param radio The configured transceiver to send and receive messages with.
+   * @param clock The clock used to age incoming reports.
+   * @param sender_id The ID of this vehicle, sent with every payload.
+   */
+  CommsContext(RadioInterface &radio, ClockInterface &clock,
+               uint16_t sender_id);
+
+  /**
+   * @brief Is called every communication "tick". Drains up to `RX_BURST`
+   * payloads from the transceiver, then transmits up to `TX_BURST` payloads,
+   * each packing as many queued messages as fit. Calling it repeatedly
+   * alternates between the two, so neither direction starves the other.
+   * @returns `true` if a payload was read or transmitted, so there may be
+   * more work to do, otherwise `false`.
+   */
+  bool run_comms_cycle(void);
+
+  /**
+   * @brief Blocks until the transceiver's interrupt fires, a message is
+   * queued with `try_queue_send`, or `timeout` passes. Call
+   * `run_comms_cycle` until it returns `false` afterwards.
+   * @param timeout The longest time to block for. Without an interrupt line
+   * this is the polling period.
+   */
+  void wait_for_activity(vehicle_duration timeout);
+
+  /**
+   * @brief Records received reports to `trace` from now on.
+   * @param trace The recorder for the comms thread, or `nullptr` to stop
+   * tracing.
+   */
+  void set_trace(TraceRecorder *trace);
+
+  /**
+   * @brief Records every received payload to `recorder` from now on, stamped
+   * with when it was read.
+   * @param recorder The recorder for the comms thread, or `nullptr` to stop
+   * recording.
+   */
+  void set_recorder(RunRecorder *recorder);
+
+  /**
+   * @brief Times `run_comms_cycle` into `profiler` from now on.
+   * @param profiler The profiler, or `nullptr` to stop profiling.
+   */
+  void set_profiler(Profiler *profiler);
+
+  /**
+   * @returns `true` if the transceiver's interrupt line wakes
+   * `wait_for_activity`, otherwise it has to be polled.
    */
-  CommsContext(PinName nrf_mosi, PinName nrf_miso, PinName nrf_sck,
-               PinName nrf_ncs, PinName nrf_ce, nrf_address addr_tx,
-               nrf_address addr_rx);
+  bool is_irq_driven(void) const;
 
   /**
-   * @brief Is called every communication "tick".
+   * @returns The number of reports received and added to the influence
+   * summary.
    */
-  void run_comms_cycle(void);
+  uint32_t get_num_rx_reports(void) const;
+
+  /**
+   * @returns The number of `try_queue_send` calls that failed because
+   * outgoing mail was full.
+   */
+  uint32_t get_num_tx_dropped(void) const;
+
+  /**
+   * @returns The number of received payloads discarded because they couldn't
+   * be decoded.
+   */
+  uint32_t get_num_rx_invalid(void) const;
+
+  /**
+   * @returns The number of other vehicles in the neighbor table.
+   */
+  int get_num_neighbors(void) const;
+
+  /**
+   * @returns The vehicles heard on the radio.
+   * @note Only safe to use from the thread calling `run_comms_cycle`.
+   */
+  const NeighborTable &get_neighbors(void) const;
 
   /**
    * @brief Attempts to queue a `CommsMsg` in outbound mail for transmission.
+   * @note Only call from one thread (the FSM's).
    * @param msg A `CommsMsg` to queue.
    * @returns `true` if the message was queued, otherwise `false`.
    */
   bool try_queue_send(const CommsMsg msg);
 
   /**
-   * @brief Attempts to read from incoming mail and write to a `CommsMsg`
-   * pointer.
-   * @param out A pointer to a `CommsMsg`.
-   * @returns `true` if a message was read, otherwise `false`.
+   * @brief Reads the summary of all reports received so far, decayed to the
+   * current time.
+   * @note Only call from one thread (the FSM's).
+   * @param out Written with the summary.
+   * @returns `true` if `out` was written, or `false` if the comms thread was
+   * busy updating it. Try again at the next transition.
    */
-  bool try_read(CommsMsg *out);
+  bool try_read_influence(InfluenceSummary &out) const;
 
  private:
-  Mail<CommsMsg, MAIL_SIZE> mail_incoming;
-  Mail<CommsMsg, MAIL_SIZE> mail_outgoing;
-  nRF24L01P nrf;
+  // Flags for waking `wait_for_activity`
+  static constexpr uint32_t FLAG_RADIO_IRQ = 1 << 0;
+  static constexpr uint32_t FLAG_TX_QUEUED = 1 << 1;
+
+  // Payloads handled in each direction per cycle. The nRF24L01P RX FIFO holds
+  // 3 payloads.
+  static constexpr int RX_BURST = 3;
+  static constexpr int TX_BURST = 4;
+
+  // Produced by the FSM thread and consumed by the comms thread
+  SpscRing<CommsMsg, MAIL_SIZE> mail_outgoing;
+  InfluenceAggregator m_influence;
+  RadioInterface &m_radio;
+  ClockInterface &m_clock;
+  EventFlags m_flags;
+  bool m_irq_driven;
+  TraceRecorder *m_trace = nullptr;
+  Profiler *m_profiler = nullptr;
+  RunRecorder *m_recorder = nullptr;
+  const uint16_t m_sender_id;
+
+  // Sequence number of the next payload, and a payload that failed to
+  // transmit, kept for a re-attempt
+  uint16_t m_tx_seq;
+  char m_tx_payload[MSG_SIZE];
+  bool m_tx_payload_pending;
+
+  // Counters, each written by one thread and read by any
+  std::atomic<uint32_t> m_num_rx_reports{0};
+  std::atomic<uint32_t> m_num_tx_dropped{0};
+  std::atomic<uint32_t> m_num_rx_invalid{0};
+
+  // Vehicles heard on the radio, and their count for other threads
+  NeighborTable m_neighbors;
+  std::atomic<int> m_num_neighbors{0};
+
+  /**
+   * @brief Interrupt handler for the transceiver. Only wakes the comms
+   * thread, which does the SPI transfers.
+   */
+  void on_radio_irq(void);
 };
@@ -1,33 +1,68 @@
 #pragma once
-#include "mbed.h"
+#include <chrono>
 
-#ifndef NUM_STATES
-// The maximum number of states.
-#define NUM_STATES 5
-#endif
+#include "Platform.h"
 
 #ifndef MAIL_SIZE
 // The max size for a mail queue for transmission requests and incoming
-// messages.
+// messages. Must be a power of two.
 #define MAIL_SIZE 16
 #endif
 
+#ifndef MAX_NEIGHBORS
+// The max number of other vehicles tracked in the neighbor table.
+#define MAX_NEIGHBORS 16
+#endif
+
+#ifndef TRACE_RING_SIZE
+// The number of records each trace recorder holds until they are drained.
+// Must be a power of two.
+#define TRACE_RING_SIZE 256
+#endif
+
+#ifndef RUN_RING_SIZE
+// The number of records each run recorder holds until they are drained. Must
+// be a power of two.
+#define RUN_RING_SIZE 128
+#endif
+
 #ifndef MSG_SIZE
-// The size of a message in bytes.
+// The size of a radio payload in bytes (the nRF24L01P maximum).
 #define MSG_SIZE 32
 #endif
 
 /**
- * @brief Enum for possible states. Underlying type set to
- * `uint8_t` for proper packing of message struct.
+ * @brief Millisecond duration used for all FSM timing. Kept independent of
+ * `Kernel::Clock` so that the FSM can be driven by a simulated clock.
+ */
+using vehicle_duration = std::chrono::milliseconds;
+
+/**
+ * @brief The states of the vehicle, in order. This is the only list of
+ * states: `StateEnum`, `VehicleStates` in StateRegistry.h and the
+ * instantiations of `BehaviorStateNode` are all generated from it.
+ * `STATE(name, Node)` is a state with its own class, and `BEHAVIOR(name)` is
+ * a `BehaviorStateNode` that only maps the light levels to the motors with
+ * its row of `BRAITENBERG_TABLE`.
+ */
+#define VEHICLE_STATES(STATE, BEHAVIOR) \
+  STATE(IDLE, IdleStateNode)            \
+  BEHAVIOR(COWARD)                      \
+  BEHAVIOR(AGGRESSIVE)                  \
+  BEHAVIOR(LOVE)                        \
+  BEHAVIOR(EXPLORER)
+
+/**
+ * @brief Enum for possible states, in `VEHICLE_STATES` order. Underlying type
+ * set to `uint8_t` for proper packing of message struct.
  */
+#define STATE_ENUM_ENTRY(name, Node) name,
+#define BEHAVIOR_ENUM_ENTRY(name) name,
 enum StateEnum : uint8_t {
-  IDLE = 0,
-  COWARD,
-  AGGRESSIVE,
-  LOVE,
-  EXPLORER,
+  VEHICLE_STATES(STATE_ENUM_ENTRY, BEHAVIOR_ENUM_ENTRY)
 };
+#undef STATE_ENUM_ENTRY
+#undef BEHAVIOR_ENUM_ENTRY
 
 /**
  * @brief Struct to store light levels from LDR sensors.
@@ -48,23 +83,21 @@ enum Direction {
   STOP,
 };
 
-#pragma pack(push, 1)
 /**
  * @brief Struct to store a message, either received or transmitted.
- * @note Packed using `#pragma pack`, guaranteeing a 32-byte struct.
+ * @note Several messages are packed into each radio payload by the codec in
+ * WireCodec.h, which quantizes the light levels to 8 bits.
  * @param prev_lvls A `LightLevels` struct containing light levels before
  * entering `prev_state`.
  * @param curr_lvls A `LightLevels` struct containing light levels after exiting
  * `prev_state`.
  * @param prev_state The `StateEnum` representing what state the vehicle was
  * previously in.
- * @param padding A 15-byte array for padding. Do not write data to this as
- * it'll be ignored.
+ * @param sender_id The ID of the sending vehicle. Filled in on receipt.
  */
 struct CommsMsg {
   LightLevels prev_lvls;
   LightLevels curr_lvls;
   StateEnum prev_state;
-  uint8_t padding[15] = {0};
+  uint16_t sender_id;
 };
-#pragma pack(pop)
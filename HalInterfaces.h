@@ -0,0 +1,160 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "Globals.h"
+
+/**
+ * @brief Interface for the pair of light dependent resistors (LDRs).
+ * @note Implemented by `MbedLightSensor` on the vehicle and by
+ * `HostLightSensor` for host simulation.
+ */
+class LightSensorInterface {
+ public:
+  virtual ~LightSensorInterface() = default;
+
+  /**
+   * @brief Samples both LDRs. Values are raw readings and are normalized
+   * later by VehicleContext.
+   * @returns LightLevels struct with raw values from 0.0 - 1.0 (inclusive).
+   */
+  virtual LightLevels read(void) = 0;
+};
+
+/**
+ * @brief Interface for the left and right drive motors.
+ */
+class MotorInterface {
+ public:
+  virtual ~MotorInterface() = default;
+
+  /**
+   * @brief Sets the direction and "speed" (PWM duty cycle) of both wheels.
+   * @param dir_l Direction of the left wheel.
+   * @param dir_r Direction of the right wheel.
+   * @param pwm_l "Speed" of the left wheel as a PWM duty cycle (0.0f - 1.0f).
+   * @param pwm_r "Speed" of the right wheel as a PWM duty cycle (0.0f - 1.0f).
+   */
+  virtual void set_motor_speeds(Direction dir_l, Direction dir_r, float pwm_l,
+                                float pwm_r) = 0;
+};
+
+/**
+ * @brief Interface for the red and green status LEDs.
+ */
+class LedInterface {
+ public:
+  virtual ~LedInterface() = default;
+
+  /**
+   * @brief Turns the status LEDs on or off.
+   * @param green `true` to turn the green LED on.
+   * @param red `true` to turn the red LED on.
+   */
+  virtual void set_leds(bool green, bool red) = 0;
+};
+
+/**
+ * @brief Interface for the monotonic clock used for FSM timing.
+ */
+class ClockInterface {
+ public:
+  virtual ~ClockInterface() = default;
+
+  /**
+   * @returns The time elapsed since the clock started as `vehicle_duration`.
+   */
+  virtual vehicle_duration now(void) const = 0;
+};
+
+/**
+ * Destination ID received by every vehicle in range.
+ */
+const uint16_t RADIO_BROADCAST_ID = 0xFFFF;
+
+/**
+ * Destination IDs from `RADIO_GROUP_ID_BASE` up are reserved for broadcast
+ * and groups, so vehicle IDs must be below it. Group `g` (from 1 -
+ * `RADIO_NUM_GROUPS`) has ID `RADIO_GROUP_ID_BASE + g`.
+ */
+const uint16_t RADIO_GROUP_ID_BASE = 0xFFF0;
+const int RADIO_NUM_GROUPS = 4;
+
+/**
+ * @returns The destination ID of group `group` (from 1 - `RADIO_NUM_GROUPS`).
+ */
+inline uint16_t radio_group_id(int group) {
+  return static_cast<uint16_t>(RADIO_GROUP_ID_BASE + group);
+}
+
+/**
+ * @brief Interface for the RF transceiver used by CommsContext.
+ * @note The transceiver must already be configured (addresses, payload size,
+ * etc.) when it is handed over to CommsContext.
+ */
+class RadioInterface {
+ public:
+  virtual ~RadioInterface() = default;
+
+  /**
+   * @returns `true` if a received payload is waiting to be read.
+   */
+  virtual bool readable(void) = 0;
+
+  /**
+   * @brief Reads one received payload.
+   * @param buffer Buffer to write the payload to.
+   * @param size Size of `buffer` in bytes.
+   * @returns The number of bytes read.
+   */
+  virtual int read(char* buffer, int size) = 0;
+
+  /**
+   * @brief Transmits one payload.
+   * @param buffer Payload to transmit.
+   * @param size Size of the payload in bytes.
+   * @param dest The ID of the receiving vehicle, `RADIO_BROADCAST_ID`, or a
+   * group ID from `radio_group_id`.
+   * @returns The number of bytes written.
+   */
+  virtual int write(const char* buffer, int size, uint16_t dest) = 0;
+
+  /**
+   * @brief Attaches a handler to the transceiver's interrupt line, which
+   * fires when a payload is received (among other events). The handler may
+   * run in interrupt context.
+   * @param handler The handler to call.
+   * @returns `true` if the handler was attached, or `false` if there is no
+   * interrupt line and the transceiver has to be polled.
+   */
+  virtual bool attach_irq(Callback<void()> handler) = 0;
+};
+
+/**
+ * @brief Interface for non-volatile key-value storage, used to keep what the
+ * vehicle has learned across reboots.
+ * @note Implemented by `MbedKvStorage` on the vehicle and by
+ * `HostFileStorage` for host simulation.
+ */
+class StorageInterface {
+ public:
+  virtual ~StorageInterface() = default;
+
+  /**
+   * @brief Reads the value stored under `key`.
+   * @param key The key, a short name without slashes.
+   * @param buffer Buffer to write the value to.
+   * @param size Size of `buffer` in bytes.
+   * @returns The size of the value in bytes, or -1 if there is no value or it
+   * couldn't be read. Values larger than `buffer` are truncated.
+   */
+  virtual int load(const char* key, void* buffer, size_t size) = 0;
+
+  /**
+   * @brief Stores `size` bytes from `buffer` under `key`, replacing any
+   * previous value. Either the whole value is written or the previous one is
+   * kept.
+   * @returns `true` if the value was stored, otherwise `false`.
+   */
+  virtual bool store(const char* key, const void* buffer, size_t size) = 0;
+};
@@ -17,7 +17,7 @@ void IdleStateNode::execute(VehicleContext& ctx) {
 #endif
 
   // After minimum time in state has elapsed, transition to new state.
-  if (ctx.get_elapsed_time_in_state() >= ctx.get_min_duration(get_enum())) {
+  if (ctx.get_elapsed_time_in_state() >= ctx.get_min_duration(state)) {
     StateEnum next_state = ctx.sample_next_state();
 
     ctx.transition_to(next_state);
@@ -32,5 +32,3 @@ void IdleStateNode::exit(VehicleContext& ctx) {
   // Stop the motors before a transition to another state.
   ctx.set_motor_speeds(STOP, STOP, 0.0, 0.0);
 }
-
-StateEnum IdleStateNode::get_enum() const { return IDLE; }
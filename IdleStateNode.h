@@ -5,28 +5,38 @@
 class IdleStateNode : public StateNode {
  public:
   /**
-   * @brief Overrode entry procedure for Idle state.
+   * @brief Entry procedure for Idle state.
    * Runs entry code to set up Idle state before entering
    * main procedure.
    */
-  void enter(VehicleContext& ctx) override;
+  void enter(VehicleContext& ctx);
 
   /**
-   * @brief Overrode main procedure for Idle state.
+   * @brief Main procedure for Idle state.
    * Executed every FSM tick and behaves based on Idle state
    * described in lecture.
    */
-  void execute(VehicleContext& ctx) override;
+  void execute(VehicleContext& ctx);
 
   /**
-   * @brief Overrode exit procedure for Idle state.
+   * @brief Exit procedure for Idle state.
    * Runs any cleanup exiting the Idle state before any
    * state transitions occur.
    */
-  void exit(VehicleContext& ctx) override;
+  void exit(VehicleContext& ctx);
 
   /**
-   * @returns The state enum for the Idle state, `IDLE`.
+   * The state enum for the Idle state, `IDLE`.
    */
-  StateEnum get_enum(void) const override;
+  static constexpr StateEnum state = IDLE;
+
+  /**
+   * The minimum time spent in the Idle state before transitioning.
+   */
+  static constexpr vehicle_duration min_duration = 2500ms;
+
+  /**
+   * The Idle state does nothing until its minimum duration is up.
+   */
+  static constexpr bool needs_control_updates = false;
 };
@@ -0,0 +1,82 @@
+#include "InfluenceAggregator.h"
+
+#include <cmath>
+
+InfluenceAggregator::InfluenceAggregator(vehicle_duration half_life)
+    : m_half_life_ms(static_cast<float>(half_life.count())) {
+  for (int i = 0; i < NUM_STATES; ++i) {
+    m_delta_sum[i].store(0.0f, std::memory_order_relaxed);
+    m_weight[i].store(0.0f, std::memory_order_relaxed);
+  }
+}
+
+float InfluenceAggregator::decay_factor(int64_t elapsed_ms) const {
+  if (elapsed_ms <= 0) {
+    return 1.0f;
+  }
+  return std::exp2(-static_cast<float>(elapsed_ms) / m_half_life_ms);
+}
+
+void InfluenceAggregator::add(StateEnum state, float light_delta,
+                              vehicle_duration now) {
+  if (state >= NUM_STATES) {
+    return;
+  }
+
+  uint32_t seq = m_seq.load(std::memory_order_relaxed);
+  m_seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // Bring every state up to date before adding, so the whole summary shares
+  // one timestamp. Reports arrive in bursts, so usually nothing has decayed.
+  int64_t now_ms = now.count();
+  float decay =
+      decay_factor(now_ms - m_stamp_ms.load(std::memory_order_relaxed));
+  if (decay != 1.0f) {
+    for (int i = 0; i < NUM_STATES; ++i) {
+      m_delta_sum[i].store(m_delta_sum[i].load(std::memory_order_relaxed) *
+                               decay,
+                           std::memory_order_relaxed);
+      m_weight[i].store(m_weight[i].load(std::memory_order_relaxed) * decay,
+                        std::memory_order_relaxed);
+    }
+    m_stamp_ms.store(now_ms, std::memory_order_relaxed);
+  }
+
+  m_delta_sum[state].store(
+      m_delta_sum[state].load(std::memory_order_relaxed) + light_delta,
+      std::memory_order_relaxed);
+  m_weight[state].store(m_weight[state].load(std::memory_order_relaxed) + 1.0f,
+                        std::memory_order_relaxed);
+
+  m_seq.store(seq + 2, std::memory_order_release);
+}
+
+bool InfluenceAggregator::try_snapshot(vehicle_duration now,
+                                       InfluenceSummary& out) const {
+  for (int attempt = 0; attempt < MAX_SNAPSHOT_ATTEMPTS; ++attempt) {
+    uint32_t seq = m_seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+      continue;
+    }
+
+    int64_t stamp_ms = m_stamp_ms.load(std::memory_order_relaxed);
+    for (int i = 0; i < NUM_STATES; ++i) {
+      out.delta_sum[i] = m_delta_sum[i].load(std::memory_order_relaxed);
+      out.weight[i] = m_weight[i].load(std::memory_order_relaxed);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (m_seq.load(std::memory_order_relaxed) != seq) {
+      continue;
+    }
+
+    float decay = decay_factor(now.count() - stamp_ms);
+    for (int i = 0; i < NUM_STATES; ++i) {
+      out.delta_sum[i] *= decay;
+      out.weight[i] *= decay;
+    }
+    return true;
+  }
+  return false;
+}
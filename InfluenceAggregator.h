@@ -0,0 +1,74 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "Globals.h"
+#include "StateRegistry.h"
+
+/**
+ * @brief What the swarm has reported about each state, decayed to one point
+ * in time.
+ * @param delta_sum Decayed sum of the average light level change reported
+ * over each state. Negative means the state led to darkness.
+ * @param weight Decayed number of reports for each state. Each report starts
+ * at 1 and halves every half-life.
+ */
+struct InfluenceSummary {
+  std::array<float, NUM_STATES> delta_sum;
+  std::array<float, NUM_STATES> weight;
+};
+
+/**
+ * @brief Folds transition reports from other vehicles into a running,
+ * exponentially decayed summary per state as they arrive, so reading the
+ * influence of the whole swarm costs O(`NUM_STATES`) however many reports
+ * there were.
+ * @note Lock-free for one writer and one reader thread. `add` must only be
+ * called by one thread (the comms thread), and `try_snapshot` by one other
+ * (the FSM thread).
+ */
+class InfluenceAggregator {
+ public:
+  /**
+   * @param half_life How long it takes a report's influence to halve.
+   */
+  explicit InfluenceAggregator(vehicle_duration half_life = 5000ms);
+
+  /**
+   * @brief Writer only. Adds a report that another vehicle's light levels
+   * changed by `light_delta` on average while it was in `state`. Reports of
+   * unknown states are ignored.
+   * @param now The current time, never earlier than in previous calls.
+   */
+  void add(StateEnum state, float light_delta, vehicle_duration now);
+
+  /**
+   * @brief Reader only. Copies the summary, decayed to `now`.
+   * @param now The current time, never earlier than the last `add`.
+   * @param out Written with the summary.
+   * @returns `true` if `out` was written, or `false` if the writer kept
+   * updating the summary while it was being copied.
+   */
+  bool try_snapshot(vehicle_duration now, InfluenceSummary& out) const;
+
+ private:
+  // Attempts at a consistent copy before `try_snapshot` gives up, so the
+  // reader never spins on a writer it preempted.
+  static constexpr int MAX_SNAPSHOT_ATTEMPTS = 4;
+
+  const float m_half_life_ms;
+
+  // Sequence lock: odd while the writer is updating the summary. The values
+  // are atomics so the reader's racing copies are well defined, and are only
+  // trusted if the sequence didn't change.
+  std::atomic<uint32_t> m_seq{0};
+  std::atomic<int64_t> m_stamp_ms{0};
+  std::array<std::atomic<float>, NUM_STATES> m_delta_sum;
+  std::array<std::atomic<float>, NUM_STATES> m_weight;
+
+  /**
+   * @returns The factor to decay values by over `elapsed_ms`.
+   */
+  float decay_factor(int64_t elapsed_ms) const;
+};
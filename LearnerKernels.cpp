@@ -0,0 +1,230 @@
+#include "LearnerKernels.h"
+
+#ifdef LEARNER_USE_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef LEARNER_FIXED_POINT
+/**
+ * @returns `value` saturated to the range of `prob_t`.
+ */
+static inline prob_t saturate_prob(int32_t value) {
+#ifdef __ARM_FEATURE_DSP
+  return static_cast<prob_t>(__USAT(value, 16));
+#else
+  value = value > 0 ? value : 0;
+  return static_cast<prob_t>(value < 0xFFFF ? value : 0xFFFF);
+#endif
+}
+
+void learner_update_row_scalar(prob_t* row, int col, reward_t delta) {
+  reward_t reverse_delta = NUM_STATES > 1 ? -delta / (NUM_STATES - 1) : 0;
+  for (int i = 0; i < LEARNER_ROW_STRIDE; ++i) {
+    reward_t d = (i == col) ? delta : reverse_delta;
+    d = (i < NUM_STATES) ? d : 0;
+    row[i] = saturate_prob(static_cast<int32_t>(row[i]) + d);
+  }
+}
+
+void learner_normalize_row_scalar(prob_t* row) {
+  // Clamp to the minimum probability. The sum can't be zero afterwards.
+  uint32_t sum = 0;
+  for (int i = 0; i < NUM_STATES; ++i) {
+    row[i] = row[i] > LEARNER_MIN_PROB ? row[i] : LEARNER_MIN_PROB;
+    sum += row[i];
+  }
+  if (sum == PROB_ONE) {
+    return;
+  }
+
+  // Scale by PROB_ONE / sum as a UQ16.16 factor, so the only division is the
+  // one computing it, then round each entry to nearest
+  uint32_t scale = (static_cast<uint32_t>(PROB_ONE) << 16) / sum;
+  uint32_t total = 0;
+  int largest = 0;
+  for (int i = 0; i < NUM_STATES; ++i) {
+    row[i] = static_cast<prob_t>(
+        (static_cast<uint64_t>(row[i]) * scale + 0x8000) >> 16);
+    total += row[i];
+    largest = row[i] > row[largest] ? i : largest;
+  }
+
+  // Rounding leaves the total a few counts off, which the largest entry can
+  // absorb without dropping below the minimum
+  row[largest] = static_cast<prob_t>(static_cast<int32_t>(row[largest]) +
+                                     static_cast<int32_t>(PROB_ONE) -
+                                     static_cast<int32_t>(total));
+}
+
+StateEnum learner_sample_row_scalar(const prob_t* row, sample_t sample) {
+  // Compare the top 15 bits of the draw against the cumulative sum. Rows sum
+  // to exactly PROB_ONE, so some state always reaches the draw.
+  uint32_t target = sample >> 1;
+  uint32_t cum_sum = 0;
+  int count = 0;
+  for (int i = 0; i < NUM_STATES; ++i) {
+    cum_sum += row[i];
+    count += (cum_sum <= target) ? 1 : 0;
+  }
+
+  return count < NUM_STATES ? static_cast<StateEnum>(count) : IDLE;
+}
+#else
+/*
+ * Reference order of operations for the floating point learner, shared by
+ * both versions so they stay bit-identical:
+ * - Sums accumulate each of the 8 lanes separately across chunks of 8, then
+ *   reduce as ((l0 + l4) + (l2 + l6)) + ((l1 + l5) + (l3 + l7)).
+ * - Cumulative sums within a chunk are built in three doubling steps, adding
+ *   the value 1 lane back, then 2 lanes back within each half of 4, then the
+ *   last lane of the low half to the high half. The running total of the
+ *   previous chunks is added last.
+ */
+
+void learner_update_row_scalar(float* row, int col, float delta) {
+  float reverse_delta =
+      NUM_STATES > 1 ? -delta / static_cast<float>(NUM_STATES - 1) : 0.0f;
+  for (int i = 0; i < LEARNER_ROW_STRIDE; ++i) {
+    float d = (i == col) ? delta : reverse_delta;
+    row[i] += (i < NUM_STATES) ? d : 0.0f;
+  }
+}
+
+void learner_normalize_row_scalar(float* row) {
+  // Clamp to the minimum probability and accumulate the lane sums
+  float lane_sums[8] = {0.0f};
+  for (int c = 0; c < LEARNER_ROW_STRIDE; c += 8) {
+    for (int l = 0; l < 8; ++l) {
+      float value = row[c + l];
+      float clamped = value > LEARNER_MIN_PROB ? value : LEARNER_MIN_PROB;
+      value = (c + l < NUM_STATES) ? clamped : value;
+      row[c + l] = value;
+      lane_sums[l] += value;
+    }
+  }
+  float sum = ((lane_sums[0] + lane_sums[4]) + (lane_sums[2] + lane_sums[6])) +
+              ((lane_sums[1] + lane_sums[5]) + (lane_sums[3] + lane_sums[7]));
+
+  if (!(sum > 0.0f)) {
+    // Something went terribly wrong, so we should reset to uniform
+    // probabilities
+    for (int i = 0; i < LEARNER_ROW_STRIDE; ++i) {
+      row[i] = (i < NUM_STATES) ? 1.0f / static_cast<float>(NUM_STATES) : 0.0f;
+    }
+    return;
+  }
+
+  // And use the probability sum to normalize the values
+  for (int i = 0; i < LEARNER_ROW_STRIDE; ++i) {
+    row[i] /= sum;
+  }
+}
+
+StateEnum learner_sample_row_scalar(const float* row, float sample) {
+  // Count the states whose cumulative probability falls short of the sample,
+  // which is the index of the first state that reaches it
+  int count = 0;
+  float carry = 0.0f;
+  for (int c = 0; c < LEARNER_ROW_STRIDE; c += 8) {
+    const float* x = &row[c];
+    float y[8];
+    float z[8];
+    for (int l = 0; l < 8; ++l) {
+      y[l] = x[l] + ((l % 4 >= 1) ? x[l - 1] : 0.0f);
+    }
+    for (int l = 0; l < 8; ++l) {
+      z[l] = y[l] + ((l % 4 >= 2) ? y[l - 2] : 0.0f);
+    }
+    float cum_sum[8];
+    for (int l = 0; l < 8; ++l) {
+      cum_sum[l] = (z[l] + ((l >= 4) ? z[3] : 0.0f)) + carry;
+      count += (c + l < NUM_STATES && cum_sum[l] < sample) ? 1 : 0;
+    }
+    carry = cum_sum[7];
+  }
+
+  // Otherwise we fallback to IDLE
+  return count < NUM_STATES ? static_cast<StateEnum>(count) : IDLE;
+}
+#endif
+
+#ifdef LEARNER_USE_AVX2
+/**
+ * @returns A mask of the lanes in chunk `c` that hold a state, as opposed to
+ * padding.
+ */
+static inline __m256 valid_lanes(int c) {
+  __m256i lane = _mm256_add_epi32(_mm256_set1_epi32(c),
+                                  _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  return _mm256_castsi256_ps(
+      _mm256_cmpgt_epi32(_mm256_set1_epi32(NUM_STATES), lane));
+}
+
+void learner_update_row_avx2(float* row, int col, float delta) {
+  float reverse_delta =
+      NUM_STATES > 1 ? -delta / static_cast<float>(NUM_STATES - 1) : 0.0f;
+  const __m256 v_delta = _mm256_set1_ps(delta);
+  const __m256 v_reverse = _mm256_set1_ps(reverse_delta);
+  for (int c = 0; c < LEARNER_ROW_STRIDE; c += 8) {
+    __m256i lane = _mm256_add_epi32(_mm256_set1_epi32(c),
+                                    _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256 is_col = _mm256_castsi256_ps(
+        _mm256_cmpeq_epi32(lane, _mm256_set1_epi32(col)));
+    __m256 d = _mm256_blendv_ps(v_reverse, v_delta, is_col);
+    d = _mm256_and_ps(d, valid_lanes(c));
+    _mm256_storeu_ps(&row[c], _mm256_add_ps(_mm256_loadu_ps(&row[c]), d));
+  }
+}
+
+void learner_normalize_row_avx2(float* row) {
+  const __m256 v_min = _mm256_set1_ps(LEARNER_MIN_PROB);
+  __m256 acc = _mm256_setzero_ps();
+  for (int c = 0; c < LEARNER_ROW_STRIDE; c += 8) {
+    __m256 value = _mm256_loadu_ps(&row[c]);
+    value = _mm256_blendv_ps(value, _mm256_max_ps(value, v_min),
+                             valid_lanes(c));
+    _mm256_storeu_ps(&row[c], value);
+    acc = _mm256_add_ps(acc, value);
+  }
+  __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(acc),
+                           _mm256_extractf128_ps(acc, 1));
+  __m128 sum2 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+  float sum = _mm_cvtss_f32(
+      _mm_add_ss(sum2, _mm_shuffle_ps(sum2, sum2, _MM_SHUFFLE(1, 1, 1, 1))));
+
+  if (!(sum > 0.0f)) {
+    learner_normalize_row_scalar(row);
+    return;
+  }
+
+  const __m256 v_sum = _mm256_set1_ps(sum);
+  for (int c = 0; c < LEARNER_ROW_STRIDE; c += 8) {
+    _mm256_storeu_ps(&row[c], _mm256_div_ps(_mm256_loadu_ps(&row[c]), v_sum));
+  }
+}
+
+StateEnum learner_sample_row_avx2(const float* row, float sample) {
+  const __m256 v_sample = _mm256_set1_ps(sample);
+  const __m256i last_of_low_half = _mm256_set1_epi32(3);
+  int count = 0;
+  __m256 carry = _mm256_setzero_ps();
+  for (int c = 0; c < LEARNER_ROW_STRIDE; c += 8) {
+    __m256 x = _mm256_loadu_ps(&row[c]);
+    __m256 y = _mm256_add_ps(
+        x, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(x), 4)));
+    __m256 z = _mm256_add_ps(
+        y, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(y), 8)));
+    __m256 low_total = _mm256_blend_ps(
+        _mm256_setzero_ps(), _mm256_permutevar8x32_ps(z, last_of_low_half),
+        0xF0);
+    __m256 cum_sum = _mm256_add_ps(_mm256_add_ps(z, low_total), carry);
+
+    __m256 short_of_sample = _mm256_and_ps(
+        _mm256_cmp_ps(cum_sum, v_sample, _CMP_LT_OQ), valid_lanes(c));
+    count += __builtin_popcount(_mm256_movemask_ps(short_of_sample));
+    carry = _mm256_permutevar8x32_ps(cum_sum, _mm256_set1_epi32(7));
+  }
+
+  return count < NUM_STATES ? static_cast<StateEnum>(count) : IDLE;
+}
+#endif
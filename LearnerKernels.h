@@ -0,0 +1,139 @@
+#pragma once
+#include <cstdint>
+
+#include "Globals.h"
+#include "StateRegistry.h"
+
+#ifdef LEARNER_FIXED_POINT
+/*
+ * Fixed-point learner. Probabilities are unsigned Q15 (32768 == 1.0) and every
+ * row sums to exactly `PROB_ONE`. Rewards and probability changes are signed
+ * Q15, and samples are 16-bit uniform draws. Only integer arithmetic is used,
+ * so results are bit-identical between the host and the vehicle.
+ */
+using prob_t = uint16_t;
+using reward_t = int32_t;
+using sample_t = uint16_t;
+const prob_t PROB_ONE = 32768;
+const prob_t LEARNER_MIN_PROB = 328;  // ~0.01
+#else
+using prob_t = float;
+using reward_t = float;
+using sample_t = float;
+const prob_t PROB_ONE = 1.0f;
+const prob_t LEARNER_MIN_PROB = 0.01f;
+#endif
+
+#if defined(__AVX2__) && !defined(LEARNER_FIXED_POINT)
+#define LEARNER_USE_AVX2
+#endif
+
+// Rows of the probability table are padded to a whole number of 8-entry
+// vectors. Padding lanes are always 0 and are never clamped or sampled.
+constexpr int LEARNER_ROW_STRIDE = (NUM_STATES + 7) / 8 * 8;
+
+/**
+ * @returns `prob` as a float from 0.0 - 1.0.
+ */
+inline float prob_to_float(prob_t prob) {
+  return static_cast<float>(prob) / static_cast<float>(PROB_ONE);
+}
+
+/**
+ * @returns The probability or reward `value` converted from a float, where 1.0
+ * is `PROB_ONE`.
+ */
+inline reward_t reward_from_float(float value) {
+  return static_cast<reward_t>(value * PROB_ONE);
+}
+
+/**
+ * @returns `true` with probability `num / den` for a uniform `sample`, without
+ * dividing.
+ * @param num The numerator, from 0 - `den`.
+ * @param den The (positive) denominator. Defaults to `PROB_ONE`, so `num` is
+ * a probability.
+ */
+inline bool learner_sample_below(sample_t sample, reward_t num,
+                                 reward_t den = PROB_ONE) {
+#ifdef LEARNER_FIXED_POINT
+  // Compare the top 15 bits of the draw as a Q15 fraction
+  return static_cast<int64_t>(sample >> 1) * den <
+         static_cast<int64_t>(num) * PROB_ONE;
+#else
+  return sample * den < num;
+#endif
+}
+
+/*
+ * Kernels for updating, normalizing and sampling a row of the probability
+ * table. Each kernel has a portable scalar version and, on hosts built with
+ * AVX2, a vectorized version of the floating point learner. Both are
+ * branch-free in the inner loop and add up floats in the same order, so they
+ * produce bit-identical results. The unsuffixed functions pick the fastest
+ * version available.
+ *
+ * On the Cortex-M4 the scalar versions are used. Its DSP SIMD instructions
+ * only operate on packed integers, and the clamps compile to conditional
+ * execution rather than branches. The fixed-point learner uses the DSP
+ * saturation instruction when it is available.
+ */
+
+/**
+ * @brief Adds `delta` to `row[col]` and spreads `-delta` evenly over the other
+ * states, keeping the sum of the row unchanged.
+ * @param row A padded row of `LEARNER_ROW_STRIDE` probabilities.
+ * @param col The state to apply `delta` to.
+ * @param delta The change in probability.
+ */
+void learner_update_row_scalar(prob_t* row, int col, reward_t delta);
+
+/**
+ * @brief Clamps every probability in the row to at least `LEARNER_MIN_PROB`,
+ * then scales the row to sum to `PROB_ONE`. The floating point version resets
+ * the row to uniform if the sum is not positive (e.g. NaN). The fixed-point
+ * version uses a single integer division and gives any rounding residue to the
+ * largest state, so the row sums to exactly `PROB_ONE`.
+ * @param row A padded row of `LEARNER_ROW_STRIDE` probabilities.
+ */
+void learner_normalize_row_scalar(prob_t* row);
+
+/**
+ * @brief Picks a state by comparing a uniform sample to the cumulative sum of
+ * the row.
+ * @param row A padded row of `LEARNER_ROW_STRIDE` probabilities.
+ * @param sample A uniform sample.
+ * @returns The first state whose cumulative probability reaches `sample`, or
+ * `IDLE` if there is none.
+ */
+StateEnum learner_sample_row_scalar(const prob_t* row, sample_t sample);
+
+#ifdef LEARNER_USE_AVX2
+void learner_update_row_avx2(float* row, int col, float delta);
+void learner_normalize_row_avx2(float* row);
+StateEnum learner_sample_row_avx2(const float* row, float sample);
+#endif
+
+inline void learner_update_row(prob_t* row, int col, reward_t delta) {
+#ifdef LEARNER_USE_AVX2
+  learner_update_row_avx2(row, col, delta);
+#else
+  learner_update_row_scalar(row, col, delta);
+#endif
+}
+
+inline void learner_normalize_row(prob_t* row) {
+#ifdef LEARNER_USE_AVX2
+  learner_normalize_row_avx2(row);
+#else
+  learner_normalize_row_scalar(row);
+#endif
+}
+
+inline StateEnum learner_sample_row(const prob_t* row, sample_t sample) {
+#ifdef LEARNER_USE_AVX2
+  return learner_sample_row_avx2(row, sample);
+#else
+  return learner_sample_row_scalar(row, sample);
+#endif
+}
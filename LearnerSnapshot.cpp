@@ -0,0 +1,169 @@
+#include "LearnerSnapshot.h"
+
+#include <cmath>
+#include <cstring>
+
+// Header field offsets
+const int SNAPSHOT_OFFSET_MAGIC = 0;
+const int SNAPSHOT_OFFSET_VERSION = 4;
+const int SNAPSHOT_OFFSET_FORMAT = 5;
+const int SNAPSHOT_OFFSET_NUM_STATES = 6;
+
+const uint8_t SNAPSHOT_MAGIC[4] = {'R', 'L', 'B', 'V'};
+
+#ifdef LEARNER_FIXED_POINT
+const uint8_t SNAPSHOT_FORMAT = 1;
+#else
+const uint8_t SNAPSHOT_FORMAT = 0;
+#endif
+
+static inline void write_u32(uint8_t* dst, uint32_t value) {
+  dst[0] = static_cast<uint8_t>(value);
+  dst[1] = static_cast<uint8_t>(value >> 8);
+  dst[2] = static_cast<uint8_t>(value >> 16);
+  dst[3] = static_cast<uint8_t>(value >> 24);
+}
+
+static inline uint32_t read_u32(const uint8_t* src) {
+  return static_cast<uint32_t>(src[0]) | (static_cast<uint32_t>(src[1]) << 8) |
+         (static_cast<uint32_t>(src[2]) << 16) |
+         (static_cast<uint32_t>(src[3]) << 24);
+}
+
+static inline void write_float(uint8_t* dst, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  write_u32(dst, bits);
+}
+
+static inline float read_float(const uint8_t* src) {
+  uint32_t bits = read_u32(src);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static inline void write_prob(uint8_t* dst, prob_t prob) {
+#ifdef LEARNER_FIXED_POINT
+  dst[0] = static_cast<uint8_t>(prob);
+  dst[1] = static_cast<uint8_t>(prob >> 8);
+#else
+  write_float(dst, prob);
+#endif
+}
+
+static inline prob_t read_prob(const uint8_t* src) {
+#ifdef LEARNER_FIXED_POINT
+  return static_cast<prob_t>(src[0] | (src[1] << 8));
+#else
+  return read_float(src);
+#endif
+}
+
+uint32_t crc32(const uint8_t* data, size_t size) {
+  // Bitwise, without a lookup table: snapshots are small and rare, so flash
+  // is worth more than speed here.
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; ++i) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+  }
+  return ~crc;
+}
+
+/**
+ * @returns `true` if `row` is a valid row of the probability table.
+ */
+static bool row_is_valid(const prob_t* row) {
+  reward_t sum = 0;
+  for (int i = 0; i < NUM_STATES; ++i) {
+#ifndef LEARNER_FIXED_POINT
+    if (!std::isfinite(row[i])) {
+      return false;
+    }
+#endif
+    if (row[i] <= 0 || row[i] > PROB_ONE) {
+      return false;
+    }
+    sum += row[i];
+  }
+
+#ifdef LEARNER_FIXED_POINT
+  return sum == PROB_ONE;
+#else
+  return std::fabs(sum - PROB_ONE) < 1e-3f;
+#endif
+}
+
+void learner_snapshot_save(const LearnerStore& learner, size_t slot,
+                           uint8_t* buffer) {
+  memcpy(&buffer[SNAPSHOT_OFFSET_MAGIC], SNAPSHOT_MAGIC,
+         sizeof(SNAPSHOT_MAGIC));
+  buffer[SNAPSHOT_OFFSET_VERSION] = SNAPSHOT_VERSION;
+  buffer[SNAPSHOT_OFFSET_FORMAT] = SNAPSHOT_FORMAT;
+  buffer[SNAPSHOT_OFFSET_NUM_STATES] = NUM_STATES;
+  buffer[SNAPSHOT_OFFSET_NUM_STATES + 1] = 0;
+
+  uint8_t* calibration = &buffer[SNAPSHOT_HEADER_SIZE];
+  write_float(&calibration[0], learner.light_lvl_min(slot).lvl_left);
+  write_float(&calibration[4], learner.light_lvl_min(slot).lvl_right);
+  write_float(&calibration[8], learner.light_lvl_max(slot).lvl_left);
+  write_float(&calibration[12], learner.light_lvl_max(slot).lvl_right);
+
+  uint8_t* table = &calibration[SNAPSHOT_CALIBRATION_SIZE];
+  for (int state = 0; state < NUM_STATES; ++state) {
+    const prob_t* row = learner.get_row(slot, static_cast<StateEnum>(state));
+    for (int i = 0; i < NUM_STATES; ++i) {
+      write_prob(table, row[i]);
+      table += sizeof(prob_t);
+    }
+  }
+
+  write_u32(&buffer[SNAPSHOT_SIZE - 4], crc32(buffer, SNAPSHOT_SIZE - 4));
+}
+
+bool learner_snapshot_load(LearnerStore& learner, size_t slot,
+                           const uint8_t* buffer, size_t size) {
+  // Check everything before touching the store.
+  if (size != SNAPSHOT_SIZE ||
+      memcmp(&buffer[SNAPSHOT_OFFSET_MAGIC], SNAPSHOT_MAGIC,
+             sizeof(SNAPSHOT_MAGIC)) != 0 ||
+      buffer[SNAPSHOT_OFFSET_VERSION] != SNAPSHOT_VERSION ||
+      buffer[SNAPSHOT_OFFSET_FORMAT] != SNAPSHOT_FORMAT ||
+      buffer[SNAPSHOT_OFFSET_NUM_STATES] != NUM_STATES ||
+      read_u32(&buffer[SNAPSHOT_SIZE - 4]) !=
+          crc32(buffer, SNAPSHOT_SIZE - 4)) {
+    return false;
+  }
+
+  const uint8_t* calibration = &buffer[SNAPSHOT_HEADER_SIZE];
+  LightLevels lvl_min = {read_float(&calibration[0]),
+                         read_float(&calibration[4])};
+  LightLevels lvl_max = {read_float(&calibration[8]),
+                         read_float(&calibration[12])};
+
+  prob_t rows[NUM_STATES][NUM_STATES];
+  const uint8_t* table = &calibration[SNAPSHOT_CALIBRATION_SIZE];
+  for (int state = 0; state < NUM_STATES; ++state) {
+    for (int i = 0; i < NUM_STATES; ++i) {
+      rows[state][i] = read_prob(table);
+      table += sizeof(prob_t);
+    }
+    if (!row_is_valid(rows[state])) {
+      return false;
+    }
+  }
+
+  learner.light_lvl_min(slot) = lvl_min;
+  learner.light_lvl_max(slot) = lvl_max;
+  for (int state = 0; state < NUM_STATES; ++state) {
+    prob_t* row = learner.get_row(slot, static_cast<StateEnum>(state));
+    for (int i = 0; i < NUM_STATES; ++i) {
+      row[i] = rows[state][i];
+    }
+    learner.invalidate_row(slot, static_cast<StateEnum>(state));
+  }
+  return true;
+}
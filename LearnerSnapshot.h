@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "LearnerStore.h"
+
+/*
+ * Binary format of a learner snapshot (little endian), used to persist what
+ * a vehicle has learned across reboots:
+ *
+ *   offset  size  field
+ *   0       4     magic, "RLBV"
+ *   4       1     version, `SNAPSHOT_VERSION`
+ *   5       1     probability format, 0 for float or 1 for Q15
+ *   6       1     number of states
+ *   7       1     reserved, 0
+ *   8       16    light_lvl_min and light_lvl_max, left then right, as floats
+ *   24      ...   probability table, row by row without padding, each entry
+ *                 a float (4 bytes) or Q15 (2 bytes)
+ *   end-4   4     CRC-32 of everything before it
+ *
+ * Snapshots with a different version, probability format or number of
+ * states are rejected rather than converted, and the vehicle starts fresh.
+ */
+
+const uint8_t SNAPSHOT_VERSION = 1;
+const int SNAPSHOT_HEADER_SIZE = 8;
+const int SNAPSHOT_CALIBRATION_SIZE = 16;
+const int SNAPSHOT_SIZE = SNAPSHOT_HEADER_SIZE + SNAPSHOT_CALIBRATION_SIZE +
+                          NUM_STATES * NUM_STATES * sizeof(prob_t) + 4;
+
+/**
+ * @returns The CRC-32 (IEEE 802.3, as used by zlib) of `size` bytes at
+ * `data`.
+ */
+uint32_t crc32(const uint8_t* data, size_t size);
+
+/**
+ * @brief Writes the calibration and probability table of a slot to `buffer`.
+ * @param learner The store to read from.
+ * @param slot The slot to read.
+ * @param buffer The buffer to write to, `SNAPSHOT_SIZE` bytes.
+ */
+void learner_snapshot_save(const LearnerStore& learner, size_t slot,
+                           uint8_t* buffer);
+
+/**
+ * @brief Restores the calibration and probability table of a slot from a
+ * snapshot. Nothing is changed unless the whole snapshot is valid.
+ * @param learner The store to write to.
+ * @param slot The slot to write.
+ * @param buffer The snapshot.
+ * @param size The size of the snapshot in bytes.
+ * @returns `true` if the snapshot was restored, otherwise `false`.
+ */
+bool learner_snapshot_load(LearnerStore& learner, size_t slot,
+                           const uint8_t* buffer, size_t size);
@@ -0,0 +1,176 @@
+#include "LearnerStore.h"
+
+LearnerStore::LearnerStore(size_t capacity)
+    : m_capacity(capacity),
+      m_deferred(false),
+      m_tables(new prob_t[capacity * NUM_STATES * LEARNER_ROW_STRIDE]),
+      m_alias_keep_prob(new prob_t[capacity * NUM_STATES * LEARNER_ROW_STRIDE]),
+      m_alias(new uint8_t[capacity * NUM_STATES * LEARNER_ROW_STRIDE]),
+      m_alias_stale(new bool[capacity * NUM_STATES]),
+      m_curr_state(new StateEnum[capacity]),
+      m_prev_state(new StateEnum[capacity]),
+      m_time_state_entry(new vehicle_duration[capacity]),
+      m_light_lvl_entry(new LightLevels[capacity]),
+      m_light_lvl_curr(new LightLevels[capacity]),
+      m_light_lvl_min(new LightLevels[capacity]),
+      m_light_lvl_max(new LightLevels[capacity]),
+      m_comms_influence(new float[capacity]),
+      m_pending_delta(new reward_t[capacity]),
+      m_pending_from(new StateEnum[capacity]),
+      m_pending_to(new StateEnum[capacity]),
+      m_pending(new bool[capacity]) {
+  for (size_t slot = 0; slot < capacity; ++slot) {
+    reset_table(slot);
+    m_curr_state[slot] = IDLE;
+    m_prev_state[slot] = IDLE;
+    m_time_state_entry[slot] = vehicle_duration(0);
+    m_light_lvl_entry[slot] = {0.0f, 0.0f};
+    m_light_lvl_curr[slot] = {0.0f, 0.0f};
+    m_light_lvl_min[slot] = {1.0f, 1.0f};
+    m_light_lvl_max[slot] = {0.0f, 0.0f};
+    m_comms_influence[slot] = 0.0f;
+    m_pending_delta[slot] = 0;
+    m_pending_from[slot] = IDLE;
+    m_pending_to[slot] = IDLE;
+    m_pending[slot] = false;
+  }
+}
+
+size_t LearnerStore::get_capacity(void) const { return m_capacity; }
+
+void LearnerStore::set_deferred_updates(bool deferred) {
+  m_deferred = deferred;
+}
+
+void LearnerStore::reset_table(size_t slot) {
+  for (int state = 0; state < NUM_STATES; ++state) {
+    prob_t* row = get_row(slot, static_cast<StateEnum>(state));
+    for (int i = 0; i < LEARNER_ROW_STRIDE; ++i) {
+      row[i] = (i < NUM_STATES) ? PROB_ONE / NUM_STATES : 0;
+    }
+#ifdef LEARNER_FIXED_POINT
+    // Integer division leaves a remainder, so give it to the first state to
+    // keep the row summing to exactly PROB_ONE
+    row[0] += PROB_ONE % NUM_STATES;
+#endif
+    invalidate_row(slot, static_cast<StateEnum>(state));
+  }
+}
+
+void LearnerStore::submit_update(size_t slot, reward_t delta) {
+  if (m_deferred) {
+    // Only the most recent transition can be pending, since a slot can't
+    // transition twice between two batched passes. The transition is
+    // captured now, because the slot moves on to its next state before the
+    // pass.
+    m_pending_delta[slot] = delta;
+    m_pending_from[slot] = m_prev_state[slot];
+    m_pending_to[slot] = m_curr_state[slot];
+    m_pending[slot] = true;
+    return;
+  }
+
+  prob_t* row = get_row(slot, m_prev_state[slot]);
+  learner_update_row(row, m_curr_state[slot], delta);
+  learner_normalize_row(row);
+  invalidate_row(slot, m_prev_state[slot]);
+}
+
+void LearnerStore::update_probability_tables(size_t begin, size_t end) {
+  for (size_t slot = begin; slot < end; ++slot) {
+    if (m_pending[slot]) {
+      learner_update_row(get_row(slot, m_pending_from[slot]),
+                         m_pending_to[slot], m_pending_delta[slot]);
+    }
+  }
+}
+
+void LearnerStore::normalize_probabilities(size_t begin, size_t end) {
+  for (size_t slot = begin; slot < end; ++slot) {
+    if (m_pending[slot]) {
+      learner_normalize_row(get_row(slot, m_pending_from[slot]));
+      invalidate_row(slot, m_pending_from[slot]);
+      m_pending[slot] = false;
+    }
+  }
+}
+
+StateEnum LearnerStore::sample_state(size_t slot, StateEnum from,
+                                     sample_t sample) {
+  size_t row_index = slot * NUM_STATES + from;
+  prob_t* keep_prob = &m_alias_keep_prob[row_index * LEARNER_ROW_STRIDE];
+  uint8_t* alias = &m_alias[row_index * LEARNER_ROW_STRIDE];
+  if (m_alias_stale[row_index]) {
+    alias_build_row(get_row(slot, from), keep_prob, alias);
+    m_alias_stale[row_index] = false;
+  }
+  return alias_sample_row(keep_prob, alias, sample);
+}
+
+void LearnerStore::invalidate_row(size_t slot, StateEnum state) {
+  m_alias_stale[slot * NUM_STATES + state] = true;
+}
+
+prob_t* LearnerStore::get_row(size_t slot, StateEnum state) {
+  return &m_tables[(slot * NUM_STATES + state) * LEARNER_ROW_STRIDE];
+}
+
+const prob_t* LearnerStore::get_row(size_t slot, StateEnum state) const {
+  return &m_tables[(slot * NUM_STATES + state) * LEARNER_ROW_STRIDE];
+}
+
+StateEnum& LearnerStore::curr_state(size_t slot) { return m_curr_state[slot]; }
+
+StateEnum LearnerStore::curr_state(size_t slot) const {
+  return m_curr_state[slot];
+}
+
+StateEnum& LearnerStore::prev_state(size_t slot) { return m_prev_state[slot]; }
+
+StateEnum LearnerStore::prev_state(size_t slot) const {
+  return m_prev_state[slot];
+}
+
+vehicle_duration& LearnerStore::time_state_entry(size_t slot) {
+  return m_time_state_entry[slot];
+}
+
+LightLevels& LearnerStore::light_lvl_entry(size_t slot) {
+  return m_light_lvl_entry[slot];
+}
+
+LightLevels& LearnerStore::light_lvl_curr(size_t slot) {
+  return m_light_lvl_curr[slot];
+}
+
+const LightLevels& LearnerStore::light_lvl_curr(size_t slot) const {
+  return m_light_lvl_curr[slot];
+}
+
+LightLevels& LearnerStore::light_lvl_min(size_t slot) {
+  return m_light_lvl_min[slot];
+}
+
+const LightLevels& LearnerStore::light_lvl_min(size_t slot) const {
+  return m_light_lvl_min[slot];
+}
+
+LightLevels& LearnerStore::light_lvl_max(size_t slot) {
+  return m_light_lvl_max[slot];
+}
+
+const LightLevels& LearnerStore::light_lvl_max(size_t slot) const {
+  return m_light_lvl_max[slot];
+}
+
+float& LearnerStore::comms_influence(size_t slot) {
+  return m_comms_influence[slot];
+}
+
+const StateEnum* LearnerStore::get_curr_states(void) const {
+  return m_curr_state.get();
+}
+
+const LightLevels* LearnerStore::get_light_lvls_curr(void) const {
+  return m_light_lvl_curr.get();
+}
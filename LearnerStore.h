@@ -0,0 +1,149 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+
+#include "AliasTable.h"
+#include "Globals.h"
+#include "LearnerKernels.h"
+
+/**
+ * @brief Structure-of-arrays storage for the learning state of one or more
+ * vehicles. Each VehicleContext owns one slot. Probability tables, light
+ * levels, state entry times and states are kept in parallel arrays so batched
+ * updates walk contiguous memory instead of scattered VehicleContext objects.
+ * @note Each row also has an alias table for O(1) sampling, rebuilt lazily the
+ * next time the row is sampled after it changes.
+ * @note Probabilities are floats, or Q15 when built with
+ * `LEARNER_FIXED_POINT` (see LearnerKernels.h).
+ * @note Probability updates can either be applied immediately (the default,
+ * used on the vehicle) or deferred and applied to a whole batch of slots at
+ * once with `update_probability_tables` and `normalize_probabilities`.
+ */
+class LearnerStore {
+ public:
+  /**
+   * @brief Constructor for the learner store. All memory is allocated here.
+   * @param capacity The number of slots (vehicles) to allocate.
+   */
+  explicit LearnerStore(size_t capacity);
+
+  LearnerStore(const LearnerStore&) = delete;
+  LearnerStore& operator=(const LearnerStore&) = delete;
+
+  /**
+   * @returns The number of slots in the store.
+   */
+  size_t get_capacity(void) const;
+
+  /**
+   * @brief Selects whether `submit_update` applies updates immediately or
+   * leaves them pending for the batched functions.
+   * @param deferred `true` to defer updates.
+   */
+  void set_deferred_updates(bool deferred);
+
+  /**
+   * @brief Resets every row of a slot's probability table to a uniform
+   * distribution.
+   */
+  void reset_table(size_t slot);
+
+  /**
+   * @brief Requests an update of the probability of transitioning from the
+   * slot's previous state into its current state. Applied immediately unless
+   * deferred updates are enabled.
+   * @param slot The slot to update.
+   * @param delta The change in probability. The other states in the row
+   * share the opposite change so the row keeps summing to `PROB_ONE`.
+   */
+  void submit_update(size_t slot, reward_t delta);
+
+  /**
+   * @brief Applies the pending deltas of every slot in `[begin, end)`. Rows
+   * are left un-normalized until `normalize_probabilities` is called.
+   */
+  void update_probability_tables(size_t begin, size_t end);
+
+  /**
+   * @brief Normalizes the updated row of every pending slot in `[begin, end)`
+   * and clears the pending flags. Rows are clamped to at least
+   * `LEARNER_MIN_PROB` and scaled to sum to `PROB_ONE`.
+   */
+  void normalize_probabilities(size_t begin, size_t end);
+
+  /**
+   * @brief Draws the next state in O(1) using the alias table of the row for
+   * `from`, rebuilding the table first if the row changed since it was built.
+   * @param slot The slot to sample from.
+   * @param from The state being transitioned out of.
+   * @param sample A uniform sample.
+   * @returns The drawn state.
+   */
+  StateEnum sample_state(size_t slot, StateEnum from, sample_t sample);
+
+  /**
+   * @returns A pointer to the probabilities for transitions out of `state` in
+   * the given slot, padded to `LEARNER_ROW_STRIDE` entries.
+   * @note Call `invalidate_row` after writing to the row through this pointer.
+   */
+  prob_t* get_row(size_t slot, StateEnum state);
+  const prob_t* get_row(size_t slot, StateEnum state) const;
+
+  /**
+   * @brief Marks the alias table of a row as stale so it is rebuilt before
+   * the row is sampled again.
+   */
+  void invalidate_row(size_t slot, StateEnum state);
+
+  // Per-slot accessors for the parallel arrays
+  StateEnum& curr_state(size_t slot);
+  StateEnum curr_state(size_t slot) const;
+  StateEnum& prev_state(size_t slot);
+  StateEnum prev_state(size_t slot) const;
+  vehicle_duration& time_state_entry(size_t slot);
+  LightLevels& light_lvl_entry(size_t slot);
+  LightLevels& light_lvl_curr(size_t slot);
+  const LightLevels& light_lvl_curr(size_t slot) const;
+  LightLevels& light_lvl_min(size_t slot);
+  const LightLevels& light_lvl_min(size_t slot) const;
+  LightLevels& light_lvl_max(size_t slot);
+  const LightLevels& light_lvl_max(size_t slot) const;
+  float& comms_influence(size_t slot);
+
+  // Whole-array accessors for batched kernels, indexed by slot
+  const StateEnum* get_curr_states(void) const;
+  const LightLevels* get_light_lvls_curr(void) const;
+
+ private:
+  const size_t m_capacity;
+  bool m_deferred;
+
+  // Probability tables, `NUM_STATES` padded rows of `LEARNER_ROW_STRIDE`
+  // entries per slot
+  std::unique_ptr<prob_t[]> m_tables;
+
+  // Alias tables, laid out like the probability tables, and one stale flag
+  // per row
+  std::unique_ptr<prob_t[]> m_alias_keep_prob;
+  std::unique_ptr<uint8_t[]> m_alias;
+  std::unique_ptr<bool[]> m_alias_stale;
+
+  // FSM state
+  std::unique_ptr<StateEnum[]> m_curr_state;
+  std::unique_ptr<StateEnum[]> m_prev_state;
+  std::unique_ptr<vehicle_duration[]> m_time_state_entry;
+
+  // Light levels
+  std::unique_ptr<LightLevels[]> m_light_lvl_entry;
+  std::unique_ptr<LightLevels[]> m_light_lvl_curr;
+  std::unique_ptr<LightLevels[]> m_light_lvl_min;
+  std::unique_ptr<LightLevels[]> m_light_lvl_max;
+  std::unique_ptr<float[]> m_comms_influence;
+
+  // Deferred updates, with the row and column they apply to, since the slot
+  // has moved on to its next state by the time the batched pass runs
+  std::unique_ptr<reward_t[]> m_pending_delta;
+  std::unique_ptr<StateEnum[]> m_pending_from;
+  std::unique_ptr<StateEnum[]> m_pending_to;
+  std::unique_ptr<bool[]> m_pending;
+};
@@ -0,0 +1,429 @@
+#include "MbedHal.h"
+
+#include <cstdio>
+
+#include "kvstore_global_api.h"
+
+#ifdef TARGET_STM32F4
+#include "PeripheralPins.h"
+#include "pinmap.h"
+#endif
+
+MbedLightSensor::MbedLightSensor(PinName ldr_l, PinName ldr_r,
+                                 PinName ldr_l_gnd, PinName ldr_r_gnd)
+    : m_ldr_l(ldr_l),
+      m_ldr_r(ldr_r),
+      m_ldr_l_gnd(ldr_l_gnd, 0),
+      m_ldr_r_gnd(ldr_r_gnd, 0) {
+  // Set up photoresistors
+  m_ldr_l.set_reference_voltage(3.0f);
+  m_ldr_r.set_reference_voltage(3.0f);
+}
+
+LightLevels MbedLightSensor::read(void) {
+  return {
+      .lvl_left = m_ldr_l.read(),
+      .lvl_right = m_ldr_r.read(),
+  };
+}
+
+#ifdef TARGET_STM32F4
+// ADC3 requests DMA on DMA2 stream 0 (or 1), channel 2.
+#define LDR_DMA_STREAM DMA2_Stream0
+#define LDR_DMA_IRQN DMA2_Stream0_IRQn
+
+DmaLightSensor* DmaLightSensor::s_instance = nullptr;
+
+/**
+ * @returns The ADC3 channel of `pin`. Stops with an error if it isn't an ADC3
+ * input.
+ */
+static uint32_t adc3_channel(PinName pin) {
+  for (const PinMap* map = PinMap_ADC; map->pin != NC; ++map) {
+    if (map->pin == pin && map->peripheral == ADC_3) {
+      return STM_PIN_CHANNEL(map->function);
+    }
+  }
+  error("LDR pin is not an ADC3 input\r\n");
+}
+
+DmaLightSensor::DmaLightSensor(PinName ldr_l, PinName ldr_r,
+                               PinName ldr_l_gnd, PinName ldr_r_gnd)
+    : m_ldr_l_gnd(ldr_l_gnd, 0),
+      m_ldr_r_gnd(ldr_r_gnd, 0),
+      m_hadc(),
+      m_hdma(),
+      m_filter_l(0),
+      m_filter_r(0),
+      m_primed(false),
+      m_filtered(0),
+      m_ready(false) {
+  s_instance = this;
+
+  // Set the pins to analog mode, as AnalogIn would.
+  uint32_t channel_l = adc3_channel(ldr_l);
+  uint32_t channel_r = adc3_channel(ldr_r);
+  pin_function(ldr_l, STM_PIN_DATA(STM_MODE_ANALOG, GPIO_NOPULL, 0));
+  pin_function(ldr_r, STM_PIN_DATA(STM_MODE_ANALOG, GPIO_NOPULL, 0));
+
+  __HAL_RCC_ADC3_CLK_ENABLE();
+  __HAL_RCC_DMA2_CLK_ENABLE();
+
+  // Scan both LDRs continuously, with the longest sampling time to suit the
+  // high impedance LDR dividers.
+  m_hadc.Instance = ADC3;
+  m_hadc.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV8;
+  m_hadc.Init.Resolution = ADC_RESOLUTION_12B;
+  m_hadc.Init.ScanConvMode = ENABLE;
+  m_hadc.Init.ContinuousConvMode = ENABLE;
+  m_hadc.Init.DiscontinuousConvMode = DISABLE;
+  m_hadc.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
+  m_hadc.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+  m_hadc.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+  m_hadc.Init.NbrOfConversion = 2;
+  m_hadc.Init.DMAContinuousRequests = ENABLE;
+  m_hadc.Init.EOCSelection = ADC_EOC_SEQ_CONV;
+  if (HAL_ADC_Init(&m_hadc) != HAL_OK) {
+    error("Failed to initialize ADC3\r\n");
+  }
+
+  ADC_ChannelConfTypeDef channel_config = {};
+  channel_config.SamplingTime = ADC_SAMPLETIME_480CYCLES;
+  channel_config.Channel = channel_l;
+  channel_config.Rank = 1;
+  HAL_ADC_ConfigChannel(&m_hadc, &channel_config);
+  channel_config.Channel = channel_r;
+  channel_config.Rank = 2;
+  HAL_ADC_ConfigChannel(&m_hadc, &channel_config);
+
+  // Copy the conversions into the buffer forever, with an interrupt at each
+  // half.
+  m_hdma.Instance = LDR_DMA_STREAM;
+  m_hdma.Init.Channel = DMA_CHANNEL_2;
+  m_hdma.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  m_hdma.Init.PeriphInc = DMA_PINC_DISABLE;
+  m_hdma.Init.MemInc = DMA_MINC_ENABLE;
+  m_hdma.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  m_hdma.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  m_hdma.Init.Mode = DMA_CIRCULAR;
+  m_hdma.Init.Priority = DMA_PRIORITY_LOW;
+  m_hdma.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&m_hdma) != HAL_OK) {
+    error("Failed to initialize LDR DMA\r\n");
+  }
+  __HAL_LINKDMA(&m_hadc, DMA_Handle, m_hdma);
+
+  NVIC_SetVector(LDR_DMA_IRQN,
+                 static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&dma_irq)));
+  NVIC_EnableIRQ(LDR_DMA_IRQN);
+  if (HAL_ADC_Start_DMA(&m_hadc, reinterpret_cast<uint32_t*>(m_buffer),
+                        sizeof(m_buffer) / sizeof(m_buffer[0])) != HAL_OK) {
+    error("Failed to start LDR sampling\r\n");
+  }
+
+  // Give the first block time to come in, so the very first read is real.
+  for (int i = 0; i < 10 && !m_ready; ++i) {
+    wait_us(1000);
+  }
+}
+
+LightLevels DmaLightSensor::read(void) {
+  uint32_t filtered = m_filtered.load(std::memory_order_relaxed);
+  return {
+      .lvl_left = (filtered >> 16) / FILTER_FULL_SCALE,
+      .lvl_right = (filtered & 0xFFFF) / FILTER_FULL_SCALE,
+  };
+}
+
+void DmaLightSensor::filter_block(const uint16_t* samples) {
+  uint32_t sum_l = 0;
+  uint32_t sum_r = 0;
+  for (int i = 0; i < OVERSAMPLE; ++i) {
+    sum_l += samples[2 * i];
+    sum_r += samples[2 * i + 1];
+  }
+
+  // Averages with FILTER_FRAC_BITS + 8 fractional bits
+  int32_t avg_l = (sum_l << (FILTER_FRAC_BITS + 8)) / OVERSAMPLE;
+  int32_t avg_r = (sum_r << (FILTER_FRAC_BITS + 8)) / OVERSAMPLE;
+  if (m_primed) {
+    m_filter_l += (avg_l - m_filter_l) >> IIR_SHIFT;
+    m_filter_r += (avg_r - m_filter_r) >> IIR_SHIFT;
+  } else {
+    m_filter_l = avg_l;
+    m_filter_r = avg_r;
+    m_primed = true;
+  }
+
+  m_filtered.store((static_cast<uint32_t>(m_filter_l >> 8) << 16) |
+                       static_cast<uint32_t>(m_filter_r >> 8),
+                   std::memory_order_relaxed);
+  m_ready = true;
+}
+
+void DmaLightSensor::dma_irq(void) {
+  // Handled here instead of through HAL_DMA_IRQHandler, which would only
+  // forward to the ADC's global HAL callbacks.
+  DmaLightSensor* self = s_instance;
+  uint32_t flags = DMA2->LISR;
+  DMA2->LIFCR = DMA_LIFCR_CHTIF0 | DMA_LIFCR_CTCIF0 | DMA_LIFCR_CTEIF0 |
+                DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CFEIF0;
+
+  if (flags & DMA_LISR_HTIF0) {
+    self->filter_block(&self->m_buffer[0]);
+  }
+  if (flags & DMA_LISR_TCIF0) {
+    self->filter_block(&self->m_buffer[OVERSAMPLE * 2]);
+  }
+}
+#endif
+
+MbedMotorDriver::MbedMotorDriver(PinName mtr_l_in1, PinName mtr_l_in2,
+                                 PinName mtr_r_in3, PinName mtr_r_in4,
+                                 PinName mtr_l_pwm, PinName mtr_r_pwm)
+    : m_mtr_l_in1(mtr_l_in1, 0),
+      m_mtr_l_in2(mtr_l_in2, 0),
+      m_mtr_l_pwm(mtr_l_pwm),
+      m_mtr_r_in3(mtr_r_in3, 0),
+      m_mtr_r_in4(mtr_r_in4, 0),
+      m_mtr_r_pwm(mtr_r_pwm) {
+  // Initialize PWM for drive
+  m_mtr_l_pwm.period(0.00005f);  // 1 kHz
+  m_mtr_r_pwm.period(0.00005f);
+  m_mtr_l_pwm.write(0.0f);
+  m_mtr_r_pwm.write(0.0f);
+}
+
+void MbedMotorDriver::set_motor_speeds(Direction dir_l, Direction dir_r,
+                                       float pwm_l, float pwm_r) {
+  switch (dir_l) {
+    case FORWARD:
+      m_mtr_l_in1.write(1);
+      m_mtr_l_in2.write(0);
+      break;
+    case REVERSE:
+      m_mtr_l_in1.write(0);
+      m_mtr_l_in2.write(1);
+      break;
+    case STOP:
+    default:
+      m_mtr_l_in1.write(0);
+      m_mtr_l_in2.write(0);
+      break;
+  }
+  m_mtr_l_pwm.write(pwm_l);
+
+  switch (dir_r) {
+    case FORWARD:
+      m_mtr_r_in3.write(0);
+      m_mtr_r_in4.write(1);
+      break;
+    case REVERSE:
+      m_mtr_r_in3.write(1);
+      m_mtr_r_in4.write(0);
+      break;
+    case STOP:
+    default:
+      m_mtr_r_in3.write(0);
+      m_mtr_r_in4.write(0);
+      break;
+  }
+  m_mtr_r_pwm.write(pwm_r);
+}
+
+MbedLeds::MbedLeds(PinName led_g, PinName led_r)
+    : m_g_led(led_g), m_r_led(led_r) {}
+
+void MbedLeds::set_leds(bool green, bool red) {
+  m_g_led.write(green ? 1 : 0);
+  m_r_led.write(red ? 1 : 0);
+}
+
+vehicle_duration MbedClock::now(void) const {
+  return Kernel::Clock::now().time_since_epoch();
+}
+
+// Address layout. Broadcast and group addresses share their upper four bytes,
+// so they can use pipes P2 - P5, and differ from unicast addresses in every
+// byte. The prefixes alternate bits, which the transceiver is less likely to
+// mistake for noise.
+const nrf_address NRF_UNICAST_PREFIX = 0xC2C2C20000ULL;
+const nrf_address NRF_SHARED_PREFIX = 0xA5A5A5A500ULL;
+const uint8_t NRF_BROADCAST_LSB = 0x5A;
+
+// Commands, registers and flags of the nRF24L01+ used to drain the RX FIFO,
+// and the SPI clock the driver uses
+const int NRF_CMD_R_REGISTER = 0x00;
+const int NRF_CMD_W_REGISTER = 0x20;
+const int NRF_CMD_R_RX_PAYLOAD = 0x61;
+const int NRF_CMD_NOP = 0xFF;
+const int NRF_REG_STATUS = 0x07;
+const int NRF_REG_FIFO_STATUS = 0x17;
+const int NRF_STATUS_RX_DR = 0x40;
+const int NRF_FIFO_STATUS_RX_EMPTY = 0x01;
+const int NRF_SPI_FREQUENCY = 2000000;
+
+uint16_t mbed_device_vehicle_id(void) {
+  // Fold the 96-bit unique ID into 32 bits with FNV-1a, then into 16.
+  const uint8_t* uid = reinterpret_cast<const uint8_t*>(UID_BASE);
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < 12; ++i) {
+    hash ^= uid[i];
+    hash *= 16777619u;
+  }
+  uint16_t id = static_cast<uint16_t>(hash ^ (hash >> 16));
+
+  // Stay clear of the reserved broadcast and group IDs.
+  return id < RADIO_GROUP_ID_BASE ? id : id - RADIO_GROUP_ID_BASE;
+}
+
+MbedRadio::MbedRadio(PinName nrf_mosi, PinName nrf_miso, PinName nrf_sck,
+                     PinName nrf_ncs, PinName nrf_ce, uint16_t vehicle_id,
+                     uint8_t groups, PinName nrf_irq)
+    : nrf(nrf_mosi, nrf_miso, nrf_sck, nrf_ncs, nrf_ce),
+      m_spi(nrf_mosi, nrf_miso, nrf_sck),
+      m_ncs(nrf_ncs, 1),
+      m_irq(nrf_irq != NC ? std::make_unique<InterruptIn>(nrf_irq, PullUp)
+                          : nullptr),
+      m_rx_pipes(0),
+      m_tx_address(dest_address(RADIO_BROADCAST_ID)) {
+  // Talk to the transceiver the same way the driver does
+  m_spi.format(8, 0);
+  m_spi.frequency(NRF_SPI_FREQUENCY);
+
+  // When the radio is created, set up and enable the transceiver. Setting an
+  // RX address also enables its pipe.
+  nrf.powerUp();
+  nrf.setTxAddress(m_tx_address);
+  nrf.setRxAddress(unicast_address(vehicle_id), 5, NRF24L01P_PIPE_P0);
+  nrf.setRxAddress(dest_address(RADIO_BROADCAST_ID), 5, NRF24L01P_PIPE_P1);
+  nrf.setTransferSize(MSG_SIZE, NRF24L01P_PIPE_P0);
+  nrf.setTransferSize(MSG_SIZE, NRF24L01P_PIPE_P1);
+  m_rx_pipes = 0b11;
+
+  for (int group = 1; group <= RADIO_NUM_GROUPS; ++group) {
+    if (!(groups & (1 << (group - 1)))) {
+      continue;
+    }
+
+    // Only the lowest byte is written for P2 - P5.
+    int pipe = NRF24L01P_PIPE_P1 + group;
+    nrf.setRxAddress(dest_address(radio_group_id(group)), 1, pipe);
+    nrf.setTransferSize(MSG_SIZE, pipe);
+    m_rx_pipes |= 1 << pipe;
+  }
+
+  nrf.setReceiveMode();
+  nrf.disableAutoAcknowledge();
+  nrf.enable();
+}
+
+nrf_address MbedRadio::unicast_address(uint16_t vehicle_id) {
+  return NRF_UNICAST_PREFIX | vehicle_id;
+}
+
+nrf_address MbedRadio::dest_address(uint16_t dest) {
+  if (dest == RADIO_BROADCAST_ID) {
+    return NRF_SHARED_PREFIX | NRF_BROADCAST_LSB;
+  }
+  if (dest > RADIO_GROUP_ID_BASE) {
+    return NRF_SHARED_PREFIX | (dest - RADIO_GROUP_ID_BASE);
+  }
+  return unicast_address(dest);
+}
+
+int MbedRadio::read_register(int reg) {
+  m_ncs = 0;
+  m_spi.write(NRF_CMD_R_REGISTER | reg);
+  int value = m_spi.write(NRF_CMD_NOP);
+  m_ncs = 1;
+  return value;
+}
+
+void MbedRadio::write_register(int reg, int value) {
+  m_ncs = 0;
+  m_spi.write(NRF_CMD_W_REGISTER | reg);
+  m_spi.write(value);
+  m_ncs = 1;
+}
+
+bool MbedRadio::readable(void) {
+  return !(read_register(NRF_REG_FIFO_STATUS) & NRF_FIFO_STATUS_RX_EMPTY);
+}
+
+int MbedRadio::read(char* buffer, int size) {
+  // STATUS.RX_P_NO is the pipe of the payload at the head of the RX FIFO, or
+  // 7 if the FIFO is empty. STATUS is clocked out with any command.
+  m_ncs = 0;
+  int status = m_spi.write(NRF_CMD_NOP);
+  m_ncs = 1;
+  int pipe = (status >> 1) & 0x7;
+  if (pipe > NRF24L01P_PIPE_P5 || !(m_rx_pipes & (1 << pipe))) {
+    return 0;
+  }
+
+  // Every pipe has a fixed payload width of `MSG_SIZE`, and the whole payload
+  // has to be clocked out to remove it from the FIFO.
+  int count = size < MSG_SIZE ? size : MSG_SIZE;
+  m_ncs = 0;
+  m_spi.write(NRF_CMD_R_RX_PAYLOAD);
+  for (int i = 0; i < MSG_SIZE; ++i) {
+    char value = static_cast<char>(m_spi.write(NRF_CMD_NOP));
+    if (i < count) {
+      buffer[i] = value;
+    }
+  }
+  m_ncs = 1;
+
+  // Clear RX_DR, which releases the IRQ line. Any payloads still in the FIFO
+  // are read by the following calls, without waiting for another IRQ.
+  write_register(NRF_REG_STATUS, NRF_STATUS_RX_DR);
+  return count;
+}
+
+int MbedRadio::write(const char* buffer, int size, uint16_t dest) {
+  nrf_address address = dest_address(dest);
+  if (address != m_tx_address) {
+    nrf.setTxAddress(address);
+    m_tx_address = address;
+  }
+
+  // The driver takes a non-const buffer but does not modify it. It always
+  // transmits to the TX address, whatever the pipe.
+  return nrf.write(NRF24L01P_PIPE_P0, const_cast<char*>(buffer), size);
+}
+
+bool MbedRadio::attach_irq(Callback<void()> handler) {
+  if (!m_irq) {
+    return false;
+  }
+
+  // `read` clears the RX flag and the driver clears the TX flag after each
+  // write, which releases the line for the next falling edge.
+  m_irq->fall(handler);
+  return true;
+}
+
+/**
+ * @brief Writes the full KVStore key for `key` to `full_key`.
+ */
+static void kv_full_key(const char* key, char* full_key, size_t size) {
+  snprintf(full_key, size, "/kv/%s", key);
+}
+
+int MbedKvStorage::load(const char* key, void* buffer, size_t size) {
+  char full_key[32];
+  kv_full_key(key, full_key, sizeof(full_key));
+
+  size_t actual_size = 0;
+  if (kv_get(full_key, buffer, size, &actual_size) != MBED_SUCCESS) {
+    return -1;
+  }
+  return static_cast<int>(actual_size);
+}
+
+bool MbedKvStorage::store(const char* key, const void* buffer, size_t size) {
+  char full_key[32];
+  kv_full_key(key, full_key, sizeof(full_key));
+  return kv_set(full_key, buffer, size, 0) == MBED_SUCCESS;
+}
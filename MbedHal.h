@@ -0,0 +1,259 @@
+#pragma once
+#include <atomic>
+#include <memory>
+
+#include "HalInterfaces.h"
+#include "nRF24L01P.h"
+
+using nrf_address = unsigned long long;
+
+/**
+ * @brief LDR pair read through the on-board ADC.
+ */
+class MbedLightSensor : public LightSensorInterface {
+ public:
+  /**
+   * @brief Constructor for the LDR sensor pair.
+   * @param ldr_l Pin for reading the left LDR.
+   * @param ldr_r Pin for reading the right LDR.
+   * @param ldr_l_gnd Ground pin for left LDR.
+   * @param ldr_r_gnd Ground pin for right LDR.
+   */
+  MbedLightSensor(PinName ldr_l, PinName ldr_r, PinName ldr_l_gnd,
+                  PinName ldr_r_gnd);
+
+  LightLevels read(void) override;
+
+ private:
+  AnalogIn m_ldr_l;
+  AnalogIn m_ldr_r;
+  DigitalOut m_ldr_l_gnd;
+  DigitalOut m_ldr_r_gnd;
+};
+
+#ifdef TARGET_STM32F4
+/**
+ * @brief LDR pair sampled continuously in the background. ADC3 scans both
+ * LDRs over and over, and DMA2 copies the conversions into a circular buffer.
+ * Each time half of the buffer fills, an interrupt averages it
+ * (oversampling) and feeds the averages through an IIR low-pass filter, so
+ * `read` only returns the latest filtered values without touching the ADC.
+ * @note Both LDR pins must be ADC3 inputs (e.g. PC_1 and PF_10). Only one
+ * instance may exist, and nothing else may use ADC3 (e.g. `AnalogIn` on PF_4)
+ * once it is constructed.
+ */
+class DmaLightSensor : public LightSensorInterface {
+ public:
+  /**
+   * @brief Constructor for the LDR sensor pair. Starts sampling, and waits
+   * for the first filtered values (a few milliseconds).
+   * @param ldr_l Pin for reading the left LDR.
+   * @param ldr_r Pin for reading the right LDR.
+   * @param ldr_l_gnd Ground pin for left LDR.
+   * @param ldr_r_gnd Ground pin for right LDR.
+   */
+  DmaLightSensor(PinName ldr_l, PinName ldr_r, PinName ldr_l_gnd,
+                 PinName ldr_r_gnd);
+
+  LightLevels read(void) override;
+
+ private:
+  // Samples per LDR averaged for each filter update. At 480 cycles per
+  // conversion with an 11.25 MHz ADC clock, a block takes about 2.8 ms.
+  static constexpr int OVERSAMPLE = 32;
+
+  // Each filter update moves 1/2^IIR_SHIFT of the way to the new average,
+  // giving a time constant of about 11 ms (one FSM tick).
+  static constexpr int IIR_SHIFT = 2;
+
+  // The filtered values are 12-bit conversions with 4 extra bits of
+  // precision from oversampling.
+  static constexpr int FILTER_FRAC_BITS = 4;
+  static constexpr float FILTER_FULL_SCALE = 4095.0f * (1 << FILTER_FRAC_BITS);
+
+  static DmaLightSensor* s_instance;
+
+  DigitalOut m_ldr_l_gnd;
+  DigitalOut m_ldr_r_gnd;
+  ADC_HandleTypeDef m_hadc;
+  DMA_HandleTypeDef m_hdma;
+
+  // Two halves of OVERSAMPLE scans each, left and right interleaved
+  uint16_t m_buffer[2 * OVERSAMPLE * 2];
+
+  // Filter state, kept with 8 more fractional bits than published. Only
+  // touched by the interrupt handler.
+  int32_t m_filter_l;
+  int32_t m_filter_r;
+  bool m_primed;
+
+  // Latest filtered levels, left in the upper 16 bits and right in the lower,
+  // so both are read together
+  std::atomic<uint32_t> m_filtered;
+  std::atomic<bool> m_ready;
+
+  /**
+   * @brief Averages one half of the buffer and updates the filters.
+   * @param samples The first sample of the half.
+   */
+  void filter_block(const uint16_t* samples);
+
+  /**
+   * @brief DMA2 stream 0 interrupt handler. Filters whichever half of the
+   * buffer was just filled.
+   */
+  static void dma_irq(void);
+};
+#endif
+
+/**
+ * @brief Drive motors connected through an H-bridge driver.
+ */
+class MbedMotorDriver : public MotorInterface {
+ public:
+  /**
+   * @brief Constructor for the H-bridge motor driver.
+   * @param mtr_l_in1 IN1 pin for the H-bridge driver, left side motor.
+   * @param mtr_l_in2 IN2 pin for the H-bridge driver, left side motor.
+   * @param mtr_r_in3 IN3 pin for the H-bridge driver, right side motor.
+   * @param mtr_r_in4 IN4 pin for the H-bridge driver, right side motor.
+   * @param mtr_l_pwm PWM pin for the H-bridge driver, left side motor.
+   * @param mtr_r_pwm PWM pin for the H-bridge driver, right side motor.
+   */
+  MbedMotorDriver(PinName mtr_l_in1, PinName mtr_l_in2, PinName mtr_r_in3,
+                  PinName mtr_r_in4, PinName mtr_l_pwm, PinName mtr_r_pwm);
+
+  void set_motor_speeds(Direction dir_l, Direction dir_r, float pwm_l,
+                        float pwm_r) override;
+
+ private:
+  DigitalOut m_mtr_l_in1;
+  DigitalOut m_mtr_l_in2;
+  PwmOut m_mtr_l_pwm;
+  DigitalOut m_mtr_r_in3;
+  DigitalOut m_mtr_r_in4;
+  PwmOut m_mtr_r_pwm;
+};
+
+/**
+ * @brief On-board red and green LEDs.
+ */
+class MbedLeds : public LedInterface {
+ public:
+  /**
+   * @param led_g Pin for the onboard green LED.
+   * @param led_r Pin for the onboard red LED.
+   */
+  MbedLeds(PinName led_g, PinName led_r);
+
+  void set_leds(bool green, bool red) override;
+
+ private:
+  DigitalOut m_g_led;
+  DigitalOut m_r_led;
+};
+
+/**
+ * @brief Clock backed by the RTOS kernel clock.
+ */
+class MbedClock : public ClockInterface {
+ public:
+  vehicle_duration now(void) const override;
+};
+
+/**
+ * @returns An ID for this vehicle derived from the STM32's 96-bit unique
+ * device ID, below `RADIO_GROUP_ID_BASE`. Every board gets the same ID on each
+ * boot, and different boards almost always get different IDs.
+ */
+uint16_t mbed_device_vehicle_id(void);
+
+/**
+ * @brief nRF24L01P RF transceiver. Uses the RX pipes as follows:
+ * - P0: this vehicle's unicast address, from `unicast_address`.
+ * - P1: the broadcast address shared by every vehicle.
+ * - P2 - P5: the addresses of groups 1 - 4, if joined. These share the upper
+ *   four bytes of the broadcast address, as the transceiver requires.
+ * @note The driver only reports a payload while the RX_DR flag is set, and
+ * clears the flag on every read, so payloads left in the RX FIFO behind the
+ * first one would wait for the next one to arrive. Received payloads are
+ * read with commands of our own on the driver's SPI bus instead, until the
+ * FIFO is empty.
+ */
+class MbedRadio : public RadioInterface {
+ public:
+  /**
+   * @brief Constructor for the transceiver. Sets up and enables the
+   * transceiver in receive mode.
+   * @param nrf_mosi SPI MOSI pin for the transceiver.
+   * @param nrf_miso SPI MISO pin for the transceiver.
+   * @param nrf_sck SPI SCK (clock) pin for the transceiver.
+   * @param nrf_ncs SPI NCS (chip select) pin for the transceiver.
+   * @param nrf_ce SPI CE (chip enable) pin for the transceiver.
+   * @param vehicle_id The ID of this vehicle, below `RADIO_GROUP_ID_BASE`.
+   * @param groups Bit mask of the groups to join, bit 0 for group 1 up to
+   * bit 3 for group 4.
+   * @param nrf_irq IRQ pin of the transceiver, or `NC` if it isn't connected
+   * and the transceiver has to be polled.
+   */
+  MbedRadio(PinName nrf_mosi, PinName nrf_miso, PinName nrf_sck,
+            PinName nrf_ncs, PinName nrf_ce, uint16_t vehicle_id,
+            uint8_t groups = 0, PinName nrf_irq = NC);
+
+  bool readable(void) override;
+  int read(char* buffer, int size) override;
+  int write(const char* buffer, int size, uint16_t dest) override;
+  bool attach_irq(Callback<void()> handler) override;
+
+  /**
+   * @returns The 5-byte address that `vehicle_id` receives unicast payloads
+   * on.
+   */
+  static nrf_address unicast_address(uint16_t vehicle_id);
+
+  /**
+   * @returns The 5-byte address of destination `dest`, which may be a vehicle,
+   * `RADIO_BROADCAST_ID` or a group.
+   */
+  static nrf_address dest_address(uint16_t dest);
+
+ private:
+  nRF24L01P nrf;
+
+  // The driver's SPI bus and chip select, for draining the RX FIFO
+  SPI m_spi;
+  DigitalOut m_ncs;
+
+  // The IRQ line is active low, so handlers fire on its falling edge. Only
+  // created if the pin is connected.
+  std::unique_ptr<InterruptIn> m_irq;
+
+  // Bit mask of the enabled RX pipes, bit 0 for P0
+  uint8_t m_rx_pipes;
+
+  // The TX address currently set, so it's only rewritten when the
+  // destination changes
+  nrf_address m_tx_address;
+
+  /**
+   * @returns The value of register `reg` of the transceiver.
+   */
+  int read_register(int reg);
+
+  /**
+   * @brief Writes `value` to register `reg` of the transceiver.
+   */
+  void write_register(int reg, int value);
+};
+
+/**
+ * @brief Storage in the default KVStore (`/kv/`), which is TDBStore in
+ * internal flash as configured in mbed_app.json. TDBStore appends records and
+ * only erases sectors when compacting, which spreads the wear, and a record
+ * interrupted by a power loss is discarded in favor of the previous one.
+ */
+class MbedKvStorage : public StorageInterface {
+ public:
+  int load(const char* key, void* buffer, size_t size) override;
+  bool store(const char* key, const void* buffer, size_t size) override;
+};
@@ -0,0 +1,50 @@
+#include "NeighborTable.h"
+
+void NeighborTable::update(uint16_t id, uint16_t seq) {
+  ++m_num_updates;
+
+  // Find the sender, keeping track of the stalest entry in case it's new.
+  int oldest = 0;
+  for (int i = 0; i < m_count; ++i) {
+    Neighbor& neighbor = m_neighbors[i];
+    if (neighbor.id == id) {
+      // Sequence numbers wrap, so count the gap modulo 2^16.
+      uint16_t gap = static_cast<uint16_t>(seq - neighbor.last_seq - 1);
+      if (gap < MAX_SEQ_GAP) {
+        neighbor.num_lost += gap;
+      }
+      neighbor.last_seq = seq;
+      ++neighbor.num_received;
+      neighbor.last_heard = m_num_updates;
+      return;
+    }
+    if (neighbor.last_heard < m_neighbors[oldest].last_heard) {
+      oldest = i;
+    }
+  }
+
+  // New sender: append it, or replace the stalest entry if full.
+  int index = m_count < MAX_NEIGHBORS ? m_count++ : oldest;
+  m_neighbors[index] = {
+      .id = id,
+      .last_seq = seq,
+      .num_received = 1,
+      .num_lost = 0,
+      .last_heard = m_num_updates,
+  };
+}
+
+int NeighborTable::get_count(void) const { return m_count; }
+
+const Neighbor& NeighborTable::get(int index) const {
+  return m_neighbors[index];
+}
+
+const Neighbor* NeighborTable::find(uint16_t id) const {
+  for (int i = 0; i < m_count; ++i) {
+    if (m_neighbors[i].id == id) {
+      return &m_neighbors[i];
+    }
+  }
+  return nullptr;
+}
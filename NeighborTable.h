@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+
+#include "Globals.h"
+
+/**
+ * @brief What is known about another vehicle heard on the radio.
+ * @param id The vehicle's ID.
+ * @param last_seq The sequence number of the last payload received from it.
+ * @param num_received The number of payloads received from it.
+ * @param num_lost The number of payloads missed, going by gaps in the
+ * sequence numbers.
+ * @param last_heard The value of the table's payload counter when it was last
+ * heard, for ageing.
+ */
+struct Neighbor {
+  uint16_t id;
+  uint16_t last_seq;
+  uint32_t num_received;
+  uint32_t num_lost;
+  uint32_t last_heard;
+};
+
+/**
+ * @brief Fixed size table of the vehicles heard on the radio. When it is full,
+ * the neighbor heard least recently is replaced, so it always holds the most
+ * active `MAX_NEIGHBORS` vehicles in range.
+ * @note Not thread safe. Only updated and read by the comms thread.
+ */
+class NeighborTable {
+ public:
+  /**
+   * @brief Records a payload received from vehicle `id`.
+   * @param id The ID of the sender.
+   * @param seq The sequence number of the payload.
+   */
+  void update(uint16_t id, uint16_t seq);
+
+  /**
+   * @returns The number of neighbors in the table.
+   */
+  int get_count(void) const;
+
+  /**
+   * @returns The neighbor at `index` (from 0 - `get_count()`, exclusive), in
+   * no particular order.
+   */
+  const Neighbor& get(int index) const;
+
+  /**
+   * @returns The neighbor with ID `id`, or `nullptr` if it isn't in the table.
+   */
+  const Neighbor* find(uint16_t id) const;
+
+ private:
+  // Sequence gaps larger than this are taken as the sender restarting rather
+  // than as lost payloads.
+  static constexpr uint16_t MAX_SEQ_GAP = 256;
+
+  Neighbor m_neighbors[MAX_NEIGHBORS];
+  int m_count = 0;
+  uint32_t m_num_updates = 0;
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * @brief PCG32 (PCG-XSH-RR with 64-bit state) pseudo-random number generator.
+ * Each generator is seeded with a seed and a stream: generators with the same
+ * seed but different streams produce independent, uncorrelated sequences, so
+ * every vehicle gets its own stream without sharing state with the others.
+ * A draw is one 64-bit multiply-add and a few shifts, and the whole state is
+ * 16 bytes.
+ * @note Not thread-safe. Give each thread (or vehicle) its own generator.
+ */
+class Pcg32 {
+ public:
+  /**
+   * @param seed The starting point within the stream.
+   * @param stream Selects one of 2^63 independent streams.
+   */
+  explicit Pcg32(uint64_t seed = 0, uint64_t stream = 0) {
+    this->seed(seed, stream);
+  }
+
+  /**
+   * @brief Restarts the generator, as if newly constructed.
+   */
+  void seed(uint64_t seed, uint64_t stream) {
+    m_state = 0;
+    m_inc = (stream << 1) | 1u;
+    next();
+    m_state += seed;
+    next();
+  }
+
+  /**
+   * @returns 32 uniformly distributed random bits.
+   */
+  uint32_t next(void) {
+    uint64_t old_state = m_state;
+    m_state = old_state * MULTIPLIER + m_inc;
+    uint32_t xorshifted =
+        static_cast<uint32_t>(((old_state >> 18) ^ old_state) >> 27);
+    uint32_t rot = static_cast<uint32_t>(old_state >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31));
+  }
+
+  /**
+   * @returns A uniform float from 0.0 - 1.0 (exclusive).
+   */
+  float next_float(void) { return to_unit_float(next()); }
+
+  /**
+   * @brief Skips the next `delta` draws in O(log `delta`), e.g. to split one
+   * stream into non-overlapping blocks.
+   */
+  void advance(uint64_t delta) {
+    // Brown, "Random Number Generation with Arbitrary Strides": compose the
+    // affine step x -> a * x + c with itself by squaring.
+    uint64_t acc_mult = 1;
+    uint64_t acc_plus = 0;
+    uint64_t cur_mult = MULTIPLIER;
+    uint64_t cur_plus = m_inc;
+    while (delta > 0) {
+      if (delta & 1) {
+        acc_mult *= cur_mult;
+        acc_plus = acc_plus * cur_mult + cur_plus;
+      }
+      cur_plus = (cur_mult + 1) * cur_plus;
+      cur_mult *= cur_mult;
+      delta >>= 1;
+    }
+    m_state = acc_mult * m_state + acc_plus;
+  }
+
+  /**
+   * @returns The top 24 bits of `bits` as a uniform float from 0.0 - 1.0
+   * (exclusive). Every value is exactly representable, so the result is the
+   * same on every platform.
+   */
+  static float to_unit_float(uint32_t bits) {
+    return static_cast<float>(bits >> 8) * (1.0f / 16777216.0f);
+  }
+
+ private:
+  static constexpr uint64_t MULTIPLIER = 6364136223846793005ull;
+
+  uint64_t m_state;
+  uint64_t m_inc;
+};
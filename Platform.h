@@ -0,0 +1,10 @@
+#pragma once
+
+// Selects the platform headers. Firmware builds use Mbed OS, while host
+// builds (compiled with `HOST_SIM` defined) use the shims in `sim/` so the FSM
+// and learning code can run on a regular Linux machine.
+#ifdef HOST_SIM
+#include "sim/HostPlatform.h"
+#else
+#include "mbed.h"
+#endif
@@ -0,0 +1,129 @@
+#include "Profiler.h"
+
+#include <cstdio>
+
+/**
+ * @returns The histogram bucket of a measurement of `ticks`.
+ */
+static inline int profile_bucket(uint32_t ticks) {
+  return ticks > 0 ? 31 - __builtin_clz(ticks) : 0;
+}
+
+void ProfileCounter::record(uint32_t ticks) {
+  uint32_t seq = m_seq.load(std::memory_order_relaxed);
+  m_seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // Only this thread writes, so plain loads and stores are enough and no
+  // read-modify-write instructions are needed.
+  m_count.store(m_count.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+  if (ticks < m_min.load(std::memory_order_relaxed)) {
+    m_min.store(ticks, std::memory_order_relaxed);
+  }
+  if (ticks > m_max.load(std::memory_order_relaxed)) {
+    m_max.store(ticks, std::memory_order_relaxed);
+  }
+  uint32_t sum_lo = m_sum_lo.load(std::memory_order_relaxed) + ticks;
+  m_sum_lo.store(sum_lo, std::memory_order_relaxed);
+  if (sum_lo < ticks) {
+    m_sum_hi.store(m_sum_hi.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+  }
+  if (m_budget > 0 && ticks > m_budget) {
+    m_overruns.store(m_overruns.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+  }
+  std::atomic<uint32_t>& bucket = m_histogram[profile_bucket(ticks)];
+  bucket.store(bucket.load(std::memory_order_relaxed) + 1,
+               std::memory_order_relaxed);
+
+  m_seq.store(seq + 2, std::memory_order_release);
+}
+
+void ProfileCounter::set_budget(uint32_t ticks) { m_budget = ticks; }
+
+bool ProfileCounter::try_read(ProfileStats& out) const {
+  for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt) {
+    uint32_t seq = m_seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+      continue;
+    }
+
+    out.count = m_count.load(std::memory_order_relaxed);
+    out.min = m_min.load(std::memory_order_relaxed);
+    out.max = m_max.load(std::memory_order_relaxed);
+    out.sum = (static_cast<uint64_t>(m_sum_hi.load(std::memory_order_relaxed))
+               << 32) |
+              m_sum_lo.load(std::memory_order_relaxed);
+    out.overruns = m_overruns.load(std::memory_order_relaxed);
+    for (int i = 0; i < PROFILE_NUM_BUCKETS; ++i) {
+      out.histogram[i] = m_histogram[i].load(std::memory_order_relaxed);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (m_seq.load(std::memory_order_relaxed) != seq) {
+      continue;
+    }
+
+    if (out.count == 0) {
+      out.min = 0;
+    }
+    return true;
+  }
+  return false;
+}
+
+// Names of the `execute` points, in `StateEnum` order
+#define EXECUTE_STATE_NAME(name, Node) "execute_" #name,
+#define EXECUTE_BEHAVIOR_NAME(name) "execute_" #name,
+static const char* const EXECUTE_NAMES[NUM_STATES] = {
+    VEHICLE_STATES(EXECUTE_STATE_NAME, EXECUTE_BEHAVIOR_NAME)};
+#undef EXECUTE_STATE_NAME
+#undef EXECUTE_BEHAVIOR_NAME
+
+const char* Profiler::get_name(ProfilePoint point) {
+  if (point >= PROFILE_EXECUTE && point < PROFILE_TRANSITION) {
+    return EXECUTE_NAMES[point - PROFILE_EXECUTE];
+  }
+
+  switch (point) {
+    case PROFILE_FSM_CYCLE:
+      return "fsm_cycle";
+    case PROFILE_READ_SENSORS:
+      return "read_sensors";
+    case PROFILE_TRANSITION:
+      return "transition";
+    case PROFILE_FSM_WAKE:
+      return "fsm_wake";
+    case PROFILE_COMMS_CYCLE:
+      return "comms_cycle";
+    default:
+      return "unknown";
+  }
+}
+
+void Profiler::print_report(void) const {
+  // Floats keep sub-microsecond resolution at any clock rate
+  float us_per_tick = 1.0f / static_cast<float>(profile_ticks_per_us());
+  for (int i = 0; i < NUM_PROFILE_POINTS; ++i) {
+    ProfilePoint point = static_cast<ProfilePoint>(i);
+    ProfileStats stats;
+    if (!get(point).try_read(stats) || stats.count == 0) {
+      continue;
+    }
+
+    printf("%-18s n=%lu min=%.2fus mean=%.2fus max=%.2fus overruns=%lu |",
+           get_name(point), (unsigned long)stats.count,
+           stats.min * us_per_tick, stats.mean() * us_per_tick,
+           stats.max * us_per_tick, (unsigned long)stats.overruns);
+    for (int b = 0; b < PROFILE_NUM_BUCKETS; ++b) {
+      if (stats.histogram[b] > 0) {
+        // Upper bound of the bucket, 2^(b + 1) ticks
+        float bound = static_cast<float>(2ULL << b) * us_per_tick;
+        printf(" <%.2f:%lu", bound, (unsigned long)stats.histogram[b]);
+      }
+    }
+    printf("\r\n");
+  }
+}
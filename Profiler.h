@@ -0,0 +1,237 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "Globals.h"
+#include "StateRegistry.h"
+
+#ifdef HOST_SIM
+#include <chrono>
+#endif
+
+/*
+ * Hot-path profiling. Code sections are timed in "ticks" of the fastest
+ * counter available: the DWT cycle counter on Cortex-M3 and up, the
+ * microsecond ticker on cores without one, and `std::chrono::steady_clock`
+ * nanoseconds on the host. Tick counts are 32 bits and wrap, so a single
+ * measurement must be shorter than 2^32 ticks (about 23 s at 180 MHz, 4 s on
+ * the host).
+ */
+
+#if !defined(HOST_SIM) && defined(DWT_CTRL_CYCCNTENA_Msk)
+#define PROFILE_DWT 1
+#elif !defined(HOST_SIM)
+#include "hal/us_ticker_api.h"
+#endif
+
+/**
+ * @brief Starts the tick counter. Call once before profiling.
+ */
+inline void profile_init(void) {
+#ifdef PROFILE_DWT
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+/**
+ * @returns The current value of the tick counter.
+ */
+inline uint32_t profile_now(void) {
+#if defined(HOST_SIM)
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+#elif defined(PROFILE_DWT)
+  return DWT->CYCCNT;
+#else
+  return us_ticker_read();
+#endif
+}
+
+/**
+ * @returns The number of ticks per microsecond.
+ */
+inline uint32_t profile_ticks_per_us(void) {
+#if defined(HOST_SIM)
+  return 1000;
+#elif defined(PROFILE_DWT)
+  return SystemCoreClock / 1000000;
+#else
+  return 1;
+#endif
+}
+
+/**
+ * @returns `duration` in ticks, e.g. for `ProfileCounter::set_budget`.
+ */
+inline uint32_t profile_ticks(vehicle_duration duration) {
+  return static_cast<uint32_t>(duration.count()) * 1000 *
+         profile_ticks_per_us();
+}
+
+/**
+ * The number of histogram buckets. Bucket `i` counts measurements from 2^i
+ * up to 2^(i + 1) ticks (exclusive), and bucket 0 also counts 0 ticks.
+ */
+const int PROFILE_NUM_BUCKETS = 32;
+
+/**
+ * @brief Statistics of a `ProfileCounter`, in ticks.
+ * @param count The number of measurements.
+ * @param min The shortest measurement, or 0 if there are none.
+ * @param max The longest measurement.
+ * @param sum The sum of all measurements.
+ * @param overruns The number of measurements over the budget.
+ * @param histogram The number of measurements in each log2 bucket.
+ */
+struct ProfileStats {
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t sum;
+  uint32_t overruns;
+  std::array<uint32_t, PROFILE_NUM_BUCKETS> histogram;
+
+  /**
+   * @returns The mean measurement, or 0 if there are none.
+   */
+  uint32_t mean(void) const {
+    return count > 0 ? static_cast<uint32_t>(sum / count) : 0;
+  }
+};
+
+/**
+ * @brief Running statistics of how long one code section takes: min, max,
+ * mean, a log2 histogram, and how often it ran over a budget.
+ * @note Lock-free for one writer and any number of reader threads. `record`
+ * must only be called by one thread.
+ */
+class ProfileCounter {
+ public:
+  /**
+   * @brief Writer only. Adds a measurement.
+   * @param ticks How long the section took.
+   */
+  void record(uint32_t ticks);
+
+  /**
+   * @brief Sets the budget measurements are counted as overruns above, e.g.
+   * the tick period of a loop. Call before recording starts.
+   * @param ticks The budget, or 0 for none.
+   */
+  void set_budget(uint32_t ticks);
+
+  /**
+   * @brief Copies the statistics.
+   * @param out Written with the statistics.
+   * @returns `true` if `out` was written, or `false` if the writer kept
+   * recording while they were being copied.
+   */
+  bool try_read(ProfileStats& out) const;
+
+ private:
+  // Attempts at a consistent copy before `try_read` gives up, so a reader
+  // never spins on a writer it preempted.
+  static constexpr int MAX_READ_ATTEMPTS = 4;
+
+  uint32_t m_budget = 0;
+
+  // Sequence lock like the one of InfluenceAggregator: odd while the writer
+  // is recording. 64 bit atomics aren't lock-free on Cortex-M, so the sum is
+  // kept in two halves.
+  std::atomic<uint32_t> m_seq{0};
+  std::atomic<uint32_t> m_count{0};
+  std::atomic<uint32_t> m_min{UINT32_MAX};
+  std::atomic<uint32_t> m_max{0};
+  std::atomic<uint32_t> m_sum_lo{0};
+  std::atomic<uint32_t> m_sum_hi{0};
+  std::atomic<uint32_t> m_overruns{0};
+  std::array<std::atomic<uint32_t>, PROFILE_NUM_BUCKETS> m_histogram{};
+};
+
+/**
+ * @brief The code sections the FSM and comms threads are profiled in.
+ */
+enum ProfilePoint : uint8_t {
+  // The whole of `VehicleContext::run_fsm_cycle`
+  PROFILE_FSM_CYCLE = 0,
+  // `VehicleContext::read_sensors`
+  PROFILE_READ_SENSORS,
+  // `execute` of each state, including any transition it makes, one point
+  // per state in `StateEnum` order (see `profile_execute`)
+  PROFILE_EXECUTE,
+  // `VehicleContext::transition_to`
+  PROFILE_TRANSITION = PROFILE_EXECUTE + NUM_STATES,
+  // How late the FSM thread woke for a tick, measured in main.cpp
+  PROFILE_FSM_WAKE,
+  // `CommsContext::run_comms_cycle`
+  PROFILE_COMMS_CYCLE,
+  NUM_PROFILE_POINTS,
+};
+
+/**
+ * @returns The point `execute` of `state` is profiled in.
+ */
+constexpr ProfilePoint profile_execute(StateEnum state) {
+  return static_cast<ProfilePoint>(PROFILE_EXECUTE + state);
+}
+
+/**
+ * @brief One `ProfileCounter` per `ProfilePoint`.
+ * @note Each point is only recorded by the thread running its section.
+ */
+class Profiler {
+ public:
+  /**
+   * @returns The counter of `point`.
+   */
+  ProfileCounter& get(ProfilePoint point) { return m_counters[point]; }
+  const ProfileCounter& get(ProfilePoint point) const {
+    return m_counters[point];
+  }
+
+  /**
+   * @returns The name of `point`, for reports.
+   */
+  static const char* get_name(ProfilePoint point);
+
+  /**
+   * @brief Prints the statistics of every point that was recorded with
+   * `printf`, converted to microseconds. The histogram lists the upper bound
+   * of each non-empty bucket and its count.
+   */
+  void print_report(void) const;
+
+ private:
+  std::array<ProfileCounter, NUM_PROFILE_POINTS> m_counters;
+};
+
+/**
+ * @brief Times its own scope into a point of a profiler, if there is one.
+ */
+class ProfileScope {
+ public:
+  /**
+   * @param profiler The profiler to record into, or `nullptr` to do nothing.
+   * @param point The point to record.
+   */
+  ProfileScope(Profiler* profiler, ProfilePoint point)
+      : m_counter(profiler != nullptr ? &profiler->get(point) : nullptr),
+        m_start(m_counter != nullptr ? profile_now() : 0) {}
+
+  ~ProfileScope() {
+    if (m_counter != nullptr) {
+      m_counter->record(profile_now() - m_start);
+    }
+  }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+ private:
+  ProfileCounter* m_counter;
+  uint32_t m_start;
+};
@@ -0,0 +1,171 @@
+#include "RunRecorder.h"
+
+#include <algorithm>
+
+#include "LearnerSnapshot.h"
+#include "TraceRecorder.h"
+
+static inline void write_u32(uint8_t* dst, uint32_t value) {
+  dst[0] = static_cast<uint8_t>(value);
+  dst[1] = static_cast<uint8_t>(value >> 8);
+  dst[2] = static_cast<uint8_t>(value >> 16);
+  dst[3] = static_cast<uint8_t>(value >> 24);
+}
+
+static inline void write_float(uint8_t* dst, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  write_u32(dst, bits);
+}
+
+static inline void write_time(uint8_t* dst, vehicle_duration time) {
+  write_u32(dst, static_cast<uint32_t>(time.count()));
+}
+
+size_t run_encode(const RunRecord& record, uint8_t* frame) {
+  frame[0] = RUN_SYNC;
+  frame[1] = record.type;
+  frame[2] = record.stream;
+  frame[3] = record.size;
+  memcpy(&frame[4], record.data, record.size);
+  frame[4 + record.size] = crc8(&frame[1], 3 + record.size);
+  return RUN_FRAME_OVERHEAD + record.size;
+}
+
+size_t run_decode(const uint8_t* frame, size_t size, RunRecord& out) {
+  if (size < RUN_FRAME_OVERHEAD || frame[0] != RUN_SYNC ||
+      frame[3] > RUN_MAX_PAYLOAD) {
+    return 0;
+  }
+  uint8_t payload_size = frame[3];
+  if (size < static_cast<size_t>(RUN_FRAME_OVERHEAD + payload_size) ||
+      frame[4 + payload_size] != crc8(&frame[1], 3 + payload_size)) {
+    return 0;
+  }
+
+  out.type = static_cast<RunRecordType>(frame[1]);
+  out.stream = static_cast<RunStream>(frame[2]);
+  out.size = payload_size;
+  memcpy(out.data, &frame[4], payload_size);
+  return RUN_FRAME_OVERHEAD + payload_size;
+}
+
+RunRecorder::RunRecorder(RunStream stream) : m_stream(stream) {}
+
+void RunRecorder::record(RunRecordType type, const void* data, size_t size) {
+  RunRecord* slot = m_ring.try_claim();
+  if (slot == nullptr) {
+    m_num_lost.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  slot->type = type;
+  slot->stream = m_stream;
+  slot->size = static_cast<uint8_t>(size);
+  memcpy(slot->data, data, size);
+  m_ring.publish();
+}
+
+void RunRecorder::record_seed(uint32_t seed) {
+  uint8_t data[4];
+  write_u32(data, seed);
+  record(RUN_SEED, data, sizeof(data));
+}
+
+void RunRecorder::record_start(const RunStart& start,
+                               const uint8_t* snapshot) {
+  uint8_t data[24];
+  data[0] = static_cast<uint8_t>(start.vehicle_id);
+  data[1] = static_cast<uint8_t>(start.vehicle_id >> 8);
+  data[2] = start.curr_state;
+  data[3] = start.prev_state;
+  write_time(&data[4], start.time_state_entry);
+  write_float(&data[8], start.light_lvl_entry.lvl_left);
+  write_float(&data[12], start.light_lvl_entry.lvl_right);
+  write_float(&data[16], start.light_lvl_curr.lvl_left);
+  write_float(&data[20], start.light_lvl_curr.lvl_right);
+  record(RUN_START, data, sizeof(data));
+
+  for (int offset = 0; offset < SNAPSHOT_SIZE; offset += RUN_MAX_PAYLOAD) {
+    record(RUN_SNAPSHOT, &snapshot[offset],
+           std::min(RUN_MAX_PAYLOAD, SNAPSHOT_SIZE - offset));
+  }
+}
+
+void RunRecorder::record_cycle(vehicle_duration time) {
+  uint8_t data[4];
+  write_time(data, time);
+  record(RUN_CYCLE, data, sizeof(data));
+}
+
+void RunRecorder::record_clock(vehicle_duration time) {
+  uint8_t data[4];
+  write_time(data, time);
+  record(RUN_CLOCK, data, sizeof(data));
+}
+
+void RunRecorder::record_sensors(LightLevels levels) {
+  uint8_t data[8];
+  write_float(&data[0], levels.lvl_left);
+  write_float(&data[4], levels.lvl_right);
+  record(RUN_SENSORS, data, sizeof(data));
+}
+
+void RunRecorder::record_random(uint32_t value) {
+  uint8_t data[4];
+  write_u32(data, value);
+  record(RUN_RANDOM, data, sizeof(data));
+}
+
+void RunRecorder::record_influence(bool read,
+                                   const InfluenceSummary& summary) {
+  uint8_t data[1 + 2 * NUM_STATES * 4];
+  data[0] = read ? 1 : 0;
+  for (int i = 0; i < NUM_STATES; ++i) {
+    write_float(&data[1 + 4 * i], summary.delta_sum[i]);
+    write_float(&data[1 + 4 * (NUM_STATES + i)], summary.weight[i]);
+  }
+  record(RUN_INFLUENCE, data, sizeof(data));
+}
+
+void RunRecorder::record_rx(vehicle_duration time, const char* payload) {
+  uint8_t data[4 + MSG_SIZE];
+  write_time(data, time);
+  memcpy(&data[4], payload, MSG_SIZE);
+  record(RUN_RX, data, sizeof(data));
+}
+
+size_t RunRecorder::drain(uint8_t* buffer, size_t size) {
+  size_t written = 0;
+  while (written + RUN_MAX_FRAME_SIZE <= size) {
+    RunRecord record;
+    if (!m_format_sent) {
+#ifdef LEARNER_FIXED_POINT
+      uint8_t fixed_point = 1;
+#else
+      uint8_t fixed_point = 0;
+#endif
+      record.type = RUN_FORMAT;
+      record.size = 3;
+      record.data[0] = RUN_FORMAT_VERSION;
+      record.data[1] = NUM_STATES;
+      record.data[2] = fixed_point;
+      m_format_sent = true;
+    } else if (!m_ring.try_pop(record)) {
+      uint32_t num_lost = m_num_lost.load(std::memory_order_relaxed);
+      if (num_lost == m_num_lost_reported) {
+        break;
+      }
+      record.type = RUN_OVERFLOW;
+      record.size = 4;
+      write_u32(record.data, num_lost - m_num_lost_reported);
+      m_num_lost_reported = num_lost;
+    }
+
+    record.stream = m_stream;
+    written += run_encode(record, &buffer[written]);
+  }
+  return written;
+}
+
+uint32_t RunRecorder::get_num_lost(void) const { return m_num_lost; }
@@ -0,0 +1,220 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "Globals.h"
+#include "InfluenceAggregator.h"
+#include "SpscRing.h"
+
+/**
+ * @brief Kinds of run records. Together, the records of the FSM stream hold
+ * every input the FSM took from outside the learner, in the order it took
+ * them, so a replay can feed them back and reproduce the run exactly. Payload
+ * fields are little endian, and floats are stored as their raw bits.
+ */
+enum RunRecordType : uint8_t {
+  // u8 format version, u8 NUM_STATES, u8 1 if probabilities are Q15 or 0 if
+  // floats. Sent by the drain first.
+  RUN_FORMAT = 0,
+  // u32 the seed of the vehicle's random stream
+  RUN_SEED,
+  // u16 vehicle ID, u8 current state, u8 previous state, u32 time the
+  // current state was entered, 2 floats light levels on entry, 2 floats
+  // current light levels. Followed by the learner snapshot in `RUN_SNAPSHOT`
+  // records.
+  RUN_START,
+  // The next chunk of a learner snapshot (see LearnerSnapshot.h)
+  RUN_SNAPSHOT,
+  // u32 the time an FSM cycle started
+  RUN_CYCLE,
+  // u32 the time read by the FSM
+  RUN_CLOCK,
+  // 2 floats, the raw left and right LDR levels
+  RUN_SENSORS,
+  // u32 a random draw from the vehicle's random stream
+  RUN_RANDOM,
+  // u8 1 if the influence summary was read or 0 if not, then NUM_STATES
+  // floats delta_sum and NUM_STATES floats weight
+  RUN_INFLUENCE,
+  // u32 the time a payload was received, then the MSG_SIZE byte payload
+  RUN_RX,
+  // u32 the number of records lost to a full ring since the last
+  // RUN_OVERFLOW
+  RUN_OVERFLOW,
+};
+
+/**
+ * @brief The recorder a record comes from. The FSM and comms threads record
+ * separately, and their records are interleaved in the stream.
+ */
+enum RunStream : uint8_t {
+  RUN_STREAM_FSM = 0,
+  RUN_STREAM_COMMS,
+};
+
+const int RUN_MAX_PAYLOAD = 48;
+
+static_assert(1 + 2 * NUM_STATES * sizeof(float) <= RUN_MAX_PAYLOAD,
+              "influence records must fit in a run record");
+static_assert(4 + MSG_SIZE <= RUN_MAX_PAYLOAD,
+              "received payloads must fit in a run record");
+
+/**
+ * @brief One run record.
+ */
+struct RunRecord {
+  RunRecordType type;
+  RunStream stream;
+  uint8_t size;
+  uint8_t data[RUN_MAX_PAYLOAD];
+};
+
+/*
+ * Each record is streamed as a frame of 5 - 53 bytes:
+ *
+ *   offset  size  field
+ *   0       1     sync byte, `RUN_SYNC`
+ *   1       1     type
+ *   2       1     stream
+ *   3       1     payload size
+ *   4       size  payload
+ *   4+size  1     CRC-8 (polynomial 0x07) of bytes 1 - 3+size
+ *
+ * Unlike a trace, a recording is only useful if it is complete, so decoders
+ * stop at the first corrupt frame instead of resyncing.
+ */
+
+const uint8_t RUN_SYNC = 0x5A;
+const uint8_t RUN_FORMAT_VERSION = 1;
+const int RUN_FRAME_OVERHEAD = 5;
+const int RUN_MAX_FRAME_SIZE = RUN_FRAME_OVERHEAD + RUN_MAX_PAYLOAD;
+
+/**
+ * @returns The u32 at `offset` in the payload of `record`.
+ */
+inline uint32_t run_get_u32(const RunRecord& record, size_t offset) {
+  const uint8_t* src = &record.data[offset];
+  return static_cast<uint32_t>(src[0]) | (static_cast<uint32_t>(src[1]) << 8) |
+         (static_cast<uint32_t>(src[2]) << 16) |
+         (static_cast<uint32_t>(src[3]) << 24);
+}
+
+/**
+ * @returns The float at `offset` in the payload of `record`.
+ */
+inline float run_get_float(const RunRecord& record, size_t offset) {
+  uint32_t bits = run_get_u32(record, offset);
+  float result;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+/**
+ * @brief Writes `record` as a frame to `frame`, `RUN_FRAME_OVERHEAD` bytes
+ * plus the payload size.
+ * @returns The size of the frame in bytes.
+ */
+size_t run_encode(const RunRecord& record, uint8_t* frame);
+
+/**
+ * @brief Decodes the frame at the start of `size` bytes at `frame`.
+ * @returns The size of the frame in bytes, in which case `out` is written,
+ * or 0 if there isn't a whole frame with a sync byte and a matching CRC.
+ */
+size_t run_decode(const uint8_t* frame, size_t size, RunRecord& out);
+
+/**
+ * @brief The FSM's state when recording starts, which a replay starts from.
+ */
+struct RunStart {
+  uint16_t vehicle_id;
+  StateEnum curr_state;
+  StateEnum prev_state;
+  vehicle_duration time_state_entry;
+  LightLevels light_lvl_entry;
+  LightLevels light_lvl_curr;
+};
+
+/**
+ * @brief Records the inputs of a vehicle run: sensor samples, clock reads,
+ * random draws, the influence read from the comms thread and the payloads it
+ * received, so the run can be replayed on the host. Like `TraceRecorder`,
+ * recording only pushes onto a lock-free ring, and a low priority drain
+ * streams the records out later. Records lost to a full ring are counted and
+ * reported with a `RUN_OVERFLOW` record, and a replay stops there.
+ * @note One thread may record and one other thread may drain. Give each
+ * recording thread its own recorder.
+ */
+class RunRecorder {
+ public:
+  /**
+   * @param stream The stream the records belong to.
+   */
+  explicit RunRecorder(RunStream stream);
+
+  void record_seed(uint32_t seed);
+
+  /**
+   * @brief Records where the FSM starts from, then `snapshot` in chunks.
+   * @param snapshot The learner snapshot, `SNAPSHOT_SIZE` bytes.
+   */
+  void record_start(const RunStart& start, const uint8_t* snapshot);
+
+  void record_cycle(vehicle_duration time);
+  void record_clock(vehicle_duration time);
+  void record_sensors(LightLevels levels);
+  void record_random(uint32_t value);
+  void record_influence(bool read, const InfluenceSummary& summary);
+  void record_rx(vehicle_duration time, const char* payload);
+
+  /**
+   * @brief Draining thread only. Encodes waiting records as frames, starting
+   * with a `RUN_FORMAT` record, and ending with a `RUN_OVERFLOW` record if
+   * records were lost.
+   * @param buffer The buffer to write frames to.
+   * @param size The size of `buffer` in bytes, at least `RUN_MAX_FRAME_SIZE`.
+   * @returns The number of bytes written.
+   */
+  size_t drain(uint8_t* buffer, size_t size);
+
+  /**
+   * @returns The number of records lost to a full ring so far.
+   */
+  uint32_t get_num_lost(void) const;
+
+ private:
+  const RunStream m_stream;
+  SpscRing<RunRecord, RUN_RING_SIZE> m_ring;
+  std::atomic<uint32_t> m_num_lost{0};
+
+  // Only touched by the draining thread
+  uint32_t m_num_lost_reported = 0;
+  bool m_format_sent = false;
+
+  /**
+   * @brief Recording thread only. Records `size` bytes of payload at `data`.
+   */
+  void record(RunRecordType type, const void* data, size_t size);
+};
+
+/**
+ * @brief Supplies the FSM's inputs from a recording instead of the hardware,
+ * the comms thread and the vehicle's random stream. Implemented by the host
+ * replay engine.
+ */
+class RunInputSource {
+ public:
+  virtual ~RunInputSource() = default;
+
+  virtual vehicle_duration take_clock(void) = 0;
+  virtual LightLevels take_sensors(void) = 0;
+  virtual uint32_t take_random(void) = 0;
+
+  /**
+   * @param out Written with the recorded summary.
+   * @returns Whether the summary could be read when it was recorded.
+   */
+  virtual bool take_influence(InfluenceSummary& out) = 0;
+};
@@ -0,0 +1,114 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring buffer of `N`
+ * elements. One thread may produce and one other thread may consume at the
+ * same time without locks or RTOS calls, so either side may also be an ISR.
+ *
+ * Besides copying in and out with `try_push` and `try_pop`, both sides can
+ * work on elements in place: the producer fills the slot returned by
+ * `try_claim` and then calls `publish`, and the consumer inspects the element
+ * returned by `try_borrow` and then calls `release`.
+ *
+ * @tparam T The element type.
+ * @tparam N The capacity, a power of two.
+ */
+template <typename T, uint32_t N>
+class SpscRing {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+ public:
+  /**
+   * @brief Producer only. Gets the next free slot without publishing it.
+   * @returns The slot to fill, or `nullptr` if the ring is full. Calling it
+   * again before `publish` returns the same slot.
+   */
+  T* try_claim(void) {
+    uint32_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) == N) {
+      return nullptr;
+    }
+    return &m_slots[head & (N - 1)];
+  }
+
+  /**
+   * @brief Producer only. Makes the slot from the last `try_claim` visible to
+   * the consumer.
+   */
+  void publish(void) {
+    m_head.store(m_head.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_release);
+  }
+
+  /**
+   * @brief Producer only. Copies `value` into the ring.
+   * @returns `true` if it was pushed, or `false` if the ring is full.
+   */
+  bool try_push(const T& value) {
+    T* slot = try_claim();
+    if (slot == nullptr) {
+      return false;
+    }
+    *slot = value;
+    publish();
+    return true;
+  }
+
+  /**
+   * @brief Consumer only. Gets the oldest element without removing it.
+   * @returns The element, valid until `release`, or `nullptr` if the ring is
+   * empty.
+   */
+  const T* try_borrow(void) {
+    uint32_t tail = m_tail.load(std::memory_order_relaxed);
+    if (m_head.load(std::memory_order_acquire) == tail) {
+      return nullptr;
+    }
+    return &m_slots[tail & (N - 1)];
+  }
+
+  /**
+   * @brief Consumer only. Removes the element from the last `try_borrow`,
+   * handing its slot back to the producer.
+   */
+  void release(void) {
+    m_tail.store(m_tail.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_release);
+  }
+
+  /**
+   * @brief Consumer only. Copies the oldest element to `out` and removes it.
+   * @returns `true` if an element was popped, or `false` if the ring is empty.
+   */
+  bool try_pop(T& out) {
+    const T* slot = try_borrow();
+    if (slot == nullptr) {
+      return false;
+    }
+    out = *slot;
+    release();
+    return true;
+  }
+
+  /**
+   * @returns The number of elements in the ring. Only a snapshot when called
+   * while the other side is active.
+   */
+  uint32_t size(void) const {
+    return m_head.load(std::memory_order_acquire) -
+           m_tail.load(std::memory_order_acquire);
+  }
+
+  static constexpr uint32_t capacity(void) { return N; }
+
+ private:
+  // The indices count up forever and wrap at 2^32, which N divides. Each is
+  // written by one side only, and they sit on separate cache lines so the
+  // sides don't share a line on the host.
+  alignas(64) std::atomic<uint32_t> m_head{0};
+  alignas(64) std::atomic<uint32_t> m_tail{0};
+  T m_slots[N];
+};
@@ -5,12 +5,25 @@
 class VehicleContext;
 
 /**
- * @brief Abstract base class representing a state in the vehicle FSM.
- * @note Do not use this directly. You must create derived child classes.
+ * @brief Base class representing a state in the vehicle FSM.
+ * @note Do not use this directly. You must create derived child classes and
+ * add them to `VEHICLE_STATES` in Globals.h.
+ * @note States are dispatched statically, so nothing here is virtual. A
+ * derived state hides the functions it wants to change and must also provide:
+ * - `void execute(VehicleContext& ctx)`, called repeatedly by VehicleContext
+ *   while in this state. Do not perform blocking actions within this method.
+ * - `static constexpr StateEnum state`, the enum identifier corresponding to
+ *   the state class.
+ * - `static constexpr vehicle_duration min_duration`, the minimum time spent
+ *   in the state before transitioning.
  */
 class StateNode {
  public:
-  virtual ~StateNode() = default;
+  /**
+   * Whether `execute` reacts to the sensors between transitions. States that
+   * don't (e.g. IDLE) only need to run when their minimum duration is up.
+   */
+  static constexpr bool needs_control_updates = true;
 
   /**
    * @brief Called once by VehicleContext when transitioning into this
@@ -18,15 +31,7 @@ class StateNode {
    * Default implementation does nothing.
    * @param ctx Reference to main vehicle context object.
    */
-  virtual void enter(VehicleContext& ctx) {}
-
-  /**
-   * @brief Called repeatedly by VehicleContext while in this state.
-   * Must be implemented by derived state classes.
-   * Do not perform blocking actions within this method.
-   * @param ctx Reference to main vehicle context object.
-   */
-  virtual void execute(VehicleContext& ctx) = 0;
+  void enter([[maybe_unused]] VehicleContext& ctx) {}
 
   /**
    * @brief Called once by VehicleContext when transitioning out
@@ -35,12 +40,5 @@ class StateNode {
    * does nothing.
    * @param ctx Reference to main vehicle context object.
    */
-  virtual void exit(VehicleContext& ctx) {}
-
-  /**
-   * @brief Return the enum identifier corresponding to the state class.
-   * Must be implemented by derived state classes.
-   * @returns The StateEnum value for this state.
-   */
-  virtual StateEnum get_enum(void) const = 0;
+  void exit([[maybe_unused]] VehicleContext& ctx) {}
 };
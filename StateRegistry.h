@@ -0,0 +1,102 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+#include "BehaviorStateNode.h"
+#include "Globals.h"
+#include "IdleStateNode.h"
+
+/**
+ * @brief Compile-time list of the state classes of the FSM. The position of
+ * each class in the list is its `StateEnum` value.
+ * @tparam Nodes The state classes, derived from `StateNode`.
+ */
+template <typename... Nodes>
+struct StateList {
+  /**
+   * The number of states.
+   */
+  static constexpr int size = sizeof...(Nodes);
+
+  /**
+   * Storage for one instance of every state.
+   */
+  using storage = std::tuple<Nodes...>;
+
+  /**
+   * The minimum duration of every state, indexed by `StateEnum`.
+   */
+  static constexpr std::array<vehicle_duration, sizeof...(Nodes)>
+      min_durations = {Nodes::min_duration...};
+
+  /**
+   * Whether every state needs control updates between transitions, indexed
+   * by `StateEnum`.
+   */
+  static constexpr std::array<bool, sizeof...(Nodes)> control_updates = {
+      Nodes::needs_control_updates...};
+
+  /**
+   * @returns `true` if every state sits at the index of its `StateEnum`.
+   */
+  static constexpr bool matches_enum(void) {
+    return matches_enum(std::index_sequence_for<Nodes...>{});
+  }
+
+  /**
+   * @brief Calls `fn` with the instance of `state` in `nodes`. The call is
+   * resolved at compile time, so it can be inlined and needs no vtable. Does
+   * nothing if `state` is out of range.
+   * @param nodes The state instances.
+   * @param state The state to call `fn` with.
+   * @param fn A callable taking any state class by reference.
+   */
+  template <typename F>
+  static inline void dispatch(storage& nodes, StateEnum state, F&& fn) {
+    dispatch(nodes, state, fn, std::index_sequence_for<Nodes...>{});
+  }
+
+ private:
+  template <size_t... I>
+  static constexpr bool matches_enum(std::index_sequence<I...>) {
+    return ((Nodes::state == I) && ...);
+  }
+
+  template <typename F, size_t... I>
+  static inline void dispatch(storage& nodes, StateEnum state, F& fn,
+                              std::index_sequence<I...>) {
+    // Stops at the first match, which the compiler turns into a switch
+    (void)((state == I ? (fn(std::get<I>(nodes)), true) : false) || ...);
+  }
+};
+
+/**
+ * @brief `StateList` of `Nodes` without the first type, so a list generated
+ * with a separator before every entry can start with a placeholder.
+ */
+template <typename Placeholder, typename... Nodes>
+struct StateListAfter {
+  using type = StateList<Nodes...>;
+};
+
+/**
+ * @brief The state classes of the vehicle, generated from `VEHICLE_STATES` in
+ * Globals.h in `StateEnum` order. Add new states there; everything else is
+ * derived from the list.
+ */
+#define STATE_LIST_ENTRY(name, Node) , Node
+#define BEHAVIOR_LIST_ENTRY(name) , BehaviorStateNode<name>
+using VehicleStates = StateListAfter<void VEHICLE_STATES(
+    STATE_LIST_ENTRY, BEHAVIOR_LIST_ENTRY)>::type;
+#undef STATE_LIST_ENTRY
+#undef BEHAVIOR_LIST_ENTRY
+
+static_assert(VehicleStates::matches_enum(),
+              "Every state class must have the StateEnum of its position");
+
+/**
+ * The number of states.
+ */
+constexpr int NUM_STATES = VehicleStates::size;
@@ -0,0 +1,107 @@
+#include "TraceRecorder.h"
+
+#include "StateRegistry.h"
+
+uint8_t crc8(const uint8_t* data, size_t size) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < size; ++i) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x07)
+                         : static_cast<uint8_t>(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static inline void write_u32(uint8_t* dst, uint32_t value) {
+  dst[0] = static_cast<uint8_t>(value);
+  dst[1] = static_cast<uint8_t>(value >> 8);
+  dst[2] = static_cast<uint8_t>(value >> 16);
+  dst[3] = static_cast<uint8_t>(value >> 24);
+}
+
+static inline uint32_t read_u32(const uint8_t* src) {
+  return static_cast<uint32_t>(src[0]) | (static_cast<uint32_t>(src[1]) << 8) |
+         (static_cast<uint32_t>(src[2]) << 16) |
+         (static_cast<uint32_t>(src[3]) << 24);
+}
+
+void trace_encode(const TraceRecord& record, uint8_t* frame) {
+  frame[0] = TRACE_SYNC;
+  frame[1] = record.type;
+  frame[2] = record.state;
+  frame[3] = static_cast<uint8_t>(record.arg);
+  frame[4] = static_cast<uint8_t>(record.arg >> 8);
+  write_u32(&frame[5], record.time_ms);
+  write_u32(&frame[9], record.value);
+  frame[13] = crc8(&frame[1], TRACE_FRAME_SIZE - 2);
+}
+
+bool trace_decode(const uint8_t* frame, TraceRecord& out) {
+  if (frame[0] != TRACE_SYNC ||
+      frame[13] != crc8(&frame[1], TRACE_FRAME_SIZE - 2)) {
+    return false;
+  }
+
+  out.type = static_cast<TraceType>(frame[1]);
+  out.state = frame[2];
+  out.arg = static_cast<uint16_t>(frame[3] | (frame[4] << 8));
+  out.time_ms = read_u32(&frame[5]);
+  out.value = read_u32(&frame[9]);
+  return true;
+}
+
+TraceRecorder::TraceRecorder(ClockInterface& clock) : m_clock(clock) {}
+
+void TraceRecorder::record(TraceType type, uint8_t state, uint16_t arg,
+                           uint32_t value) {
+  TraceRecord* slot = m_ring.try_claim();
+  if (slot == nullptr) {
+    m_num_lost.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  *slot = {
+      .time_ms = static_cast<uint32_t>(m_clock.now().count()),
+      .type = type,
+      .state = state,
+      .arg = arg,
+      .value = value,
+  };
+  m_ring.publish();
+}
+
+size_t TraceRecorder::drain(uint8_t* buffer, size_t size) {
+  size_t written = 0;
+  uint32_t time_ms = static_cast<uint32_t>(m_clock.now().count());
+  while (written + TRACE_FRAME_SIZE <= size) {
+    TraceRecord record;
+    if (m_frames_since_format >= TRACE_FORMAT_INTERVAL) {
+#ifdef LEARNER_FIXED_POINT
+      uint32_t fixed_point = 1;
+#else
+      uint32_t fixed_point = 0;
+#endif
+      record = {time_ms, TRACE_FORMAT, TRACE_FORMAT_VERSION, NUM_STATES,
+                fixed_point};
+      m_frames_since_format = 0;
+    } else if (!m_ring.try_pop(record)) {
+      // Records are lost while the ring is full, so report them once it has
+      // been emptied.
+      uint32_t num_lost = m_num_lost.load(std::memory_order_relaxed);
+      if (num_lost == m_num_lost_reported) {
+        break;
+      }
+      record = {time_ms, TRACE_OVERFLOW, 0, 0, num_lost - m_num_lost_reported};
+      m_num_lost_reported = num_lost;
+    }
+
+    trace_encode(record, &buffer[written]);
+    written += TRACE_FRAME_SIZE;
+    ++m_frames_since_format;
+  }
+  return written;
+}
+
+uint32_t TraceRecorder::get_num_lost(void) const { return m_num_lost; }
@@ -0,0 +1,158 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "Globals.h"
+#include "HalInterfaces.h"
+#include "SpscRing.h"
+
+/**
+ * @brief Kinds of trace records. What `state`, `arg` and `value` of a
+ * `TraceRecord` hold depends on the kind.
+ */
+enum TraceType : uint8_t {
+  // state: format version, arg: NUM_STATES, value: 1 if probabilities and
+  // rewards are Q15, 0 if floats. Sent by the drain first and then every
+  // `TRACE_FORMAT_INTERVAL` records, so decoders can join mid-stream.
+  TRACE_FORMAT = 0,
+  // state: the state left, arg: the state entered
+  TRACE_TRANSITION,
+  // state: the rewarded state, arg: the state it was entered from,
+  // value: the reward
+  TRACE_REWARD,
+  // state: the row, arg: the column, value: the probability after an update
+  TRACE_PROB,
+  // state: the reported state, value: the average light change as a float
+  TRACE_MSG_SENT,
+  // state: the reported state, arg: the sender, value: the average light
+  // change as a float
+  TRACE_MSG_RECEIVED,
+  // value: the number of records lost to a full ring since the last
+  // TRACE_OVERFLOW
+  TRACE_OVERFLOW,
+};
+
+/**
+ * @brief One trace record.
+ * @param time_ms When it was recorded, from the recorder's clock.
+ */
+struct TraceRecord {
+  uint32_t time_ms;
+  TraceType type;
+  uint8_t state;
+  uint16_t arg;
+  uint32_t value;
+};
+
+/*
+ * Each record is streamed as a 14-byte frame (little endian):
+ *
+ *   offset  size  field
+ *   0       1     sync byte, `TRACE_SYNC`
+ *   1       1     type
+ *   2       1     state
+ *   3       2     arg
+ *   5       4     time_ms
+ *   9       4     value
+ *   13      1     CRC-8 (polynomial 0x07) of bytes 1 - 12
+ *
+ * Decoders look for a sync byte followed by a valid CRC, so they resync after
+ * lost or corrupted bytes.
+ */
+
+const uint8_t TRACE_SYNC = 0xA5;
+const uint8_t TRACE_FORMAT_VERSION = 1;
+const int TRACE_FRAME_SIZE = 14;
+const int TRACE_FORMAT_INTERVAL = 256;
+
+/**
+ * @returns The raw bits of a float trace value.
+ */
+inline uint32_t trace_value(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+/**
+ * @returns The raw bits of an integer (e.g. Q15) trace value.
+ */
+inline uint32_t trace_value(int32_t value) {
+  return static_cast<uint32_t>(value);
+}
+
+/**
+ * @returns The float a trace value holds.
+ */
+inline float trace_float(uint32_t value) {
+  float result;
+  memcpy(&result, &value, sizeof(result));
+  return result;
+}
+
+/**
+ * @returns The CRC-8 (polynomial 0x07, initial value 0) of `size` bytes at
+ * `data`.
+ */
+uint8_t crc8(const uint8_t* data, size_t size);
+
+/**
+ * @brief Writes `record` as a frame to `frame`, `TRACE_FRAME_SIZE` bytes.
+ */
+void trace_encode(const TraceRecord& record, uint8_t* frame);
+
+/**
+ * @brief Decodes the frame at `frame`, `TRACE_FRAME_SIZE` bytes.
+ * @returns `true` if it starts with a sync byte and its CRC matches, in which
+ * case `out` is written, otherwise `false`.
+ */
+bool trace_decode(const uint8_t* frame, TraceRecord& out);
+
+/**
+ * @brief Fixed size in-RAM ring of trace records. Recording only stamps the
+ * record and pushes it onto a lock-free ring, so it is cheap enough to leave
+ * in the control loop, and records are streamed out later by a low priority
+ * drain. When the ring is full, records are dropped and counted, and the
+ * drain reports the count with a `TRACE_OVERFLOW` record.
+ * @note One thread may record and one other thread may drain. Give each
+ * recording thread its own recorder.
+ */
+class TraceRecorder {
+ public:
+  /**
+   * @param clock The clock to stamp records with.
+   */
+  explicit TraceRecorder(ClockInterface& clock);
+
+  /**
+   * @brief Recording thread only. Records an event stamped with the current
+   * time.
+   */
+  void record(TraceType type, uint8_t state, uint16_t arg, uint32_t value);
+
+  /**
+   * @brief Draining thread only. Encodes waiting records as frames, starting
+   * with a `TRACE_FORMAT` record when one is due, and ending with a
+   * `TRACE_OVERFLOW` record if records were lost.
+   * @param buffer The buffer to write frames to.
+   * @param size The size of `buffer` in bytes.
+   * @returns The number of bytes written, a multiple of `TRACE_FRAME_SIZE`.
+   */
+  size_t drain(uint8_t* buffer, size_t size);
+
+  /**
+   * @returns The number of records lost to a full ring so far.
+   */
+  uint32_t get_num_lost(void) const;
+
+ private:
+  ClockInterface& m_clock;
+  SpscRing<TraceRecord, TRACE_RING_SIZE> m_ring;
+  std::atomic<uint32_t> m_num_lost{0};
+
+  // Only touched by the draining thread
+  uint32_t m_num_lost_reported = 0;
+  int m_frames_since_format = TRACE_FORMAT_INTERVAL;
+};
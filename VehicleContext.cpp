@@ -1,135 +1,127 @@
 #include "VehicleContext.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 #include "CommsContext.h"
 
-VehicleContext::VehicleContext(PinName ldr_l, PinName ldr_r, PinName ldr_l_gnd,
-                               PinName ldr_r_gnd, PinName mtr_l_in1,
-                               PinName mtr_l_in2, PinName mtr_r_in3,
-                               PinName mtr_r_in4, PinName mtr_l_pwm,
-                               PinName mtr_r_pwm, PinName led_g, PinName led_r,
-                               float learning_rate, float ci_change_rate)
-    :
-#ifdef VEHICLE_1
-      m_comms_ctx(PE_14, PE_13, PE_12, PE_11, PE_9, 0x1111111111, 0x0000000000),
-#else
-      m_comms_ctx(PE_14, PE_13, PE_12, PE_11, PE_9, 0x0000000000, 0x1111111111),
-#endif
-      m_ldr_l(ldr_l),
-      m_ldr_r(ldr_r),
-      m_ldr_l_gnd(ldr_l_gnd, 0),
-      m_ldr_r_gnd(ldr_r_gnd, 0),
-      m_mtr_l_in1(mtr_l_in1, 0),
-      m_mtr_l_in2(mtr_l_in2, 0),
-      m_mtr_l_pwm(mtr_l_pwm),
-      m_mtr_r_in3(mtr_r_in3, 0),
-      m_mtr_r_in4(mtr_r_in4, 0),
-      m_mtr_r_pwm(mtr_r_pwm),
-      m_curr_state_ptr(nullptr),
-      m_curr_state(IDLE),
-      m_prev_state(IDLE),
-      m_light_lvl_min({1.0, 1.0}),
-      m_light_lvl_max({0.0, 0.0}),
-      m_comms_influence(0.0f),
-      m_learning_rate(learning_rate),
-      m_ci_change_rate(ci_change_rate),
-      m_g_led(led_g),
-      m_r_led(led_r) {
-  // Set up photoresistors
-  m_ldr_l.set_reference_voltage(3.0f);
-  m_ldr_r.set_reference_voltage(3.0f);
-
-  // Initialize PWM for drive
-  m_mtr_l_pwm.period(0.00005f);  // 1 kHz
-  m_mtr_r_pwm.period(0.00005f);
-  m_mtr_l_pwm.write(0.0f);
-  m_mtr_r_pwm.write(0.0f);
-
-  // Set up pointers to state objects
-  m_state_node_instances[IDLE] = &m_state_idle;
-  m_state_node_instances[COWARD] = &m_state_coward;
-  m_state_node_instances[AGGRESSIVE] = &m_state_aggressive;
-  m_state_node_instances[LOVE] = &m_state_love;
-  m_state_node_instances[EXPLORER] = &m_state_explorer;
-
-  // And initialize the FSM
+VehicleContext::VehicleContext(LightSensorInterface& sensors,
+                               MotorInterface& motors, LedInterface& leds,
+                               ClockInterface& clock, RadioInterface& radio,
+                               LearnerStore& learner, size_t slot,
+                               uint16_t vehicle_id,
+                               const VehicleParams& params)
+    : m_comms_ctx(radio, clock, vehicle_id),
+      m_sensors(sensors),
+      m_motors(motors),
+      m_leds(leds),
+      m_clock(clock),
+      m_learner(learner),
+      m_slot(slot),
+      m_vehicle_id(vehicle_id),
+      m_params(params),
+      m_learning_rate(reward_from_float(params.learning_rate)),
+      m_send_threshold(static_cast<uint64_t>(
+          std::clamp(params.send_chance, 0.0f, 1.0f) * 4294967296.0)) {
+  // Initialize the FSM
   initialize_fsm();
 }
 
 void VehicleContext::initialize_fsm(void) {
-  // Default the probabilities to a uniform distribution
-  for (int i = 0; i < NUM_STATES; ++i) {
-    for (int j = 0; j < NUM_STATES; ++j) {
-      m_probability_table[i][j] = 1.0f / static_cast<float>(NUM_STATES);
-    }
-  }
-
-  // Then grab the first state note (defaults to IDLE per constructor)
-  m_curr_state_ptr = get_state_node(m_curr_state);
+  // Start our slot of the learner store from a clean slate: IDLE, with the
+  // probabilities defaulted to a uniform distribution
+  m_learner.reset_table(m_slot);
+  m_learner.curr_state(m_slot) = IDLE;
+  m_learner.prev_state(m_slot) = IDLE;
+  m_learner.light_lvl_min(m_slot) = {1.0f, 1.0f};
+  m_learner.light_lvl_max(m_slot) = {0.0f, 0.0f};
+  m_learner.comms_influence(m_slot) = 0.0f;
 
   // Grab the entry time to use for tick update later
-  m_time_state_entry = Kernel::Clock::now();
+  m_learner.time_state_entry(m_slot) = now();
 
   // Read the light sensors and record the entry light level for reward
   // calculations later
   read_sensors();
-  m_light_lvl_entry = m_light_lvl_curr;
+  m_learner.light_lvl_entry(m_slot) = m_learner.light_lvl_curr(m_slot);
 
   // Then run the "enter" function for our first state
-  if (m_curr_state_ptr) {
-    m_curr_state_ptr->enter(*this);
-  }
-}
-
-StateNode* VehicleContext::get_state_node(StateEnum state) const {
-  return m_state_node_instances[state];
+  with_state_node(m_learner.curr_state(m_slot),
+                  [this](auto& node) { node.enter(*this); });
 }
 
 void VehicleContext::read_sensors(void) {
+  ProfileScope profile(m_profiler, PROFILE_READ_SENSORS);
+
   // Grab raw values
-  float raw_ldr_l = m_ldr_l.read();
-  float raw_ldr_r = m_ldr_r.read();
+  LightLevels raw = m_input_source != nullptr ? m_input_source->take_sensors()
+                                              : m_sensors.read();
+  if (m_recorder != nullptr) {
+    m_recorder->record_sensors(raw);
+  }
+  float raw_ldr_l = raw.lvl_left;
+  float raw_ldr_r = raw.lvl_right;
 
   // Then get the mins and maxes for normalization
-  float min_ldr_l = min(raw_ldr_l, m_light_lvl_min.lvl_left);
-  float max_ldr_l = max(raw_ldr_l, m_light_lvl_max.lvl_left);
-  float min_ldr_r = min(raw_ldr_r, m_light_lvl_min.lvl_right);
-  float max_ldr_r = max(raw_ldr_r, m_light_lvl_max.lvl_right);
+  LightLevels& lvl_min = m_learner.light_lvl_min(m_slot);
+  LightLevels& lvl_max = m_learner.light_lvl_max(m_slot);
+  float min_ldr_l = std::min(raw_ldr_l, lvl_min.lvl_left);
+  float max_ldr_l = std::max(raw_ldr_l, lvl_max.lvl_left);
+  float min_ldr_r = std::min(raw_ldr_r, lvl_min.lvl_right);
+  float max_ldr_r = std::max(raw_ldr_r, lvl_max.lvl_right);
 
   // Save the mins and maxes for later use
-  m_light_lvl_min = {
+  lvl_min = {
       .lvl_left = min_ldr_l,
       .lvl_right = min_ldr_r,
   };
-  m_light_lvl_max = {
+  lvl_max = {
       .lvl_left = max_ldr_l,
       .lvl_right = max_ldr_r,
   };
 
-  // Normalize the light sensor values
-  float norm_ldr_l = (raw_ldr_l - m_light_lvl_min.lvl_left) /
-                     (m_light_lvl_max.lvl_left - m_light_lvl_min.lvl_left);
-  float norm_ldr_r = (raw_ldr_r - m_light_lvl_min.lvl_right) /
-                     (m_light_lvl_max.lvl_right - m_light_lvl_min.lvl_right);
-
-  // And write the normalized values to m_light_lvl_curr
-  m_light_lvl_curr = {
+  // Normalize the light sensor values. Until a sensor has seen two different
+  // readings its range is empty, so report it as dark instead of dividing by
+  // zero.
+  float range_ldr_l = lvl_max.lvl_left - lvl_min.lvl_left;
+  float range_ldr_r = lvl_max.lvl_right - lvl_min.lvl_right;
+  float norm_ldr_l =
+      range_ldr_l > 0.0f ? (raw_ldr_l - lvl_min.lvl_left) / range_ldr_l : 0.0f;
+  float norm_ldr_r = range_ldr_r > 0.0f
+                         ? (raw_ldr_r - lvl_min.lvl_right) / range_ldr_r
+                         : 0.0f;
+
+  // And write the normalized values to the current light levels
+  m_learner.light_lvl_curr(m_slot) = {
       .lvl_left = norm_ldr_l,
       .lvl_right = norm_ldr_r,
   };
 }
 
 void VehicleContext::run_fsm_cycle(void) {
+  ProfileScope profile(m_profiler, PROFILE_FSM_CYCLE);
+
+  if (m_recorder != nullptr) {
+    m_recorder->record_cycle(m_clock.now());
+  }
+
+  // Take a requested snapshot here, where nothing else touches the learner.
+  if (m_snapshot_status.load(std::memory_order_acquire) ==
+      SNAPSHOT_REQUESTED) {
+    learner_snapshot_save(m_learner, m_slot, m_snapshot);
+    m_snapshot_status.store(SNAPSHOT_READY, std::memory_order_release);
+  }
+
   // Read the light sensors on every tick of the FSM cycle
   read_sensors();
 
-  if (m_curr_state_ptr) {
-    // And execute the procedure for the state
-    m_curr_state_ptr->execute(*this);
-  } else {
-    // We shouldn't be missing the state pointer
-    // If we are, default to IDLE
-    transition_to(IDLE);
-  }
+  // And execute the procedure for the state, timed in the state's own point
+  with_state_node(m_learner.curr_state(m_slot), [this](auto& node) {
+    ProfileScope profile_state(
+        m_profiler, profile_execute(std::decay_t<decltype(node)>::state));
+    node.execute(*this);
+  });
 }
 
 void VehicleContext::transition_to(StateEnum next_state) {
@@ -139,259 +131,312 @@ void VehicleContext::transition_to(StateEnum next_state) {
     return;
   }
 
+  ProfileScope profile(m_profiler, PROFILE_TRANSITION);
+
   // Calculate our reward for previous state and update the appropriate
   // probability table
-  float reward = calculate_reward(m_light_lvl_entry, m_light_lvl_curr);
+  reward_t reward = calculate_reward(m_learner.light_lvl_entry(m_slot),
+                                  m_learner.light_lvl_curr(m_slot));
   update_probability_table(reward);
 
-  // Then run cleanup for the previous state
-  if (m_curr_state_ptr) {
-    m_curr_state_ptr->exit(*this);
+  if (m_trace != nullptr) {
+    StateEnum prev_state = m_learner.prev_state(m_slot);
+    StateEnum curr_state = m_learner.curr_state(m_slot);
+    m_trace->record(TRACE_REWARD, curr_state, prev_state, trace_value(reward));
+    const prob_t* row = m_learner.get_row(m_slot, prev_state);
+    for (int i = 0; i < NUM_STATES; ++i) {
+      m_trace->record(TRACE_PROB, prev_state, i, trace_value(row[i]));
+    }
+    m_trace->record(TRACE_TRANSITION, curr_state, next_state, 0);
   }
 
-  // Now set the next state and pointer
-  m_prev_state = m_curr_state;
-  m_curr_state = next_state;
-  m_curr_state_ptr = get_state_node(m_curr_state);
+  // Then run cleanup for the previous state
+  with_state_node(m_learner.curr_state(m_slot),
+                  [this](auto& node) { node.exit(*this); });
+
+  // Now set the next state
+  m_learner.prev_state(m_slot) = m_learner.curr_state(m_slot);
+  m_learner.curr_state(m_slot) = next_state;
 
-  // 33% chance we send a message about our previous state to the other vehicle
+  // With a chance of `send_chance` (1 in 3 by default), tell the other
+  // vehicles how our previous state went
   CommsMsg msg = {
-      .prev_lvls = m_light_lvl_entry,
-      .curr_lvls = m_light_lvl_curr,
-      .prev_state = m_prev_state,
+      .prev_lvls = m_learner.light_lvl_entry(m_slot),
+      .curr_lvls = m_learner.light_lvl_curr(m_slot),
+      .prev_state = m_learner.prev_state(m_slot),
+      .sender_id = m_vehicle_id,
   };
-  if (rand() % 3 == 0) {
+  if (draw_random() < m_send_threshold) {
     if (!m_comms_ctx.try_queue_send(msg)) {
 #ifdef PRINT_DEBUG
       printf("Could not send message\r\n");
 #endif
+    } else if (m_trace != nullptr) {
+      float ldr_delta_avg =
+          ((msg.curr_lvls.lvl_left - msg.prev_lvls.lvl_left) +
+           (msg.curr_lvls.lvl_right - msg.prev_lvls.lvl_right)) /
+          2.0f;
+      m_trace->record(TRACE_MSG_SENT, msg.prev_state, 0,
+                      trace_value(ldr_delta_avg));
     }
   }
 
   // Now transition into the new state, similar procedure to
   // initialize_fsm
-  if (m_curr_state_ptr) {
-    m_time_state_entry = Kernel::Clock::now();
-    m_light_lvl_entry = m_light_lvl_curr;
-    set_state_leds(m_curr_state);
-    m_curr_state_ptr->enter(*this);
-  } else {
-    // Something went terribly wrong, so try to default to IDLE
-    m_curr_state = IDLE;
-    m_curr_state_ptr = get_state_node(IDLE);
-    if (m_curr_state_ptr) {
-      m_curr_state_ptr->enter(*this);
-    }
-  }
+  m_learner.time_state_entry(m_slot) = now();
+  m_learner.light_lvl_entry(m_slot) = m_learner.light_lvl_curr(m_slot);
+  set_state_leds(m_learner.curr_state(m_slot));
+  with_state_node(m_learner.curr_state(m_slot),
+                  [this](auto& node) { node.enter(*this); });
 }
 
-float VehicleContext::calculate_reward(LightLevels before, LightLevels after) {
+reward_t VehicleContext::calculate_reward(LightLevels before,
+                                          LightLevels after) {
   // The reward is based on average light level before and after the previous
   // state
-  float avg_before = (before.lvl_left + before.lvl_right) / 2.0f;
-  float avg_after = (after.lvl_left + after.lvl_right) / 2.0f;
+  reward_t avg_before = (reward_from_float(before.lvl_left) +
+                         reward_from_float(before.lvl_right)) /
+                        2;
+  reward_t avg_after =
+      (reward_from_float(after.lvl_left) + reward_from_float(after.lvl_right)) /
+      2;
   return avg_before - avg_after;
 }
 
-void VehicleContext::update_probability_table(float reward) {
+void VehicleContext::update_probability_table(reward_t reward) {
   // Reward the previous state if our light levels decreased
-  // Punish otherwise
-  float& prob_to_update = m_probability_table[m_prev_state][m_curr_state];
-  float delta = m_learning_rate * reward;
-  prob_to_update += delta;
-
-  // And modulate the probability of the other states to keep the sum at 1.0
-  if (NUM_STATES > 1) {
-    float reverse_delta = -delta / static_cast<float>(NUM_STATES - 1);
-    for (int i = 0; i < NUM_STATES; ++i) {
-      if (i != m_curr_state) {
-        m_probability_table[m_prev_state][i] += reverse_delta;
-      }
-    }
-  }
-
-  normalize_probabilities(m_prev_state);
-}
-
-void VehicleContext::normalize_probabilities(StateEnum state) {
-  const float min_prob = 0.01f;
-  float sum = 0.0f;
-
-  // Ensure no probability is below 0.01, then sum the values
-  for (int i = 0; i < NUM_STATES; ++i) {
-    if (m_probability_table[state][i] < min_prob) {
-      m_probability_table[state][i] = min_prob;
-    }
-    sum += m_probability_table[state][i];
-  }
-
-  // And use the probability sum to normalize the values
-  if (sum > 0.0f) {
-    for (int i = 0; i < NUM_STATES; ++i) {
-      m_probability_table[state][i] /= sum;
-    }
-  } else {
-    // Something went terribly wrong, so we should reset to uniform
-    // probabilities
-    for (int i = 0; i < NUM_STATES; ++i) {
-      m_probability_table[state][i] = 1.0f / static_cast<float>(NUM_STATES);
-    }
-  }
+  // Punish otherwise. The store applies the update right away, or later in a
+  // batch with the other vehicles when deferred updates are enabled.
+  m_learner.submit_update(m_slot, m_learning_rate * reward / PROB_ONE);
 }
 
 StateEnum VehicleContext::sample_next_state(void) {
-  // Create a copy of the current state's probability array
-  // so that we can...
-  float probabilities[NUM_STATES];
-  for (int i = 0; i < NUM_STATES; ++i) {
-    probabilities[i] = m_probability_table[m_curr_state][i];
-  }
+  StateEnum curr_state = m_learner.curr_state(m_slot);
+  const prob_t* row = m_learner.get_row(m_slot, curr_state);
 
 #ifdef PRINT_DEBUG
   printf("Before comms influence\r\n");
   for (int i = 0; i < NUM_STATES; ++i) {
-    printf("State %d | Probability: %f | ", i, probabilities[i]);
+    printf("State %d | Probability: %f | ", i, prob_to_float(row[i]));
   }
   printf("\r\n\r\n");
 #endif
 
-  // ...temporarily influence the probabilities
-  influence_probabilities(probabilities);
+  // Check whether other vehicles want to temporarily influence the
+  // probabilities. If not, draw from the alias table of the current state's
+  // row.
+  reward_t influenced[NUM_STATES];
+  if (!influence_probabilities(row, influenced)) {
+    return m_learner.sample_state(m_slot, curr_state, draw_sample());
+  }
 
 #ifdef PRINT_DEBUG
   printf("After comms influence\r\n");
   for (int i = 0; i < NUM_STATES; ++i) {
-    printf("State %d | Probability: %f | ", i, probabilities[i]);
+    printf("State %d | Weight: %f | ", i, prob_to_float(influenced[i]));
   }
   printf("\r\n\r\n");
 #endif
 
-  float sample = ((float)rand() / (float)(RAND_MAX));
-
-  // Use a cummulative sum to determine what state to enter into next
-  float cum_sum = 0.0f;
+  // Otherwise sample the shifted row directly
+  reward_t total = 0;
   for (int i = 0; i < NUM_STATES; ++i) {
-    cum_sum += probabilities[i];
-    if (sample <= cum_sum) {
+    total += influenced[i];
+  }
+
+  sample_t sample = draw_sample();
+  reward_t cumulative = 0;
+  for (int i = 0; i < NUM_STATES - 1; ++i) {
+    cumulative += influenced[i];
+    if (learner_sample_below(sample, cumulative, total)) {
       return static_cast<StateEnum>(i);
     }
   }
+  return static_cast<StateEnum>(NUM_STATES - 1);
+}
+
+vehicle_duration VehicleContext::now(void) const {
+  vehicle_duration time = m_input_source != nullptr
+                              ? m_input_source->take_clock()
+                              : m_clock.now();
+  if (m_recorder != nullptr) {
+    m_recorder->record_clock(time);
+  }
+  return time;
+}
 
-  // Otherwise we fallback to IDLE
-  return IDLE;
+uint32_t VehicleContext::draw_random(void) {
+  uint32_t value = m_input_source != nullptr
+                       ? m_input_source->take_random()
+                       : m_rng.next();
+  if (m_recorder != nullptr) {
+    m_recorder->record_random(value);
+  }
+  return value;
+}
+
+sample_t VehicleContext::draw_sample(void) {
+#ifdef LEARNER_FIXED_POINT
+  // The top 16 bits are the best PCG32 has to offer
+  return static_cast<sample_t>(draw_random() >> 16);
+#else
+  return Pcg32::to_unit_float(draw_random());
+#endif
 }
 
 LightLevels VehicleContext::get_curr_light_lvls(void) const {
-  return m_light_lvl_curr;
+  return m_learner.light_lvl_curr(m_slot);
+}
+
+vehicle_duration VehicleContext::get_elapsed_time_in_state(void) const {
+  return now() - m_learner.time_state_entry(m_slot);
+}
+
+vehicle_duration VehicleContext::get_min_duration(StateEnum state) const {
+  return m_params.min_durations[state];
 }
 
-Kernel::Clock::duration VehicleContext::get_elapsed_time_in_state(void) const {
-  return Kernel::Clock::now() - m_time_state_entry;
+vehicle_duration VehicleContext::get_time_until_transition(void) const {
+  // Only used to schedule the FSM, so read the clock directly rather than
+  // recording the read as an input.
+  vehicle_duration remaining =
+      get_min_duration(m_learner.curr_state(m_slot)) -
+      (m_clock.now() - m_learner.time_state_entry(m_slot));
+  return std::max(remaining, vehicle_duration(0));
 }
 
-Kernel::Clock::duration VehicleContext::get_min_duration(
-    StateEnum state) const {
-  return m_min_state_duration[state];
+bool VehicleContext::needs_control_updates(void) const {
+  return VehicleStates::control_updates[m_learner.curr_state(m_slot)];
+}
+
+StateEnum VehicleContext::get_curr_state(void) const {
+  return m_learner.curr_state(m_slot);
+}
+
+float VehicleContext::get_transition_probability(StateEnum from,
+                                                 StateEnum to) const {
+  return prob_to_float(m_learner.get_row(m_slot, from)[to]);
 }
 
 void VehicleContext::set_motor_speeds(Direction dir_l, Direction dir_r,
                                       float pwm_l, float pwm_r) {
-  switch (dir_l) {
-    case FORWARD:
-      m_mtr_l_in1.write(1);
-      m_mtr_l_in2.write(0);
-      break;
-    case REVERSE:
-      m_mtr_l_in1.write(0);
-      m_mtr_l_in2.write(1);
-      break;
-    case STOP:
-    default:
-      m_mtr_l_in1.write(0);
-      m_mtr_l_in2.write(0);
-      break;
-  }
-  m_mtr_l_pwm.write(pwm_l);
+  m_motors.set_motor_speeds(dir_l, dir_r, pwm_l, pwm_r);
+}
 
-  switch (dir_r) {
-    case FORWARD:
-      m_mtr_r_in3.write(0);
-      m_mtr_r_in4.write(1);
-      break;
-    case REVERSE:
-      m_mtr_r_in3.write(1);
-      m_mtr_r_in4.write(0);
-      break;
-    case STOP:
-    default:
-      m_mtr_r_in3.write(0);
-      m_mtr_r_in4.write(0);
-      break;
+void VehicleContext::drive(const BraitenbergCoeffs& coeffs) {
+  if (m_batched_control) {
+    return;
   }
-  m_mtr_r_pwm.write(pwm_r);
+
+  float pwm_l;
+  float pwm_r;
+  braitenberg_compute(coeffs, get_curr_light_lvls(), &pwm_l, &pwm_r);
+  set_motor_speeds(braitenberg_direction(pwm_l), braitenberg_direction(pwm_r),
+                   std::fabs(pwm_l), std::fabs(pwm_r));
 }
 
-void VehicleContext::influence_probabilities(float* probabilities) {
-  // We only attempt to influence probabilities if there exists a comms message
-  CommsMsg possible_msg;
-  if (!m_comms_ctx.try_read(&possible_msg)) {
+void VehicleContext::set_trace(TraceRecorder* trace) { m_trace = trace; }
+
+void VehicleContext::set_profiler(Profiler* profiler) {
+  m_profiler = profiler;
+}
+
+void VehicleContext::seed_random(uint64_t seed, uint64_t stream) {
+  m_rng.seed(seed, stream);
+}
+
+void VehicleContext::set_recorder(RunRecorder* recorder) {
+  m_recorder = recorder;
+  if (m_recorder == nullptr) {
     return;
-  } else {
-#ifdef PRINT_DEBUG
-    printf("Read incoming message, attempting to influenece\r\n");
-#endif
   }
 
-  // Compute the average difference before and after the previous state
-  // the other vehicle was in
-  float ldr_l_delta =
-      possible_msg.curr_lvls.lvl_left - possible_msg.prev_lvls.lvl_left;
-  float ldr_r_delta =
-      possible_msg.curr_lvls.lvl_right - possible_msg.prev_lvls.lvl_right;
-  float ldr_delta_avg = (ldr_l_delta + ldr_r_delta) / 2.0f;
-
-  // A positive difference indicates increasing light level, so temporarily
-  // decrease the chance we enter into the same state the other vehicle was just
-  // in
-  if (ldr_delta_avg > 0) {
-    probabilities[possible_msg.prev_state] -= 0.2f;
-    for (int i = 0; i < NUM_STATES; ++i) {
-      if (i != possible_msg.prev_state) {
-        probabilities[i] += (0.2f / (NUM_STATES - 1));
-      }
-    }
-  } else {
-    // A negative difference indicates increasing light level, so
-    // increase the chance we enter the same state the other vehicle was just in
-    probabilities[possible_msg.prev_state] += 0.2f;
-    for (int i = 0; i < NUM_STATES; ++i) {
-      if (i != possible_msg.prev_state) {
-        probabilities[i] -= (0.2f / (NUM_STATES - 1));
-      }
-    }
+  RunStart start = {
+      .vehicle_id = m_vehicle_id,
+      .curr_state = m_learner.curr_state(m_slot),
+      .prev_state = m_learner.prev_state(m_slot),
+      .time_state_entry = m_learner.time_state_entry(m_slot),
+      .light_lvl_entry = m_learner.light_lvl_entry(m_slot),
+      .light_lvl_curr = m_learner.light_lvl_curr(m_slot),
+  };
+  uint8_t snapshot[SNAPSHOT_SIZE];
+  learner_snapshot_save(m_learner, m_slot, snapshot);
+  m_recorder->record_start(start, snapshot);
+}
+
+void VehicleContext::set_input_source(RunInputSource* source) {
+  m_input_source = source;
+}
+
+bool VehicleContext::restore_snapshot(const uint8_t* buffer, size_t size) {
+  return learner_snapshot_load(m_learner, m_slot, buffer, size);
+}
+
+void VehicleContext::request_snapshot(void) {
+  // If a snapshot is already requested or waiting to be taken, leave it.
+  SnapshotStatus expected = SNAPSHOT_NONE;
+  m_snapshot_status.compare_exchange_strong(expected, SNAPSHOT_REQUESTED,
+                                            std::memory_order_relaxed);
+}
+
+bool VehicleContext::try_take_snapshot(uint8_t* out) {
+  if (m_snapshot_status.load(std::memory_order_acquire) != SNAPSHOT_READY) {
+    return false;
   }
 
-  // And normalize the values just in case
-  const float min_prob = 0.01f;
-  float sum = 0.0f;
+  memcpy(out, m_snapshot, SNAPSHOT_SIZE);
+  m_snapshot_status.store(SNAPSHOT_NONE, std::memory_order_release);
+  return true;
+}
 
-  for (int i = 0; i < NUM_STATES; ++i) {
-    if (probabilities[i] < min_prob) {
-      probabilities[i] = min_prob;
-    }
-    sum += probabilities[i];
+void VehicleContext::set_batched_control(bool batched) {
+  m_batched_control = batched;
+}
+
+bool VehicleContext::influence_probabilities(const prob_t* row,
+                                             reward_t* influenced) {
+  // The summary holds every report received so far, so reading it costs the
+  // same however many vehicles are talking.
+  InfluenceSummary summary = {};
+  bool read = m_input_source != nullptr
+                  ? m_input_source->take_influence(summary)
+                  : m_comms_ctx.try_read_influence(summary);
+  if (m_recorder != nullptr) {
+    m_recorder->record_influence(read, summary);
+  }
+  if (!read) {
+    return false;
   }
 
-  if (sum > 0.0f) {
-    for (int i = 0; i < NUM_STATES; ++i) {
-      probabilities[i] /= sum;
+  bool any_influence = false;
+  for (int i = 0; i < NUM_STATES; ++i) {
+    influenced[i] = row[i];
+
+    // Skip states nobody has reported on lately
+    float weight = summary.weight[i];
+    if (weight < m_min_influence_weight) {
+      continue;
     }
-  } else {
-    // something went wrong updating weights, so reset to uniform
-    for (int i = 0; i < NUM_STATES; ++i) {
-      probabilities[i] = 1.0f / static_cast<float>(NUM_STATES);
+
+    // A negative average light change means the state led other vehicles to
+    // darkness, so we shift towards it, and away from it otherwise. The more
+    // recent reports agree, the closer the shift gets to the maximum.
+    float avg_delta = summary.delta_sum[i] / weight;
+    float strength = std::clamp(-avg_delta / m_influence_delta_scale, -1.0f,
+                                1.0f);
+    float confidence = weight / (weight + 1.0f);
+    reward_t shift =
+        reward_from_float(m_max_influence_shift * strength * confidence);
+    if (shift == 0) {
+      continue;
     }
+
+    influenced[i] = std::max(influenced[i] + shift,
+                             static_cast<reward_t>(LEARNER_MIN_PROB));
+    any_influence = true;
   }
+
+  return any_influence;
 }
 
 void VehicleContext::set_state_leds(StateEnum state) {
@@ -401,23 +446,19 @@ void VehicleContext::set_state_leds(StateEnum state) {
       // IDLE or EXPLORER has both LEDs off
       // You can tell the difference between states based on whether the vehicle
       // moves or not
-      m_g_led.write(0);
-      m_r_led.write(0);
+      m_leds.set_leds(false, false);
       break;
     case AGGRESSIVE:
       // Red LED only
-      m_g_led.write(0);
-      m_r_led.write(1);
+      m_leds.set_leds(false, true);
       break;
     case COWARD:
       // Green LED only
-      m_g_led.write(1);
-      m_r_led.write(0);
+      m_leds.set_leds(true, false);
       break;
     case LOVE:
       // And both LEDS
-      m_g_led.write(1);
-      m_r_led.write(1);
+      m_leds.set_leds(true, true);
       break;
   }
 }
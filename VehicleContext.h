@@ -1,13 +1,35 @@
 #pragma once
+#include <array>
+#include <atomic>
 
-#include "AggressiveStateNode.h"
+#include "BraitenbergController.h"
 #include "CommsContext.h"
-#include "CowardStateNode.h"
-#include "ExplorerStateNode.h"
 #include "Globals.h"
-#include "IdleStateNode.h"
-#include "LoveStateNode.h"
-#include "StateNode.h"
+#include "HalInterfaces.h"
+#include "LearnerSnapshot.h"
+#include "LearnerStore.h"
+#include "Pcg32.h"
+#include "Profiler.h"
+#include "RunRecorder.h"
+#include "StateRegistry.h"
+#include "TraceRecorder.h"
+
+/**
+ * @brief The tunable parameters of the learner and the FSM. The defaults are
+ * the ones the vehicle ships with; the host sweeps other values to tune them.
+ */
+struct VehicleParams {
+  // The step size for changing probabilities in the state table
+  float learning_rate = 0.1f;
+
+  // The chance of sending a message about the previous state on each
+  // transition (0.0f - 1.0f)
+  float send_chance = 1.0f / 3.0f;
+
+  // The minimum time spent in each state before transitioning
+  std::array<vehicle_duration, NUM_STATES> min_durations =
+      VehicleStates::min_durations;
+};
 
 /**
  * @brief Main vehicle context for the Braitenberg vehicle.
@@ -16,38 +38,33 @@ class VehicleContext {
  public:
   /**
    * @brief Constructor for the VehicleContext class.
-   * @param ldr_l Pin for reading the left LDR.
-   * @param ldr_r Pin for reading the right LDR.
-   * @param ldr_l_gnd Ground pin for left LDR.
-   * @param ldr_r_gnd Ground pin for right LDR.
-   * @param mtr_l_in1 IN1 pin for the H-bridge driver, left side motor.
-   * @param mtr_l_in2 IN2 pin for the H-bridge driver, left side motor.
-   * @param mtr_r_in3 IN3 pin for the H-bridge driver, right side motor.
-   * @param mtr_r_in4 IN4 pin for the H-bridge driver, right side motor.
-   * @param mtr_l_pwm PWM pin for the H-bridge driver, left side motor.
-   * @param mtr_r_pwm PWM pin for the H-bridge driver, right side motor.
-   * @param led_g Pin for the onboard green LED.
-   * @param led_r Pin for the onboard red LED.
-   * @param learning_rate The step size for changing probabilities in the state
-   * table.
-   * @param ci_change_rate Unused.
+   * @param sensors The LDR pair used for light level readings.
+   * @param motors The left and right drive motors.
+   * @param leds The red and green status LEDs.
+   * @param clock The clock used for FSM timing.
+   * @param radio The configured transceiver used by `m_comms_ctx`.
+   * @param learner The store holding the learning state of the vehicle.
+   * @param slot The slot in `learner` that belongs to this vehicle.
+   * @param vehicle_id The ID this vehicle sends messages with.
+   * @param params The learning rate, send chance and state durations.
    *
    */
-  VehicleContext(PinName ldr_l, PinName ldr_r, PinName ldr_l_gnd,
-                 PinName ldr_r_gnd, PinName mtr_l_in1, PinName mtr_l_in2,
-                 PinName mtr_r_in3, PinName mtr_r_in4, PinName mtr_l_pwm,
-                 PinName mtr_r_pwm, PinName led_g, PinName led_r,
-                 float learning_rate = 0.1f, float ci_change_rate = 0.05f);
+  VehicleContext(LightSensorInterface& sensors, MotorInterface& motors,
+                 LedInterface& leds, ClockInterface& clock,
+                 RadioInterface& radio, LearnerStore& learner, size_t slot,
+                 uint16_t vehicle_id,
+                 const VehicleParams& params = VehicleParams());
 
   /**
-   * @brief Is called every FSM "tick". Calls StateNode::execute.
+   * @brief Is called every FSM "tick". Calls `execute` of the current state,
+   * dispatched statically through `VehicleStates`.
    */
   void run_fsm_cycle(void);
 
   /**
    * @brief Called by StateNode::execute to indicate what state to
    * transition into next. Handles learning updates, general cleanup, etc.
-   * Calls StateNode::exit before performing transition.
+   * Calls `exit` of the current state before performing transition.
    */
   void transition_to(StateEnum next_state);
 
@@ -58,15 +75,27 @@ class VehicleContext {
   LightLevels get_curr_light_lvls(void) const;
 
   /**
-   * @returns Elapsed time in current state as `Kernel::Clock::duration`.
+   * @returns Elapsed time in current state as `vehicle_duration`.
    */
-  Kernel::Clock::duration get_elapsed_time_in_state(void) const;
+  vehicle_duration get_elapsed_time_in_state(void) const;
 
   /**
-   * @returns The minimum duration for a given state as
-   * `Kernel::Clock::duration`.
+   * @returns The minimum duration for a given state as `vehicle_duration`.
    */
-  Kernel::Clock::duration get_min_duration(StateEnum state) const;
+  vehicle_duration get_min_duration(StateEnum state) const;
+
+  /**
+   * @returns The time left until the minimum duration of the current state is
+   * up and the next `run_fsm_cycle` transitions, or 0 if it already is.
+   */
+  vehicle_duration get_time_until_transition(void) const;
+
+  /**
+   * @returns Whether the current state needs `run_fsm_cycle` to be called
+   * between transitions to react to the sensors. If not, the FSM only has to
+   * run when `get_time_until_transition` is up.
+   */
+  bool needs_control_updates(void) const;
 
   /**
    * @brief Sets the direction and "speed" (PWM duty cycle) of the left and
@@ -80,72 +109,185 @@ class VehicleContext {
   void set_motor_speeds(Direction dir_l, Direction dir_r, float pwm_l,
                         float pwm_r);
 
+  /**
+   * @brief Sets the motor speeds from the current light levels using the
+   * Braitenberg controller. Negative outputs drive the wheel in reverse.
+   * @param coeffs The coefficients of the current behavior.
+   * @note Does nothing with batched control enabled.
+   */
+  void drive(const BraitenbergCoeffs& coeffs);
+
+  /**
+   * @brief Selects whether `drive` sets the motors itself, or leaves them to
+   * a batched `braitenberg_compute_batch` pass over many vehicles.
+   * @param batched `true` to leave the motors to the batched pass.
+   */
+  void set_batched_control(bool batched);
+
   /**
    * @brief Updates the probability table using built-in reward mechanisms and
    * internal states. Reward mechanism based on minimizing light levels.
+   * @note If the learner store defers updates, the table changes on the next
+   * batched pass instead.
+   * @param reward The reward from `calculate_reward`.
    */
-  void update_probability_table(float reward);
+  void update_probability_table(reward_t reward);
 
   /**
    * @returns The next state based on current probabilities, optionally
-   * influenced by communication.
+   * influenced by communication. Runs in O(1) apart from rebuilding the alias
+   * table of a row that changed since it was last sampled, or in
+   * O(`NUM_STATES`) while other vehicles influence the row.
    */
   StateEnum sample_next_state(void);
 
+  /**
+   * @brief Reads how received communication should temporarily modify
+   * probabilities, without touching the probability table, for
+   * `sample_next_state`. Each state is shifted by up to
+   * `m_max_influence_shift` (down to the minimum probability): up if other
+   * vehicles reported it led to darkness, down if it led to light. The shift
+   * grows with the average reported light change, saturating at
+   * `m_influence_delta_scale`, and with the number of recent reports.
+   * @param row The current state's row of the probability table.
+   * @param influenced Written with the shifted row, which no longer sums to
+   * `PROB_ONE`.
+   * @returns `true` if any state was shifted, otherwise `false` and
+   * `influenced` is unused.
+   */
+  bool influence_probabilities(const prob_t* row, reward_t* influenced);
+
+  /**
+   * @returns The state the vehicle is currently in.
+   */
+  StateEnum get_curr_state(void) const;
+
+  /**
+   * @param from The state being transitioned out of.
+   * @param to The state being transitioned into.
+   * @returns The learned probability of transitioning from `from` to `to`.
+   */
+  float get_transition_probability(StateEnum from, StateEnum to) const;
+
+  /**
+   * @brief Records transitions, rewards, probability table updates and sent
+   * messages to `trace` from now on.
+   * @param trace The recorder for the FSM thread, or `nullptr` to stop
+   * tracing.
+   * @note Probability updates are only traced when the learner store applies
+   * them immediately.
+   */
+  void set_trace(TraceRecorder* trace);
+
+  /**
+   * @brief Times `run_fsm_cycle`, `read_sensors`, the `execute` of each state
+   * and `transition_to` into `profiler` from now on.
+   * @param profiler The profiler, or `nullptr` to stop profiling.
+   */
+  void set_profiler(Profiler* profiler);
+
+  /**
+   * @brief Restarts the vehicle's random stream, which decides when messages
+   * are sent and samples the next state. Vehicles with the same seed and
+   * different streams draw independent sequences, so a swarm can share one
+   * seed and still be reproducible and uncorrelated. Until seeded, the seed
+   * and stream are 0.
+   * @note Only call before the FSM starts running, or from the FSM thread.
+   * @param seed The seed, e.g. from a hardware entropy source.
+   * @param stream Selects one of 2^63 streams, e.g. the vehicle's ID, or its
+   * slot in a simulated swarm.
+   */
+  void seed_random(uint64_t seed, uint64_t stream);
+
+  /**
+   * @brief Records every input the FSM takes to `recorder` from now on,
+   * starting with its current state, so the run can be replayed on the host.
+   * @param recorder The recorder for the FSM thread, or `nullptr` to stop
+   * recording.
+   * @note Only call before the FSM starts running, or from the FSM thread.
+   */
+  void set_recorder(RunRecorder* recorder);
+
+  /**
+   * @brief Takes the FSM's clock reads, sensor samples, random draws and
+   * influence reads from `source` instead of the hardware, the random stream
+   * and `m_comms_ctx`, to replay a recorded run.
+   * @param source The recorded inputs, or `nullptr` to use the live ones.
+   */
+  void set_input_source(RunInputSource* source);
+
+  /**
+   * @brief Restores the light level calibration and probability table from a
+   * snapshot, e.g. one persisted before a reboot.
+   * @note Only call before the FSM starts running.
+   * @param buffer The snapshot, in the format described in LearnerSnapshot.h.
+   * @param size The size of the snapshot in bytes.
+   * @returns `true` if it was restored, or `false` if it was invalid and the
+   * vehicle keeps starting from scratch.
+   */
+  bool restore_snapshot(const uint8_t* buffer, size_t size);
+
+  /**
+   * @brief Asks the FSM to snapshot the light level calibration and
+   * probability table at the start of its next cycle, so the snapshot is
+   * consistent. Safe to call from any thread.
+   */
+  void request_snapshot(void);
+
+  /**
+   * @brief Copies the snapshot made since the last `request_snapshot`. Safe to
+   * call from any thread.
+   * @param out Buffer to write the snapshot to, `SNAPSHOT_SIZE` bytes.
+   * @returns `true` if the snapshot was copied, or `false` if it isn't ready.
+   */
+  bool try_take_snapshot(uint8_t* out);
+
   /**
    * The CommsContext object for communication using the RF transceiver.
    */
   CommsContext m_comms_ctx;
 
  private:
-  // for photoresistors
-  AnalogIn m_ldr_l;
-  AnalogIn m_ldr_r;
-  DigitalOut m_ldr_l_gnd;
-  DigitalOut m_ldr_r_gnd;
-
-  // for motor control
-  DigitalOut m_mtr_l_in1;
-  DigitalOut m_mtr_l_in2;
-  PwmOut m_mtr_l_pwm;
-  DigitalOut m_mtr_r_in3;
-  DigitalOut m_mtr_r_in4;
-  PwmOut m_mtr_r_pwm;
+  // for hardware access
+  LightSensorInterface& m_sensors;
+  MotorInterface& m_motors;
+  LedInterface& m_leds;
+  ClockInterface& m_clock;
 
   // state node instances
-  IdleStateNode m_state_idle;
-  AggressiveStateNode m_state_aggressive;
-  CowardStateNode m_state_coward;
-  ExplorerStateNode m_state_explorer;
-  LoveStateNode m_state_love;
-  StateNode* m_state_node_instances[NUM_STATES];
-
-  // for internal FSM state and other values
-  StateNode* m_curr_state_ptr;
-  StateEnum m_curr_state;
-  StateEnum m_prev_state;
-  Kernel::Clock::time_point m_time_state_entry;
-  LightLevels m_light_lvl_entry;
-  LightLevels m_light_lvl_curr;
-  LightLevels m_light_lvl_min;
-  LightLevels m_light_lvl_max;
+  VehicleStates::storage m_states;
+
+  // for internal FSM state, light levels and the probability table, kept in
+  // our slot of the learner store
+  LearnerStore& m_learner;
+  const size_t m_slot;
 
   // for learning and other things
-  float m_probability_table[NUM_STATES][NUM_STATES];
-  float m_comms_influence;
-  const float m_learning_rate;
-  const float m_ci_change_rate;
-
-  // for miscellaneous configuration
-  const Kernel::Clock::duration m_min_state_duration[NUM_STATES] = {
-      2500ms,  // IDLE
-      5000ms,  // TOWARDS_LIGHT
-      5000ms,  // AWAY_LIGHT
-      5000ms,  // TOWARDS_DARK
-      5000ms,  // AWAY_DARK
+  const uint16_t m_vehicle_id;
+  const VehicleParams m_params;
+  const reward_t m_learning_rate;
+  // `send_chance` scaled to compare against a 32-bit random draw
+  const uint64_t m_send_threshold;
+  const float m_max_influence_shift = 0.2f;
+  const float m_influence_delta_scale = 0.05f;
+  const float m_min_influence_weight = 0.05f;
+  bool m_batched_control = false;
+  TraceRecorder* m_trace = nullptr;
+  Profiler* m_profiler = nullptr;
+  RunRecorder* m_recorder = nullptr;
+  RunInputSource* m_input_source = nullptr;
+
+  // Our own random stream, drawn from by the FSM thread only
+  Pcg32 m_rng;
+
+  // Snapshot handed from the FSM thread to whoever requested it
+  enum SnapshotStatus : uint8_t {
+    SNAPSHOT_NONE,
+    SNAPSHOT_REQUESTED,
+    SNAPSHOT_READY,
   };
-  DigitalOut m_g_led;
-  DigitalOut m_r_led;
+  std::atomic<SnapshotStatus> m_snapshot_status{SNAPSHOT_NONE};
+  uint8_t m_snapshot[SNAPSHOT_SIZE];
 
   /**
    * @brief Initializes the FSM, state tables, and prepares vehicle context for
@@ -154,13 +296,18 @@ class VehicleContext {
   void initialize_fsm(void);
 
   /**
+   * @brief Calls `fn` with the node of the requested state.
    * @param state The state requested.
-   * @return A pointer to the `StateNode` object containing the requested state.
+   * @param fn A callable taking any state class by reference.
    */
-  StateNode* get_state_node(StateEnum state) const;
+  template <typename F>
+  void with_state_node(StateEnum state, F&& fn) {
+    VehicleStates::dispatch(m_states, state, std::forward<F>(fn));
+  }
 
   /**
-   * @brief Reads values from the LDRs and writes them to `m_light_lvl_curr`.
+   * @brief Reads values from the LDRs and writes them to the current light
+   * levels in the learner store.
    * Continually normalizes the values. Values are guaranteed to always be
    * between 0.0 - 1.0 (inclusive).
    */
@@ -173,25 +320,26 @@ class VehicleContext {
    * the state transition.
    * @param after The `LightLevels` object containing the light levels after
    * exiting the previous state.
-   * @returns A floating point value representing the reward.
+   * @returns The reward, in the same format as a probability (`reward_t`).
+   */
+  reward_t calculate_reward(LightLevels before, LightLevels after);
+
+  /**
+   * @returns The current time, from the clock or the input source.
    */
-  float calculate_reward(LightLevels before, LightLevels after);
+  vehicle_duration now(void) const;
 
   /**
-   * @brief Internal function to normalize the probabilities such that:
-   * - They always sum to 1.0.
-   * - They are always between 0.01 - 1.0 (inclusive).
-   * @param state The state to normalize their probability table for.
+   * @returns 32 random bits from the vehicle's random stream, or from the
+   * input source.
    */
-  void normalize_probabilities(StateEnum state);
+  uint32_t draw_random(void);
 
   /**
-   * @brief Internal function to temporarily modify probabilities based on
-   * received communication.
-   * @param probabilities A float pointer to the state probability array to
-   * influence.
+   * @returns A uniform random sample: a float from 0.0 - 1.0 (exclusive), or
+   * 16 random bits for the fixed-point learner.
    */
-  void influence_probabilities(float* probabilities);
+  sample_t draw_sample(void);
 
   /**
    * @brief Internal function to set the red and green LEDs depending on state.
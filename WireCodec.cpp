@@ -0,0 +1,84 @@
+#include "WireCodec.h"
+
+// Header field offsets
+const int WIRE_OFFSET_VERSION = 0;
+const int WIRE_OFFSET_COUNT = 1;
+const int WIRE_OFFSET_RECORD_SIZE = 2;
+const int WIRE_OFFSET_SENDER_ID = 3;
+const int WIRE_OFFSET_SEQ = 5;
+
+static inline void write_u16(uint8_t* dst, uint16_t value) {
+  dst[0] = static_cast<uint8_t>(value);
+  dst[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static inline uint16_t read_u16(const uint8_t* src) {
+  return static_cast<uint16_t>(src[0] | (src[1] << 8));
+}
+
+WireEncoder::WireEncoder(char* buffer, uint16_t sender_id, uint16_t seq)
+    : m_buffer(reinterpret_cast<uint8_t*>(buffer)), m_count(0) {
+  memset(m_buffer, 0, MSG_SIZE);
+  m_buffer[WIRE_OFFSET_VERSION] = WIRE_VERSION;
+  m_buffer[WIRE_OFFSET_COUNT] = 0;
+  m_buffer[WIRE_OFFSET_RECORD_SIZE] = WIRE_RECORD_SIZE;
+  write_u16(&m_buffer[WIRE_OFFSET_SENDER_ID], sender_id);
+  write_u16(&m_buffer[WIRE_OFFSET_SEQ], seq);
+}
+
+bool WireEncoder::add(const CommsMsg& msg) {
+  if (is_full()) {
+    return false;
+  }
+
+  uint8_t* record =
+      &m_buffer[WIRE_HEADER_SIZE + m_count * WIRE_RECORD_SIZE];
+  record[0] = wire_quantize_lvl(msg.prev_lvls.lvl_left);
+  record[1] = wire_quantize_lvl(msg.prev_lvls.lvl_right);
+  record[2] = wire_quantize_lvl(msg.curr_lvls.lvl_left);
+  record[3] = wire_quantize_lvl(msg.curr_lvls.lvl_right);
+  record[4] = msg.prev_state;
+
+  m_buffer[WIRE_OFFSET_COUNT] = ++m_count;
+  return true;
+}
+
+int WireEncoder::get_count(void) const { return m_count; }
+
+bool WireEncoder::is_full(void) const { return m_count >= WIRE_MAX_RECORDS; }
+
+WireView::WireView(const char* buffer)
+    : m_buffer(reinterpret_cast<const uint8_t*>(buffer)) {}
+
+bool WireView::is_valid(void) const {
+  // Any version from 1 up uses this header. Records may have grown, but
+  // never shrunk.
+  int record_size = m_buffer[WIRE_OFFSET_RECORD_SIZE];
+  return m_buffer[WIRE_OFFSET_VERSION] >= 1 &&
+         record_size >= WIRE_RECORD_SIZE &&
+         WIRE_HEADER_SIZE + get_count() * record_size <= MSG_SIZE;
+}
+
+uint16_t WireView::get_sender_id(void) const {
+  return read_u16(&m_buffer[WIRE_OFFSET_SENDER_ID]);
+}
+
+uint16_t WireView::get_seq(void) const {
+  return read_u16(&m_buffer[WIRE_OFFSET_SEQ]);
+}
+
+int WireView::get_count(void) const { return m_buffer[WIRE_OFFSET_COUNT]; }
+
+CommsMsg WireView::get_record(int index) const {
+  const uint8_t* record =
+      &m_buffer[WIRE_HEADER_SIZE + index * m_buffer[WIRE_OFFSET_RECORD_SIZE]];
+  CommsMsg msg = {
+      .prev_lvls = {wire_dequantize_lvl(record[0]),
+                    wire_dequantize_lvl(record[1])},
+      .curr_lvls = {wire_dequantize_lvl(record[2]),
+                    wire_dequantize_lvl(record[3])},
+      .prev_state = static_cast<StateEnum>(record[4]),
+      .sender_id = get_sender_id(),
+  };
+  return msg;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <cstdint>
+
+#include "Globals.h"
+
+/*
+ * Binary format of a radio payload (`MSG_SIZE` bytes, little endian):
+ *
+ *   offset  size  field
+ *   0       1     version, `WIRE_VERSION`
+ *   1       1     number of records
+ *   2       1     size of each record in bytes
+ *   3       2     sender ID
+ *   5       2     sequence number, incremented for every payload sent
+ *   7       ...   records, followed by zero padding
+ *
+ * Each record is one transition report (`CommsMsg` without the sender):
+ *
+ *   0       1     prev_lvls.lvl_left, quantized to 0 - 255
+ *   1       1     prev_lvls.lvl_right
+ *   2       1     curr_lvls.lvl_left
+ *   3       1     curr_lvls.lvl_right
+ *   4       1     prev_state
+ *
+ * New fields may only be appended to records, with a larger record size in
+ * the header. Decoders read the fields they know and skip the rest, so older
+ * vehicles keep understanding newer ones.
+ */
+
+const uint8_t WIRE_VERSION = 1;
+const int WIRE_HEADER_SIZE = 7;
+const int WIRE_RECORD_SIZE = 5;
+const int WIRE_MAX_RECORDS = (MSG_SIZE - WIRE_HEADER_SIZE) / WIRE_RECORD_SIZE;
+
+/**
+ * @returns A light level from 0.0 - 1.0 quantized to 8 bits, rounding to
+ * nearest. Values outside the range are clamped.
+ */
+inline uint8_t wire_quantize_lvl(float lvl) {
+  float scaled = lvl * 255.0f + 0.5f;
+  scaled = scaled > 0.0f ? scaled : 0.0f;
+  scaled = scaled < 255.0f ? scaled : 255.0f;
+  return static_cast<uint8_t>(scaled);
+}
+
+/**
+ * @returns The light level from 0.0 - 1.0 for a quantized level.
+ */
+inline float wire_dequantize_lvl(uint8_t lvl) {
+  return static_cast<float>(lvl) * (1.0f / 255.0f);
+}
+
+/**
+ * @brief Packs transition reports into a payload buffer.
+ */
+class WireEncoder {
+ public:
+  /**
+   * @brief Writes the header to `buffer` and zeroes the rest.
+   * @param buffer The payload buffer, `MSG_SIZE` bytes.
+   * @param sender_id The ID of the sending vehicle.
+   * @param seq The sequence number of the payload.
+   */
+  WireEncoder(char* buffer, uint16_t sender_id, uint16_t seq);
+
+  /**
+   * @brief Appends a record for `msg`. `msg.sender_id` is ignored in favor of
+   * the header's.
+   * @returns `true` if the record was added, or `false` if the payload is
+   * full.
+   */
+  bool add(const CommsMsg& msg);
+
+  /**
+   * @returns The number of records in the payload.
+   */
+  int get_count(void) const;
+
+  /**
+   * @returns `true` if no more records fit in the payload.
+   */
+  bool is_full(void) const;
+
+ private:
+  uint8_t* m_buffer;
+  int m_count;
+};
+
+/**
+ * @brief Decodes a received payload in place, without copying it.
+ * @note Only valid for as long as the buffer is.
+ */
+class WireView {
+ public:
+  /**
+   * @param buffer The received payload, `MSG_SIZE` bytes.
+   */
+  explicit WireView(const char* buffer);
+
+  /**
+   * @returns `true` if the payload has a known version and its records fit
+   * in the payload. Check before calling any other function.
+   */
+  bool is_valid(void) const;
+
+  uint16_t get_sender_id(void) const;
+  uint16_t get_seq(void) const;
+  int get_count(void) const;
+
+  /**
+   * @returns The record at `index` (from 0 - `get_count()`, exclusive).
+   */
+  CommsMsg get_record(int index) const;
+
+ private:
+  const uint8_t* m_buffer;
+};
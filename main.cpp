@@ -1,24 +1,193 @@
+#include <algorithm>
+
 #include "CommsContext.h"
+#include "LearnerStore.h"
+#include "MbedHal.h"
+#include "Profiler.h"
+#include "RunRecorder.h"
+#include "TraceRecorder.h"
 #include "VehicleContext.h"
 #include "mbed.h"
 
-// For seeding srand()
+// For seeding the vehicle's random stream
 #define PIN_ENTROPY PF_4
 
-// Set tick rates for each thread.
-const auto FSM_TICK_RATE = 10ms;
+// Set tick rates for each thread. In event driven mode, the FSM tick rate is
+// only used while the current state reacts to the sensors.
+const auto FSM_TICK_RATE =
+    std::chrono::milliseconds(MBED_CONF_APP_FSM_TICK_RATE_MS);
 const auto COMMS_TICK_RATE = 10ms;
 
-// Set up the threads, entropy pin, and vehicle context.
-VehicleContext vehicle_ctx(PC_1, PF_10, PC_0, PF_9, PF_5, PF_3, PF_1, PC_15,
-                           PF_6, PA_3, PG_13, PG_14);
-AnalogIn entropy(PIN_ENTROPY);
+// Safety net for the interrupt driven comms thread, in case an edge of the
+// transceiver's IRQ line is missed.
+const auto COMMS_IRQ_TIMEOUT = 100ms;
+
+// Read the entropy pin for seeding the random stream before anything else,
+// since it shares ADC3 with the LDRs.
+const uint16_t ENTROPY_SEED = AnalogIn(PIN_ENTROPY).read_u16();
+
+// Set up the hardware for the vehicle context.
+#if MBED_CONF_APP_LDR_DMA
+#ifndef TARGET_STM32F4
+#error "ldr-dma needs an STM32F4 target, set it to false in mbed_app.json"
+#endif
+DmaLightSensor sensors(PC_1, PF_10, PC_0, PF_9);
+#else
+MbedLightSensor sensors(PC_1, PF_10, PC_0, PF_9);
+#endif
+MbedMotorDriver motors(PF_5, PF_3, PF_1, PC_15, PF_6, PA_3);
+MbedLeds leds(PG_13, PG_14);
+MbedClock fsm_clock;
+
+// ID sent with our messages and used for our unicast address. Unless set in
+// mbed_app.json, it's derived from the MCU's unique ID, so every vehicle can
+// run the same image.
+#ifdef MBED_CONF_APP_VEHICLE_ID
+const uint16_t VEHICLE_ID = MBED_CONF_APP_VEHICLE_ID;
+#else
+const uint16_t VEHICLE_ID = mbed_device_vehicle_id();
+#endif
+
+MbedRadio radio(PE_14, PE_13, PE_12, PE_11, PE_9, VEHICLE_ID,
+                MBED_CONF_APP_RADIO_GROUPS, MBED_CONF_APP_NRF_IRQ_PIN);
+
+// Learning state for our one vehicle, persisted to internal flash every
+// persist period so it survives reboots.
+LearnerStore learner_store(1);
+MbedKvStorage storage;
+const char* const SNAPSHOT_KEY = "learner";
+const auto PERSIST_PERIOD =
+    std::chrono::seconds(MBED_CONF_APP_PERSIST_PERIOD_S);
+
+// Set up the threads and vehicle context.
+VehicleContext vehicle_ctx(sensors, motors, leds, fsm_clock, radio,
+                           learner_store, 0, VEHICLE_ID);
 Thread thread_fsm;
 Thread thread_comms;
 
+#if MBED_CONF_APP_TRACE_ENABLED
+// One trace recorder per recording thread, streamed out over a UART of its
+// own so the trace never mixes with printf output.
+const auto TRACE_DRAIN_PERIOD = 50ms;
+TraceRecorder fsm_trace(fsm_clock);
+TraceRecorder comms_trace(fsm_clock);
+BufferedSerial trace_serial(MBED_CONF_APP_TRACE_TX_PIN, NC,
+                            MBED_CONF_APP_TRACE_BAUD);
+Thread thread_trace(osPriorityLow, 1024);
+
+// Main procedure for the trace drain. Runs below the FSM and comms threads,
+// so streaming the trace never delays them.
+void trace_proc() {
+  uint8_t buffer[16 * TRACE_FRAME_SIZE];
+  TraceRecorder* traces[] = {&fsm_trace, &comms_trace};
+  while (true) {
+    ThisThread::sleep_for(TRACE_DRAIN_PERIOD);
+    for (TraceRecorder* trace : traces) {
+      size_t size;
+      while ((size = trace->drain(buffer, sizeof(buffer))) > 0) {
+        trace_serial.write(buffer, size);
+      }
+    }
+  }
+}
+#endif
+
+#if MBED_CONF_APP_RECORD_ENABLED
+#if MBED_CONF_APP_TRACE_ENABLED
+#error "trace-enabled and record-enabled share the trace UART, enable one"
+#endif
+// One run recorder per recording thread, streamed out over the trace UART.
+// Unlike the trace, a recording is only useful if no records are lost, so it
+// is drained more often.
+const auto RECORD_DRAIN_PERIOD = 20ms;
+RunRecorder fsm_record(RUN_STREAM_FSM);
+RunRecorder comms_record(RUN_STREAM_COMMS);
+BufferedSerial record_serial(MBED_CONF_APP_TRACE_TX_PIN, NC,
+                             MBED_CONF_APP_TRACE_BAUD);
+Thread thread_record(osPriorityLow, 1024);
+
+// Main procedure for the recording drain. Runs below the FSM and comms
+// threads, like the trace drain.
+void record_proc() {
+  uint8_t buffer[8 * RUN_MAX_FRAME_SIZE];
+  RunRecorder* records[] = {&fsm_record, &comms_record};
+  while (true) {
+    ThisThread::sleep_for(RECORD_DRAIN_PERIOD);
+    for (RunRecorder* record : records) {
+      size_t size;
+      while ((size = record->drain(buffer, sizeof(buffer))) > 0) {
+        record_serial.write(buffer, size);
+      }
+    }
+  }
+}
+#endif
+
+#if MBED_CONF_APP_PROFILE_ENABLED
+// Timings of the FSM and comms hot paths, reported from the main loop.
+Profiler profiler;
+
+// Tick counter value the FSM thread is due to wake at, if it is asleep
+uint32_t fsm_wake_due;
+bool fsm_wake_pending = false;
+#endif
+
+// Called by the FSM thread before it sleeps for `delay`.
+inline void fsm_sleeping(vehicle_duration delay) {
+#if MBED_CONF_APP_PROFILE_ENABLED
+  fsm_wake_due = profile_now() + profile_ticks(delay);
+  fsm_wake_pending = true;
+#endif
+}
+
+// Called by the FSM thread when it wakes for a tick, to record how late it
+// is.
+inline void fsm_woke() {
+#if MBED_CONF_APP_PROFILE_ENABLED
+  if (fsm_wake_pending) {
+    // Sleeps are rounded to the kernel tick, so the thread may wake early
+    int32_t late = static_cast<int32_t>(profile_now() - fsm_wake_due);
+    profiler.get(PROFILE_FSM_WAKE)
+        .record(late > 0 ? static_cast<uint32_t>(late) : 0);
+    fsm_wake_pending = false;
+  }
+#endif
+}
+
+#if MBED_CONF_APP_FSM_EVENT_DRIVEN
+// Only one FSM event is ever pending
+EventQueue fsm_queue(4 * EVENTS_EVENT_SIZE);
+
+// Runs an FSM tick, then schedules the next one. The thread sleeps in between,
+// so with tickless idle the MCU stays asleep until the next event.
+void fsm_event() {
+  fsm_woke();
+#ifdef PRINT_DEBUG
+  printf("Running FSM tick\r\n");
+#endif
+  vehicle_ctx.run_fsm_cycle();
+
+  // Wake exactly when the current state's minimum duration is up, and at the
+  // tick rate before then if the state reacts to the sensors.
+  auto delay = vehicle_ctx.get_time_until_transition();
+  if (vehicle_ctx.needs_control_updates()) {
+    delay = std::min<vehicle_duration>(delay, FSM_TICK_RATE);
+  }
+  delay = std::max<vehicle_duration>(delay, 1ms);
+  fsm_sleeping(delay);
+  fsm_queue.call_in(delay, fsm_event);
+}
+
+// Main procedure for FSM
+void fsm_proc() {
+  fsm_queue.call(fsm_event);
+  fsm_queue.dispatch_forever();
+}
+#else
 // Main procedure for FSM
 void fsm_proc() {
   while (true) {
+    fsm_woke();
     auto cycle_start = Kernel::Clock::now();
 
 #ifdef PRINT_DEBUG
@@ -32,31 +201,68 @@ void fsm_proc() {
     // If the tick completes earlier than our tick rate, defer to the other
     // thread.
     if (cycle_delta < FSM_TICK_RATE) {
+      fsm_sleeping(FSM_TICK_RATE - cycle_delta);
       ThisThread::sleep_for(FSM_TICK_RATE - cycle_delta);
     }
   }
 }
+#endif
 
 // Main procedure for communication thread
 void comms_proc() {
+  CommsContext& comms_ctx = vehicle_ctx.m_comms_ctx;
+  auto timeout =
+      comms_ctx.is_irq_driven() ? COMMS_IRQ_TIMEOUT : COMMS_TICK_RATE;
   while (true) {
-    auto cycle_start = Kernel::Clock::now();
-
-    vehicle_ctx.m_comms_ctx.run_comms_cycle();
-
-    auto cycle_end = Kernel::Clock::now();
-    auto cycle_delta = cycle_end - cycle_start;
-
-    // If the tick completes earlier than our tick rate, defer to the other
-    // thread.
-    if (cycle_delta < COMMS_TICK_RATE) {
-      ThisThread::sleep_for(COMMS_TICK_RATE - cycle_delta);
+    // Sleep until a message arrives or is queued for transmission (or the
+    // polling period passes without an IRQ line), then handle everything
+    // that's waiting.
+    comms_ctx.wait_for_activity(timeout);
+    while (comms_ctx.run_comms_cycle()) {
     }
   }
 }
 
 int main() {
-  srand(entropy.read_u16());
+  vehicle_ctx.seed_random(ENTROPY_SEED, VEHICLE_ID);
+
+  // Warm start from what we learned before the last reboot, if anything.
+  uint8_t snapshot[SNAPSHOT_SIZE];
+  int snapshot_size = storage.load(SNAPSHOT_KEY, snapshot, sizeof(snapshot));
+  if (snapshot_size > 0 &&
+      vehicle_ctx.restore_snapshot(snapshot, snapshot_size)) {
+#ifdef PRINT_DEBUG
+    printf("Restored learner snapshot\r\n");
+#endif
+  }
+
+#if MBED_CONF_APP_PROFILE_ENABLED
+  // A cycle or wake-up taking longer than a tick counts as an overrun.
+  profile_init();
+  profiler.get(PROFILE_FSM_CYCLE).set_budget(profile_ticks(FSM_TICK_RATE));
+  profiler.get(PROFILE_FSM_WAKE).set_budget(profile_ticks(FSM_TICK_RATE));
+  profiler.get(PROFILE_COMMS_CYCLE).set_budget(profile_ticks(COMMS_TICK_RATE));
+  vehicle_ctx.set_profiler(&profiler);
+  vehicle_ctx.m_comms_ctx.set_profiler(&profiler);
+#endif
+
+#if MBED_CONF_APP_TRACE_ENABLED
+  vehicle_ctx.set_trace(&fsm_trace);
+  vehicle_ctx.m_comms_ctx.set_trace(&comms_trace);
+  if (thread_trace.start(trace_proc) != osOK) {
+    error("Failed to start trace thread\r\n");
+  }
+#endif
+
+#if MBED_CONF_APP_RECORD_ENABLED
+  // Record from the restored state on, so a replay starts where we do.
+  fsm_record.record_seed(ENTROPY_SEED);
+  vehicle_ctx.set_recorder(&fsm_record);
+  vehicle_ctx.m_comms_ctx.set_recorder(&comms_record);
+  if (thread_record.start(record_proc) != osOK) {
+    error("Failed to start record thread\r\n");
+  }
+#endif
 
   // If either the FSM or communication thread fails to initialize,
   // crash with an error.
@@ -76,9 +282,37 @@ int main() {
   printf("Initialized comms thread\r\n");
 #endif
 
-  // And just defer forever.
+  // And just defer forever, apart from persisting the learner.
+#if MBED_CONF_APP_PERSIST_PERIOD_S > 0
+  auto next_persist = Kernel::Clock::now() + PERSIST_PERIOD;
+#endif
   while (true) {
     ThisThread::sleep_for(5s);
+
+#if MBED_CONF_APP_PERSIST_PERIOD_S > 0
+    // Store the snapshot the FSM took since the last loop. Flash writes can
+    // stall for a while, so they happen here rather than on the FSM thread.
+    if (vehicle_ctx.try_take_snapshot(snapshot) &&
+        !storage.store(SNAPSHOT_KEY, snapshot, SNAPSHOT_SIZE)) {
+#ifdef PRINT_DEBUG
+      printf("Failed to store learner snapshot\r\n");
+#endif
+    }
+    if (Kernel::Clock::now() >= next_persist) {
+      vehicle_ctx.request_snapshot();
+      next_persist += PERSIST_PERIOD;
+    }
+#endif
+#if MBED_CONF_APP_PROFILE_ENABLED
+    profiler.print_report();
+#endif
+#ifdef PRINT_DEBUG
+    printf("Reports received: %lu, outgoing messages dropped: %lu\r\n",
+           (unsigned long)vehicle_ctx.m_comms_ctx.get_num_rx_reports(),
+           (unsigned long)vehicle_ctx.m_comms_ctx.get_num_tx_dropped());
+    printf("Vehicle %u, neighbors: %d\r\n", (unsigned)VEHICLE_ID,
+           vehicle_ctx.m_comms_ctx.get_num_neighbors());
+#endif
   }
 
   return 0;
@@ -0,0 +1,129 @@
+#include "HostHal.h"
+
+#include <cstdio>
+
+HostLightSensor::HostLightSensor(LightLevels initial) : m_levels(initial) {}
+
+LightLevels HostLightSensor::read(void) { return m_levels; }
+
+void HostLightSensor::set_levels(LightLevels levels) { m_levels = levels; }
+
+void HostMotorDriver::set_motor_speeds(Direction dir_l, Direction dir_r,
+                                       float pwm_l, float pwm_r) {
+  m_command = {dir_l, dir_r, pwm_l, pwm_r};
+}
+
+MotorCommand HostMotorDriver::get_command(void) const { return m_command; }
+
+void HostLeds::set_leds(bool green, bool red) {
+  m_green = green;
+  m_red = red;
+}
+
+bool HostLeds::get_green(void) const { return m_green; }
+
+bool HostLeds::get_red(void) const { return m_red; }
+
+vehicle_duration HostClock::now(void) const { return m_now; }
+
+void HostClock::advance(vehicle_duration delta) { m_now += delta; }
+
+HostRadio::HostRadio(uint16_t vehicle_id, uint8_t groups)
+    : m_vehicle_id(vehicle_id), m_groups(groups) {}
+
+bool HostRadio::readable(void) { return !m_rx.empty(); }
+
+int HostRadio::read(char* buffer, int size) {
+  if (m_rx.empty()) {
+    return 0;
+  }
+
+  int count = std::min(size, static_cast<int>(MSG_SIZE));
+  memcpy(buffer, m_rx.front().data(), count);
+  m_rx.pop_front();
+  return count;
+}
+
+int HostRadio::write(const char* buffer, int size, uint16_t dest) {
+  // Like the nRF24L01P, every transmission is a full fixed size payload.
+  payload data = {};
+  memcpy(data.data(), buffer, std::min(size, static_cast<int>(MSG_SIZE)));
+  m_tx.emplace_back(data, dest);
+  return MSG_SIZE;
+}
+
+bool HostRadio::accepts(uint16_t dest) const {
+  if (dest == RADIO_BROADCAST_ID) {
+    return true;
+  }
+  if (dest > RADIO_GROUP_ID_BASE) {
+    int group = dest - RADIO_GROUP_ID_BASE;
+    return group <= RADIO_NUM_GROUPS && (m_groups & (1 << (group - 1)));
+  }
+  return dest == m_vehicle_id;
+}
+
+bool HostRadio::attach_irq(Callback<void()> handler) {
+  m_irq_handler = handler;
+  return true;
+}
+
+bool HostRadio::inject(const char* buffer, int size) {
+  if (m_rx.size() >= RX_FIFO_DEPTH) {
+    return false;
+  }
+
+  payload data = {};
+  memcpy(data.data(), buffer, std::min(size, static_cast<int>(MSG_SIZE)));
+  m_rx.push_back(data);
+  if (m_irq_handler) {
+    m_irq_handler();
+  }
+  return true;
+}
+
+bool HostRadio::take_transmitted(payload& out, uint16_t& dest) {
+  if (m_tx.empty()) {
+    return false;
+  }
+
+  out = m_tx.front().first;
+  dest = m_tx.front().second;
+  m_tx.pop_front();
+  return true;
+}
+
+HostFileStorage::HostFileStorage(std::string directory)
+    : m_directory(std::move(directory)) {}
+
+std::string HostFileStorage::get_path(const char* key) const {
+  return m_directory + "/" + key + ".bin";
+}
+
+int HostFileStorage::load(const char* key, void* buffer, size_t size) {
+  FILE* file = fopen(get_path(key).c_str(), "rb");
+  if (file == nullptr) {
+    return -1;
+  }
+
+  size_t count = fread(buffer, 1, size, file);
+  bool failed = ferror(file);
+  fclose(file);
+  return failed ? -1 : static_cast<int>(count);
+}
+
+bool HostFileStorage::store(const char* key, const void* buffer,
+                            size_t size) {
+  // Write to a temporary file and rename it over the old one, so a crash
+  // midway leaves the previous value intact like TDBStore would.
+  std::string path = get_path(key);
+  std::string tmp_path = path + ".tmp";
+  FILE* file = fopen(tmp_path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  bool ok = fwrite(buffer, 1, size, file) == size;
+  ok = (fclose(file) == 0) && ok;
+  return ok && rename(tmp_path.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include <array>
+#include <deque>
+#include <string>
+#include <utility>
+
+#include "../HalInterfaces.h"
+
+/**
+ * @brief Last command written to a simulated motor driver.
+ */
+struct MotorCommand {
+  Direction dir_l;
+  Direction dir_r;
+  float pwm_l;
+  float pwm_r;
+};
+
+/**
+ * @brief Simulated LDR pair. Returns whatever levels were last set, usually
+ * by the simulated world before each FSM tick.
+ */
+class HostLightSensor : public LightSensorInterface {
+ public:
+  explicit HostLightSensor(LightLevels initial = {0.0f, 0.0f});
+
+  LightLevels read(void) override;
+
+  /**
+   * @brief Sets the raw levels returned by the next reads.
+   */
+  void set_levels(LightLevels levels);
+
+ private:
+  LightLevels m_levels;
+};
+
+/**
+ * @brief Simulated motor driver. Records the last command so the simulated
+ * world can integrate vehicle motion from it.
+ */
+class HostMotorDriver : public MotorInterface {
+ public:
+  void set_motor_speeds(Direction dir_l, Direction dir_r, float pwm_l,
+                        float pwm_r) override;
+
+  /**
+   * @returns The last command written to the motors.
+   */
+  MotorCommand get_command(void) const;
+
+ private:
+  MotorCommand m_command = {STOP, STOP, 0.0f, 0.0f};
+};
+
+/**
+ * @brief Simulated status LEDs.
+ */
+class HostLeds : public LedInterface {
+ public:
+  void set_leds(bool green, bool red) override;
+
+  bool get_green(void) const;
+  bool get_red(void) const;
+
+ private:
+  bool m_green = false;
+  bool m_red = false;
+};
+
+/**
+ * @brief Manually advanced clock. Time only moves when `advance` is called,
+ * which lets the FSM run as fast as the host allows.
+ */
+class HostClock : public ClockInterface {
+ public:
+  vehicle_duration now(void) const override;
+
+  /**
+   * @brief Moves the clock forward by `delta`.
+   */
+  void advance(vehicle_duration delta);
+
+ private:
+  vehicle_duration m_now{0};
+};
+
+/**
+ * @brief Simulated transceiver. Transmitted payloads are held until collected
+ * with `take_transmitted`, and payloads given to `inject` are returned by
+ * `read` in FIFO order. Like `MbedRadio`, it has an ID and may join groups,
+ * which decide the payloads it `accepts`.
+ * @note Not thread-safe. The simulator must not inject or collect payloads
+ * while the owning vehicle is being stepped.
+ */
+class HostRadio : public RadioInterface {
+ public:
+  using payload = std::array<char, MSG_SIZE>;
+
+  /**
+   * @param vehicle_id The ID of the vehicle, below `RADIO_GROUP_ID_BASE`.
+   * @param groups Bit mask of the groups to join, bit 0 for group 1 up to
+   * bit 3 for group 4.
+   */
+  explicit HostRadio(uint16_t vehicle_id = 0, uint8_t groups = 0);
+
+  bool readable(void) override;
+  int read(char* buffer, int size) override;
+  int write(const char* buffer, int size, uint16_t dest) override;
+  bool attach_irq(Callback<void()> handler) override;
+
+  /**
+   * @returns `true` if a payload sent to `dest` is received by this radio, as
+   * the transceiver's address filtering would decide.
+   */
+  bool accepts(uint16_t dest) const;
+
+  /**
+   * @brief Queues a payload to be received and fires the IRQ handler, if one
+   * is attached. Like the nRF24L01P RX FIFO, only `RX_FIFO_DEPTH` payloads are
+   * held, and later payloads are lost.
+   * @param buffer The payload.
+   * @param size Size of the payload in bytes, at most `MSG_SIZE`.
+   * @returns `true` if the payload was queued, otherwise `false`.
+   */
+  bool inject(const char* buffer, int size);
+
+  /**
+   * @brief Pops the oldest transmitted payload.
+   * @param out Payload to write to.
+   * @param dest Written with the destination the payload was sent to.
+   * @returns `true` if a payload was written to `out`, otherwise `false`.
+   */
+  bool take_transmitted(payload& out, uint16_t& dest);
+
+ private:
+  static constexpr size_t RX_FIFO_DEPTH = 3;
+
+  const uint16_t m_vehicle_id;
+  const uint8_t m_groups;
+  std::deque<payload> m_rx;
+  std::deque<std::pair<payload, uint16_t>> m_tx;
+  Callback<void()> m_irq_handler;
+};
+
+/**
+ * @brief Storage in a directory on the host, with one file per key
+ * (`<directory>/<key>.bin`).
+ */
+class HostFileStorage : public StorageInterface {
+ public:
+  /**
+   * @param directory An existing directory to keep the files in.
+   */
+  explicit HostFileStorage(std::string directory);
+
+  int load(const char* key, void* buffer, size_t size) override;
+  bool store(const char* key, const void* buffer, size_t size) override;
+
+ private:
+  const std::string m_directory;
+
+  std::string get_path(const char* key) const;
+};
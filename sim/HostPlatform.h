@@ -0,0 +1,89 @@
+#pragma once
+// Host stand-ins for the parts of Mbed OS used by the portable vehicle code.
+// Only included when building with `HOST_SIM` defined (see Platform.h).
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+
+using namespace std::chrono_literals;
+
+/**
+ * @brief Host replacement for `mbed::Callback`.
+ */
+template <typename F>
+using Callback = std::function<F>;
+
+/**
+ * @brief Host replacement for `mbed::callback`, binding a member function to
+ * an object.
+ */
+template <typename T, typename R, typename... Args>
+Callback<R(Args...)> callback(T* obj, R (T::*method)(Args...)) {
+  return [obj, method](Args... args) { return (obj->*method)(args...); };
+}
+
+/**
+ * @brief Host replacement for the Mbed RTOS `EventFlags`. Same API subset as
+ * the RTOS version.
+ * @note Thread-safe, guarded by a mutex.
+ */
+class EventFlags {
+ public:
+  /**
+   * @brief Sets `flags` and wakes any waiting threads.
+   * @returns The flags after setting.
+   */
+  uint32_t set(uint32_t flags) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_flags |= flags;
+    m_cond.notify_all();
+    return m_flags;
+  }
+
+  /**
+   * @brief Clears `flags`.
+   * @returns The flags before clearing.
+   */
+  uint32_t clear(uint32_t flags = 0x7fffffff) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t prev = m_flags;
+    m_flags &= ~flags;
+    return prev;
+  }
+
+  /**
+   * @returns The currently set flags.
+   */
+  uint32_t get(void) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_flags;
+  }
+
+  /**
+   * @brief Waits until any of `flags` is set, or `rel_time` passes.
+   * @param clear Whether to clear the flags that were waited for.
+   * @returns The flags that were set when the wait ended.
+   */
+  uint32_t wait_any_for(uint32_t flags,
+                        std::chrono::duration<uint32_t, std::milli> rel_time,
+                        bool clear = true) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait_for(lock, rel_time, [&] { return (m_flags & flags) != 0; });
+    uint32_t result = m_flags;
+    if (clear) {
+      m_flags &= ~flags;
+    }
+    return result;
+  }
+
+ private:
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cond;
+  uint32_t m_flags = 0;
+};
@@ -0,0 +1,295 @@
+#include "LightField.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#ifdef LIGHT_FIELD_USE_AVX2
+#include <immintrin.h>
+#endif
+
+static_assert(LIGHT_FIELD_FACINGS == 16 && LIGHT_FIELD_TILE_SIZE == 8,
+              "the AVX2 sampler indexes nodes with shifts and masks");
+
+// Nodes per tile, and floats per cache line
+const int TILE_NODES = LIGHT_FIELD_TILE_SIZE * LIGHT_FIELD_TILE_SIZE;
+const size_t CACHE_LINE_FLOATS = 64 / sizeof(float);
+
+// Scales a facing in radians to a facing in directions
+const float FACING_SCALE =
+    LIGHT_FIELD_FACINGS / (2.0f * static_cast<float>(M_PI));
+
+static float cross(float ax, float ay, float bx, float by) {
+  return ax * by - ay * bx;
+}
+
+bool sim_light_occluded(const SimLight& light,
+                        const std::vector<SimOccluder>& occluders, float x,
+                        float y) {
+  // The segments cross if each one's ends are on opposite sides of the
+  // other. Merely touching an occluder doesn't block the light.
+  float ray_x = light.x - x;
+  float ray_y = light.y - y;
+  for (const SimOccluder& occluder : occluders) {
+    float wall_x = occluder.x1 - occluder.x0;
+    float wall_y = occluder.y1 - occluder.y0;
+    float side_from = cross(wall_x, wall_y, x - occluder.x0, y - occluder.y0);
+    float side_to =
+        cross(wall_x, wall_y, light.x - occluder.x0, light.y - occluder.y0);
+    float side_0 = cross(ray_x, ray_y, occluder.x0 - x, occluder.y0 - y);
+    float side_1 = cross(ray_x, ray_y, occluder.x1 - x, occluder.y1 - y);
+    if (side_from * side_to < 0.0f && side_0 * side_1 < 0.0f) {
+      return true;
+    }
+  }
+  return false;
+}
+
+LightField::LightField(float x0, float y0, float width, float height,
+                       float cell_size, float ambient, float min_level)
+    : m_x0(x0),
+      m_y0(y0),
+      m_cell_size(cell_size),
+      m_inv_cell_size(1.0f / cell_size),
+      m_ambient(ambient),
+      m_min_level(min_level) {
+  // At least two nodes along each axis, so every sample has four around it
+  m_num_x = std::max(static_cast<int>(std::ceil(width / cell_size)) + 1, 2);
+  m_num_y = std::max(static_cast<int>(std::ceil(height / cell_size)) + 1, 2);
+  m_tiles_x = (m_num_x + LIGHT_FIELD_TILE_SIZE - 1) / LIGHT_FIELD_TILE_SIZE;
+  m_tiles_y = (m_num_y + LIGHT_FIELD_TILE_SIZE - 1) / LIGHT_FIELD_TILE_SIZE;
+
+  size_t num_floats = static_cast<size_t>(m_tiles_x) * m_tiles_y * TILE_NODES *
+                      LIGHT_FIELD_FACINGS;
+  m_storage.assign(num_floats + CACHE_LINE_FLOATS, m_ambient);
+  uintptr_t address = reinterpret_cast<uintptr_t>(m_storage.data());
+  m_nodes = m_storage.data() +
+            (CACHE_LINE_FLOATS - address / sizeof(float) % CACHE_LINE_FLOATS) %
+                CACHE_LINE_FLOATS;
+}
+
+size_t LightField::get_size(void) const {
+  return static_cast<size_t>(m_tiles_x) * m_tiles_y * TILE_NODES *
+         LIGHT_FIELD_FACINGS * sizeof(float);
+}
+
+float LightField::get_reach(const SimLight& light) const {
+  // intensity / (1 + dist^2) >= min_level
+  return std::sqrt(std::max(light.intensity / m_min_level - 1.0f, 0.0f));
+}
+
+bool LightField::tile_reached(int tx, int ty, const SimLight& light,
+                              float reach) const {
+  float tile_span = (LIGHT_FIELD_TILE_SIZE - 1) * m_cell_size;
+  float min_x = m_x0 + tx * LIGHT_FIELD_TILE_SIZE * m_cell_size;
+  float min_y = m_y0 + ty * LIGHT_FIELD_TILE_SIZE * m_cell_size;
+  float dx = light.x - std::clamp(light.x, min_x, min_x + tile_span);
+  float dy = light.y - std::clamp(light.y, min_y, min_y + tile_span);
+  return dx * dx + dy * dy <= reach * reach;
+}
+
+void LightField::bake(const std::vector<SimLight>& lights,
+                      const std::vector<SimOccluder>& occluders) {
+  for (int ty = 0; ty < m_tiles_y; ++ty) {
+    for (int tx = 0; tx < m_tiles_x; ++tx) {
+      bake_tile(tx, ty, lights, occluders);
+    }
+  }
+}
+
+size_t LightField::rebake_light(const SimLight& before, const SimLight& after,
+                                const std::vector<SimLight>& lights,
+                                const std::vector<SimOccluder>& occluders) {
+  float reach_before = get_reach(before);
+  float reach_after = get_reach(after);
+  size_t num_rebaked = 0;
+  for (int ty = 0; ty < m_tiles_y; ++ty) {
+    for (int tx = 0; tx < m_tiles_x; ++tx) {
+      if (tile_reached(tx, ty, before, reach_before) ||
+          tile_reached(tx, ty, after, reach_after)) {
+        bake_tile(tx, ty, lights, occluders);
+        ++num_rebaked;
+      }
+    }
+  }
+  return num_rebaked;
+}
+
+void LightField::bake_tile(int tx, int ty, const std::vector<SimLight>& lights,
+                           const std::vector<SimOccluder>& occluders) {
+  float* tile = &m_nodes[node_offset(tx * LIGHT_FIELD_TILE_SIZE,
+                                     ty * LIGHT_FIELD_TILE_SIZE)];
+  std::fill(tile, tile + TILE_NODES * LIGHT_FIELD_FACINGS, m_ambient);
+
+  float cos_facing[LIGHT_FIELD_FACINGS];
+  float sin_facing[LIGHT_FIELD_FACINGS];
+  for (int k = 0; k < LIGHT_FIELD_FACINGS; ++k) {
+    cos_facing[k] = std::cos(k / FACING_SCALE);
+    sin_facing[k] = std::sin(k / FACING_SCALE);
+  }
+
+  for (const SimLight& light : lights) {
+    float reach = get_reach(light);
+    if (!tile_reached(tx, ty, light, reach)) {
+      continue;
+    }
+
+    for (int node = 0; node < TILE_NODES; ++node) {
+      float x = m_x0 + (tx * LIGHT_FIELD_TILE_SIZE +
+                        node % LIGHT_FIELD_TILE_SIZE) * m_cell_size;
+      float y = m_y0 + (ty * LIGHT_FIELD_TILE_SIZE +
+                        node / LIGHT_FIELD_TILE_SIZE) * m_cell_size;
+      float dx = light.x - x;
+      float dy = light.y - y;
+      float dist_sq = dx * dx + dy * dy;
+      if (dist_sq > reach * reach ||
+          sim_light_occluded(light, occluders, x, y)) {
+        continue;
+      }
+
+      // `sim_light_level` for every facing, with everything that doesn't
+      // depend on the facing hoisted out of the loop
+      float* levels = &tile[node * LIGHT_FIELD_FACINGS];
+      float dist = std::sqrt(dist_sq);
+      if (dist == 0.0f) {
+        for (int k = 0; k < LIGHT_FIELD_FACINGS; ++k) {
+          levels[k] += light.intensity;
+        }
+        continue;
+      }
+      float scale = light.intensity / (dist * (1.0f + dist_sq));
+      for (int k = 0; k < LIGHT_FIELD_FACINGS; ++k) {
+        levels[k] +=
+            std::max(dx * cos_facing[k] + dy * sin_facing[k], 0.0f) * scale;
+      }
+    }
+  }
+}
+
+float LightField::sample(float x, float y, float facing) const {
+  float fx = std::clamp((x - m_x0) * m_inv_cell_size, 0.0f,
+                        static_cast<float>(m_num_x - 1));
+  float fy = std::clamp((y - m_y0) * m_inv_cell_size, 0.0f,
+                        static_cast<float>(m_num_y - 1));
+  int ix = std::min(static_cast<int>(fx), m_num_x - 2);
+  int iy = std::min(static_cast<int>(fy), m_num_y - 2);
+  float wx = fx - ix;
+  float wy = fy - iy;
+
+  // Wrap the facing to 0 - LIGHT_FIELD_FACINGS directions
+  float u = facing * FACING_SCALE;
+  u -= LIGHT_FIELD_FACINGS * std::floor(u * (1.0f / LIGHT_FIELD_FACINGS));
+  int k = static_cast<int>(u);
+  float wf = u - k;
+  int k0 = k & (LIGHT_FIELD_FACINGS - 1);
+  int k1 = (k + 1) & (LIGHT_FIELD_FACINGS - 1);
+
+  auto level = [&](int node_x, int node_y) {
+    const float* levels = &m_nodes[node_offset(node_x, node_y)];
+    return levels[k0] + wf * (levels[k1] - levels[k0]);
+  };
+  float l00 = level(ix, iy);
+  float l10 = level(ix + 1, iy);
+  float l01 = level(ix, iy + 1);
+  float l11 = level(ix + 1, iy + 1);
+  float top = l00 + wx * (l10 - l00);
+  float bottom = l01 + wx * (l11 - l01);
+  return std::min(top + wy * (bottom - top), 1.0f);
+}
+
+void LightField::sample_batch(const float* x, const float* y,
+                              const float* facing, size_t count,
+                              float* out) const {
+#ifdef LIGHT_FIELD_USE_AVX2
+  sample_batch_avx2(x, y, facing, count, out);
+#else
+  sample_batch_scalar(x, y, facing, count, out);
+#endif
+}
+
+void LightField::sample_batch_scalar(const float* x, const float* y,
+                                     const float* facing, size_t count,
+                                     float* out) const {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = sample(x[i], y[i], facing[i]);
+  }
+}
+
+#ifdef LIGHT_FIELD_USE_AVX2
+void LightField::sample_batch_avx2(const float* x, const float* y,
+                                   const float* facing, size_t count,
+                                   float* out) const {
+  const __m256 v_zero = _mm256_setzero_ps();
+  const __m256 v_one = _mm256_set1_ps(1.0f);
+  const __m256 v_inv_cell = _mm256_set1_ps(m_inv_cell_size);
+  const __m256 v_x0 = _mm256_set1_ps(m_x0);
+  const __m256 v_y0 = _mm256_set1_ps(m_y0);
+  const __m256 v_max_fx = _mm256_set1_ps(static_cast<float>(m_num_x - 1));
+  const __m256 v_max_fy = _mm256_set1_ps(static_cast<float>(m_num_y - 1));
+  const __m256i v_max_ix = _mm256_set1_epi32(m_num_x - 2);
+  const __m256i v_max_iy = _mm256_set1_epi32(m_num_y - 2);
+  const __m256i v_tiles_x = _mm256_set1_epi32(m_tiles_x);
+  const __m256i v_tile_mask = _mm256_set1_epi32(LIGHT_FIELD_TILE_SIZE - 1);
+  const __m256i v_facing_mask = _mm256_set1_epi32(LIGHT_FIELD_FACINGS - 1);
+  const __m256i v_int_one = _mm256_set1_epi32(1);
+  const __m256 v_facing_scale = _mm256_set1_ps(FACING_SCALE);
+  const __m256 v_facings = _mm256_set1_ps(LIGHT_FIELD_FACINGS);
+  const __m256 v_inv_facings = _mm256_set1_ps(1.0f / LIGHT_FIELD_FACINGS);
+
+  // The offset of the first level of node (ix, iy), as in `node_offset`
+  auto node_offsets = [&](__m256i ix, __m256i iy) {
+    __m256i tile = _mm256_add_epi32(
+        _mm256_mullo_epi32(_mm256_srli_epi32(iy, 3), v_tiles_x),
+        _mm256_srli_epi32(ix, 3));
+    __m256i in_tile =
+        _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(iy, v_tile_mask), 3),
+                        _mm256_and_si256(ix, v_tile_mask));
+    return _mm256_slli_epi32(
+        _mm256_or_si256(_mm256_slli_epi32(tile, 6), in_tile), 4);
+  };
+
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 fx = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&x[i]), v_x0),
+                              v_inv_cell);
+    __m256 fy = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&y[i]), v_y0),
+                              v_inv_cell);
+    fx = _mm256_min_ps(_mm256_max_ps(fx, v_zero), v_max_fx);
+    fy = _mm256_min_ps(_mm256_max_ps(fy, v_zero), v_max_fy);
+    __m256i ix = _mm256_min_epi32(_mm256_cvttps_epi32(fx), v_max_ix);
+    __m256i iy = _mm256_min_epi32(_mm256_cvttps_epi32(fy), v_max_iy);
+    __m256 wx = _mm256_sub_ps(fx, _mm256_cvtepi32_ps(ix));
+    __m256 wy = _mm256_sub_ps(fy, _mm256_cvtepi32_ps(iy));
+
+    __m256 u = _mm256_mul_ps(_mm256_loadu_ps(&facing[i]), v_facing_scale);
+    u = _mm256_sub_ps(
+        u, _mm256_mul_ps(v_facings,
+                         _mm256_floor_ps(_mm256_mul_ps(u, v_inv_facings))));
+    __m256i k = _mm256_cvttps_epi32(u);
+    __m256 wf = _mm256_sub_ps(u, _mm256_cvtepi32_ps(k));
+    __m256i k0 = _mm256_and_si256(k, v_facing_mask);
+    __m256i k1 = _mm256_and_si256(_mm256_add_epi32(k, v_int_one),
+                                  v_facing_mask);
+
+    __m256i ix1 = _mm256_add_epi32(ix, v_int_one);
+    __m256i iy1 = _mm256_add_epi32(iy, v_int_one);
+    auto level = [&](__m256i offset) {
+      __m256 a = _mm256_i32gather_ps(m_nodes, _mm256_add_epi32(offset, k0), 4);
+      __m256 b = _mm256_i32gather_ps(m_nodes, _mm256_add_epi32(offset, k1), 4);
+      return _mm256_add_ps(a, _mm256_mul_ps(wf, _mm256_sub_ps(b, a)));
+    };
+    __m256 l00 = level(node_offsets(ix, iy));
+    __m256 l10 = level(node_offsets(ix1, iy));
+    __m256 l01 = level(node_offsets(ix, iy1));
+    __m256 l11 = level(node_offsets(ix1, iy1));
+    __m256 top = _mm256_add_ps(l00, _mm256_mul_ps(wx, _mm256_sub_ps(l10, l00)));
+    __m256 bottom =
+        _mm256_add_ps(l01, _mm256_mul_ps(wx, _mm256_sub_ps(l11, l01)));
+    __m256 level_xy =
+        _mm256_add_ps(top, _mm256_mul_ps(wy, _mm256_sub_ps(bottom, top)));
+    _mm256_storeu_ps(&out[i], _mm256_min_ps(level_xy, v_one));
+  }
+
+  // And the remainder one at a time
+  sample_batch_scalar(&x[i], &y[i], &facing[i], count - i, &out[i]);
+}
+#endif
@@ -0,0 +1,190 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#if defined(__AVX2__)
+#define LIGHT_FIELD_USE_AVX2
+#endif
+
+// Directions each node of a light field is baked for
+constexpr int LIGHT_FIELD_FACINGS = 16;
+
+// Nodes along each side of a tile of a light field
+constexpr int LIGHT_FIELD_TILE_SIZE = 8;
+
+/**
+ * @brief A point light source in the simulated world.
+ * @param x Position along the x axis in metres.
+ * @param y Position along the y axis in metres.
+ * @param intensity Reading produced by the light on a sensor facing it from
+ * 1 m away.
+ */
+struct SimLight {
+  float x;
+  float y;
+  float intensity;
+};
+
+/**
+ * @brief A wall segment in the simulated world that casts shadows. Vehicles
+ * drive through it, but sensors behind it don't see the lights it blocks.
+ * @param x0, y0 One end of the segment in metres.
+ * @param x1, y1 The other end of the segment in metres.
+ */
+struct SimOccluder {
+  float x0;
+  float y0;
+  float x1;
+  float y1;
+};
+
+/**
+ * @returns The reading `light` produces on an LDR at `(x, y)` facing the unit
+ * vector `(cos_facing, sin_facing)`, ignoring occluders. LDRs are most
+ * sensitive to light straight ahead of them, and see nothing from behind.
+ */
+inline float sim_light_level(const SimLight& light, float x, float y,
+                             float cos_facing, float sin_facing) {
+  float dx = light.x - x;
+  float dy = light.y - y;
+  float dist_sq = dx * dx + dy * dy;
+  float dist = std::sqrt(dist_sq);
+  float cos_angle =
+      dist > 0.0f ? (dx * cos_facing + dy * sin_facing) / dist : 1.0f;
+  return cos_angle > 0.0f ? light.intensity * cos_angle / (1.0f + dist_sq)
+                          : 0.0f;
+}
+
+/**
+ * @returns Whether any of `occluders` blocks the line from `(x, y)` to `light`.
+ */
+bool sim_light_occluded(const SimLight& light,
+                        const std::vector<SimOccluder>& occluders, float x,
+                        float y);
+
+/**
+ * @brief The light levels of a world baked into a grid, so sampling an LDR
+ * costs the same however many lights there are. Every node of the grid holds
+ * the level seen facing each of `LIGHT_FIELD_FACINGS` evenly spaced
+ * directions, and a sample interpolates bilinearly between the four nodes
+ * around it and linearly between the two directions either side of it.
+ *
+ * The 16 levels of a node fill one 64-byte cache line, and nodes are stored
+ * in 8 x 8 tiles of 4 KB, so the four nodes of a sample are nearly always in
+ * the same page and neighbouring vehicles share tiles.
+ *
+ * Each light only reaches as far as it produces at least `min_level`, so
+ * moving a light only re-bakes the tiles it reached before and reaches now.
+ */
+class LightField {
+ public:
+  /**
+   * @param x0 Position of the first node along the x axis in metres.
+   * @param y0 Position of the first node along the y axis in metres.
+   * @param width Width of the area covered in metres.
+   * @param height Height of the area covered in metres.
+   * @param cell_size Distance between nodes in metres.
+   * @param ambient Level seen everywhere, in any direction.
+   * @param min_level The smallest contribution of a light that is baked.
+   */
+  LightField(float x0, float y0, float width, float height, float cell_size,
+             float ambient, float min_level = 1e-3f);
+
+  LightField(const LightField&) = delete;
+  LightField& operator=(const LightField&) = delete;
+
+  /**
+   * @brief Bakes every tile from scratch.
+   */
+  void bake(const std::vector<SimLight>& lights,
+            const std::vector<SimOccluder>& occluders);
+
+  /**
+   * @brief Re-bakes the tiles reached by a light before or after it moved.
+   * @param before The light before it moved.
+   * @param after The light after it moved, already in `lights`.
+   * @returns The number of tiles re-baked.
+   */
+  size_t rebake_light(const SimLight& before, const SimLight& after,
+                      const std::vector<SimLight>& lights,
+                      const std::vector<SimOccluder>& occluders);
+
+  /**
+   * @returns The level seen at `(x, y)` facing `facing` radians, from 0.0 -
+   * 1.0 (inclusive). Points outside the grid are clamped to its edge.
+   */
+  float sample(float x, float y, float facing) const;
+
+  /**
+   * @brief Samples `count` points, 8 at a time with AVX2 gathers on hosts
+   * built with AVX2.
+   * @param x, y, facing The position and facing of each point.
+   * @param out Written with the level seen at each point.
+   */
+  void sample_batch(const float* x, const float* y, const float* facing,
+                    size_t count, float* out) const;
+
+  /**
+   * @returns The size of the baked grid in bytes.
+   */
+  size_t get_size(void) const;
+
+ private:
+  const float m_x0;
+  const float m_y0;
+  const float m_cell_size;
+  const float m_inv_cell_size;
+  const float m_ambient;
+  const float m_min_level;
+
+  // Number of nodes along each axis, and of tiles padded around them
+  int m_num_x;
+  int m_num_y;
+  int m_tiles_x;
+  int m_tiles_y;
+
+  // `LIGHT_FIELD_FACINGS` levels per node, tile by tile, and aligned to a
+  // cache line at `m_nodes`
+  std::vector<float> m_storage;
+  float* m_nodes;
+
+  /**
+   * @returns The offset of the first level of node `(ix, iy)` in `m_nodes`.
+   */
+  size_t node_offset(int ix, int iy) const {
+    int tile = (iy / LIGHT_FIELD_TILE_SIZE) * m_tiles_x +
+               ix / LIGHT_FIELD_TILE_SIZE;
+    int in_tile = (iy % LIGHT_FIELD_TILE_SIZE) * LIGHT_FIELD_TILE_SIZE +
+                  ix % LIGHT_FIELD_TILE_SIZE;
+    return (static_cast<size_t>(tile) * LIGHT_FIELD_TILE_SIZE *
+                LIGHT_FIELD_TILE_SIZE +
+            in_tile) *
+           LIGHT_FIELD_FACINGS;
+  }
+
+  /**
+   * @returns The distance beyond which `light` produces less than
+   * `m_min_level`.
+   */
+  float get_reach(const SimLight& light) const;
+
+  /**
+   * @returns Whether any node of tile `(tx, ty)` is within `reach` of
+   * `light`.
+   */
+  bool tile_reached(int tx, int ty, const SimLight& light, float reach) const;
+
+  /**
+   * @brief Bakes tile `(tx, ty)` from scratch.
+   */
+  void bake_tile(int tx, int ty, const std::vector<SimLight>& lights,
+                 const std::vector<SimOccluder>& occluders);
+
+  void sample_batch_scalar(const float* x, const float* y, const float* facing,
+                           size_t count, float* out) const;
+#ifdef LIGHT_FIELD_USE_AVX2
+  void sample_batch_avx2(const float* x, const float* y, const float* facing,
+                         size_t count, float* out) const;
+#endif
+};
@@ -0,0 +1,237 @@
+#include "RunReplay.h"
+
+#include "../LearnerSnapshot.h"
+
+// Names of the record types, for error messages
+static const char* const RUN_RECORD_NAMES[] = {
+    "format", "seed",      "start", "snapshot", "cycle",    "clock",
+    "sensors", "random", "influence", "rx",     "overflow",
+};
+
+static std::string record_name(RunRecordType type) {
+  if (type < sizeof(RUN_RECORD_NAMES) / sizeof(RUN_RECORD_NAMES[0])) {
+    return RUN_RECORD_NAMES[type];
+  }
+  return "unknown (" + std::to_string(type) + ")";
+}
+
+static vehicle_duration get_time(const RunRecord& record, size_t offset) {
+  return vehicle_duration(run_get_u32(record, offset));
+}
+
+bool RunReplay::load(const uint8_t* data, size_t size) {
+  // Split the interleaved stream back into the FSM and comms records.
+  size_t pos = 0;
+  bool fsm_format = false;
+  bool comms_format = false;
+  while (pos < size) {
+    RunRecord record;
+    size_t frame_size = run_decode(&data[pos], size - pos, record);
+    if (frame_size == 0) {
+      // The rest can't be trusted, but everything before it can still be
+      // replayed.
+      break;
+    }
+    pos += frame_size;
+
+    if (record.type == RUN_FORMAT) {
+#ifdef LEARNER_FIXED_POINT
+      uint8_t fixed_point = 1;
+#else
+      uint8_t fixed_point = 0;
+#endif
+      if (record.size < 3 || record.data[0] != RUN_FORMAT_VERSION ||
+          record.data[1] != NUM_STATES || record.data[2] != fixed_point) {
+        fail("recording is from an incompatible build");
+        return false;
+      }
+      (record.stream == RUN_STREAM_FSM ? fsm_format : comms_format) = true;
+      continue;
+    }
+    if (record.stream == RUN_STREAM_FSM) {
+      m_fsm_records.push_back(record);
+    } else {
+      m_comms_records.push_back(record);
+    }
+  }
+  if (!fsm_format) {
+    fail("no FSM records in the recording");
+    return false;
+  }
+
+  // The FSM stream starts with the seed, then the state the FSM was in.
+  const RunRecord* seed = take(RUN_SEED);
+  const RunRecord* start = seed != nullptr ? take(RUN_START) : nullptr;
+  if (start == nullptr) {
+    return false;
+  }
+  m_seed = run_get_u32(*seed, 0);
+
+  uint8_t snapshot[SNAPSHOT_SIZE];
+  for (int offset = 0; offset < SNAPSHOT_SIZE;) {
+    const RunRecord* chunk = take(RUN_SNAPSHOT);
+    if (chunk == nullptr) {
+      return false;
+    }
+    if (offset + chunk->size > SNAPSHOT_SIZE) {
+      fail("recorded snapshot is too large");
+      return false;
+    }
+    memcpy(&snapshot[offset], chunk->data, chunk->size);
+    offset += chunk->size;
+  }
+
+  uint16_t vehicle_id =
+      static_cast<uint16_t>(start->data[0] | (start->data[1] << 8));
+  m_radio = std::make_unique<HostRadio>(vehicle_id);
+  m_learner = std::make_unique<LearnerStore>(1);
+  m_ctx = std::make_unique<VehicleContext>(m_sensors, m_motors, m_leds,
+                                           m_clock, *m_radio, *m_learner, 0,
+                                           vehicle_id);
+  if (!m_ctx->restore_snapshot(snapshot, SNAPSHOT_SIZE)) {
+    fail("recorded snapshot is invalid");
+    return false;
+  }
+  m_learner->curr_state(0) = static_cast<StateEnum>(start->data[2]);
+  m_learner->prev_state(0) = static_cast<StateEnum>(start->data[3]);
+  m_learner->time_state_entry(0) = get_time(*start, 4);
+  m_learner->light_lvl_entry(0) = {run_get_float(*start, 8),
+                                   run_get_float(*start, 12)};
+  m_learner->light_lvl_curr(0) = {run_get_float(*start, 16),
+                                  run_get_float(*start, 20)};
+  advance_clock(m_learner->time_state_entry(0));
+
+  m_ctx->set_input_source(this);
+  return true;
+}
+
+bool RunReplay::step(void) {
+  if (!m_error.empty() || m_fsm_pos >= m_fsm_records.size()) {
+    return false;
+  }
+
+  const RunRecord& next = m_fsm_records[m_fsm_pos];
+  if (next.type == RUN_OVERFLOW) {
+    fail("the vehicle lost " + std::to_string(run_get_u32(next, 0)) +
+         " records after cycle " + std::to_string(m_num_cycles));
+    return false;
+  }
+  const RunRecord* cycle = take(RUN_CYCLE);
+  if (cycle == nullptr) {
+    return false;
+  }
+
+  vehicle_duration time = get_time(*cycle, 0);
+  deliver_rx(time);
+  advance_clock(time);
+  m_ctx->run_fsm_cycle();
+
+  // Whatever the vehicle transmitted isn't part of the replay.
+  HostRadio::payload payload;
+  uint16_t dest;
+  while (m_radio->take_transmitted(payload, dest)) {
+  }
+
+  if (!m_error.empty()) {
+    return false;
+  }
+  ++m_num_cycles;
+  return true;
+}
+
+void RunReplay::deliver_rx(vehicle_duration time) {
+  while (m_comms_pos < m_comms_records.size()) {
+    const RunRecord& record = m_comms_records[m_comms_pos];
+    if (record.type != RUN_RX) {
+      // Lost payloads only affect the neighbor table, since the influence
+      // the FSM read is in its own records.
+      ++m_comms_pos;
+      continue;
+    }
+    if (get_time(record, 0) > time) {
+      break;
+    }
+
+    advance_clock(get_time(record, 0));
+    m_radio->inject(reinterpret_cast<const char*>(&record.data[4]), MSG_SIZE);
+    while (m_ctx->m_comms_ctx.run_comms_cycle()) {
+    }
+    ++m_comms_pos;
+    ++m_num_rx;
+  }
+}
+
+void RunReplay::advance_clock(vehicle_duration time) {
+  if (time > m_clock.now()) {
+    m_clock.advance(time - m_clock.now());
+  }
+}
+
+const RunRecord* RunReplay::take(RunRecordType type) {
+  if (!m_error.empty()) {
+    return nullptr;
+  }
+  if (m_fsm_pos >= m_fsm_records.size()) {
+    fail("recording ended while the FSM expected a " + record_name(type) +
+         " record");
+    return nullptr;
+  }
+
+  const RunRecord& record = m_fsm_records[m_fsm_pos];
+  if (record.type != type) {
+    fail("FSM expected a " + record_name(type) + " record but the next is " +
+         record_name(record.type) + ", in cycle " +
+         std::to_string(m_num_cycles));
+    return nullptr;
+  }
+  ++m_fsm_pos;
+  return &record;
+}
+
+vehicle_duration RunReplay::take_clock(void) {
+  const RunRecord* record = take(RUN_CLOCK);
+  return record != nullptr ? get_time(*record, 0) : m_clock.now();
+}
+
+LightLevels RunReplay::take_sensors(void) {
+  const RunRecord* record = take(RUN_SENSORS);
+  if (record == nullptr) {
+    return {0.0f, 0.0f};
+  }
+  return {run_get_float(*record, 0), run_get_float(*record, 4)};
+}
+
+uint32_t RunReplay::take_random(void) {
+  const RunRecord* record = take(RUN_RANDOM);
+  return record != nullptr ? run_get_u32(*record, 0) : 0;
+}
+
+bool RunReplay::take_influence(InfluenceSummary& out) {
+  const RunRecord* record = take(RUN_INFLUENCE);
+  if (record == nullptr) {
+    return false;
+  }
+  for (int i = 0; i < NUM_STATES; ++i) {
+    out.delta_sum[i] = run_get_float(*record, 1 + 4 * i);
+    out.weight[i] = run_get_float(*record, 1 + 4 * (NUM_STATES + i));
+  }
+  return record->data[0] != 0;
+}
+
+const std::string& RunReplay::get_error(void) const { return m_error; }
+
+VehicleContext& RunReplay::get_context(void) { return *m_ctx; }
+
+HostClock& RunReplay::get_clock(void) { return m_clock; }
+
+uint32_t RunReplay::get_seed(void) const { return m_seed; }
+
+size_t RunReplay::get_num_cycles(void) const { return m_num_cycles; }
+
+size_t RunReplay::get_num_rx(void) const { return m_num_rx; }
+
+void RunReplay::fail(const std::string& error) {
+  if (m_error.empty()) {
+    m_error = error;
+  }
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../LearnerStore.h"
+#include "../RunRecorder.h"
+#include "../VehicleContext.h"
+#include "HostHal.h"
+
+/**
+ * @brief Replays a run recorded by `RunRecorder` on the host. The FSM gets
+ * every clock read, sensor sample, random draw and influence read from the
+ * recording, so its probability table evolves exactly as it did on the
+ * vehicle, and received payloads are fed to its comms context at the times
+ * they arrived. Time only moves with the recording, so a replay runs as fast
+ * as the host allows.
+ * @note Replays fail as soon as the FSM asks for a different input than the
+ * one recorded next, e.g. because the learner code changed in a way that
+ * changes its control flow.
+ */
+class RunReplay : public RunInputSource {
+ public:
+  /**
+   * @brief Decodes a recording and sets up a vehicle in its starting state.
+   * @param data The recorded stream, as drained from the recorders.
+   * @param size The size of `data` in bytes.
+   * @returns `true` if the replay is ready to step, otherwise `false` and
+   * `get_error` says why.
+   */
+  bool load(const uint8_t* data, size_t size);
+
+  /**
+   * @brief Replays the next recorded FSM cycle, after delivering the payloads
+   * received up to then.
+   * @returns `true` if a cycle was replayed, or `false` at the end of the
+   * recording or if the replay failed (see `get_error`).
+   */
+  bool step(void);
+
+  /**
+   * @returns Why the replay failed, or an empty string if it didn't.
+   */
+  const std::string& get_error(void) const;
+
+  /**
+   * @returns The replayed vehicle. Only valid after a successful `load`.
+   */
+  VehicleContext& get_context(void);
+  HostClock& get_clock(void);
+
+  uint32_t get_seed(void) const;
+  size_t get_num_cycles(void) const;
+  size_t get_num_rx(void) const;
+
+  vehicle_duration take_clock(void) override;
+  LightLevels take_sensors(void) override;
+  uint32_t take_random(void) override;
+  bool take_influence(InfluenceSummary& out) override;
+
+ private:
+  std::vector<RunRecord> m_fsm_records;
+  std::vector<RunRecord> m_comms_records;
+  size_t m_fsm_pos = 0;
+  size_t m_comms_pos = 0;
+  size_t m_num_cycles = 0;
+  size_t m_num_rx = 0;
+  uint32_t m_seed = 0;
+  std::string m_error;
+
+  HostLightSensor m_sensors;
+  HostMotorDriver m_motors;
+  HostLeds m_leds;
+  HostClock m_clock;
+  std::unique_ptr<HostRadio> m_radio;
+  std::unique_ptr<LearnerStore> m_learner;
+  std::unique_ptr<VehicleContext> m_ctx;
+
+  /**
+   * @returns The next FSM record if it is of `type`, otherwise `nullptr`
+   * after failing the replay.
+   */
+  const RunRecord* take(RunRecordType type);
+
+  /**
+   * @brief Feeds the comms context every payload received up to `time`.
+   */
+  void deliver_rx(vehicle_duration time);
+
+  /**
+   * @brief Moves the clock to `time` if it is later.
+   */
+  void advance_clock(vehicle_duration time);
+
+  void fail(const std::string& error);
+};
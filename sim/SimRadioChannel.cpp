@@ -0,0 +1,50 @@
+#include "SimRadioChannel.h"
+
+SimRadioChannel::SimRadioChannel(float radio_range)
+    : m_radio_range(radio_range), m_receivers(radio_range) {}
+
+void SimRadioChannel::deliver(
+    std::vector<std::unique_ptr<SimVehicle>>& vehicles) {
+  // Gather everything sent this tick
+  m_in_flight.clear();
+  HostRadio::payload data;
+  uint16_t dest;
+  for (size_t i = 0; i < vehicles.size(); ++i) {
+    while (vehicles[i]->get_radio().take_transmitted(data, dest)) {
+      m_in_flight.push_back({i, dest, vehicles[i]->get_pose(), data});
+    }
+  }
+  m_num_transmitted += m_in_flight.size();
+  if (m_in_flight.empty()) {
+    return;
+  }
+
+  // Catch the hash up with where the vehicles are now. Most of them are still
+  // in the same cell as last time, so this is mostly comparing cells.
+  for (size_t i = 0; i < vehicles.size(); ++i) {
+    SimPose pose = vehicles[i]->get_pose();
+    m_receivers.update(i, pose.x, pose.y);
+  }
+
+  // Then hand each payload to the vehicles in range of its sender. Going
+  // through the payloads in order means every receiver gets them in the
+  // order they were sent.
+  for (const Transmission& tx : m_in_flight) {
+    m_receivers.for_each_within(
+        tx.pose.x, tx.pose.y, m_radio_range, [&](size_t i) {
+          HostRadio& radio = vehicles[i]->get_radio();
+          if (i != tx.sender && radio.accepts(tx.dest) &&
+              radio.inject(tx.data.data(), MSG_SIZE)) {
+            ++m_num_received;
+          }
+        });
+  }
+}
+
+uint64_t SimRadioChannel::get_num_transmitted(void) const {
+  return m_num_transmitted;
+}
+
+uint64_t SimRadioChannel::get_num_received(void) const {
+  return m_num_received;
+}
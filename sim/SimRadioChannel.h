@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "SimVehicle.h"
+#include "SpatialHash.h"
+
+/**
+ * @brief Shared radio channel between simulated vehicles. Every payload a
+ * vehicle transmits during a tick is received at the start of the next tick by
+ * every other vehicle within radio range whose radio accepts its destination.
+ * Vehicles in range are found with a spatial hash with cells the size of the
+ * radio range, so a payload only costs the vehicles in the nine cells around
+ * its sender, however large the swarm is.
+ */
+class SimRadioChannel {
+ public:
+  /**
+   * @param radio_range Maximum distance in metres a payload can travel.
+   */
+  explicit SimRadioChannel(float radio_range);
+
+  /**
+   * @brief Collects the payloads transmitted by all vehicles and injects them
+   * into the radios of every vehicle in range of the sender, in the order
+   * they were sent. On ticks with payloads, first moves the vehicles that
+   * changed cells in the spatial hash.
+   * @note Must only be called between ticks, while no vehicle is stepping.
+   */
+  void deliver(std::vector<std::unique_ptr<SimVehicle>>& vehicles);
+
+  /**
+   * @returns Total payloads transmitted since the channel was created.
+   */
+  uint64_t get_num_transmitted(void) const;
+
+  /**
+   * @returns Total payloads received since the channel was created, not
+   * counting payloads lost to full receive FIFOs.
+   */
+  uint64_t get_num_received(void) const;
+
+ private:
+  struct Transmission {
+    size_t sender;
+    uint16_t dest;
+    SimPose pose;
+    HostRadio::payload data;
+  };
+
+  const float m_radio_range;
+  std::vector<Transmission> m_in_flight;
+  SpatialHash m_receivers;
+  uint64_t m_num_transmitted = 0;
+  uint64_t m_num_received = 0;
+};
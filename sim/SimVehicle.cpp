@@ -0,0 +1,48 @@
+#include "SimVehicle.h"
+
+#include <cmath>
+
+SimVehicle::SimVehicle(const SimWorld& world, SimPose pose,
+                       LearnerStore& learner, size_t slot,
+                       const VehicleParams& params)
+    : m_world(world),
+      m_pose(pose),
+      m_sensors(world.sense(pose)),
+      m_radio(static_cast<uint16_t>(slot)),
+      m_ctx(m_sensors, m_motors, m_leds, m_clock, m_radio, learner, slot,
+            static_cast<uint16_t>(slot), params) {}
+
+void SimVehicle::step(vehicle_duration dt) {
+  think(dt);
+  move(dt);
+}
+
+void SimVehicle::think(vehicle_duration dt) {
+  think(dt, m_world.sense(m_pose));
+}
+
+void SimVehicle::think(vehicle_duration dt, LightLevels levels) {
+  m_clock.advance(dt);
+  m_sensors.set_levels(levels);
+
+  m_ctx.run_fsm_cycle();
+  m_ctx.m_comms_ctx.run_comms_cycle();
+}
+
+void SimVehicle::move(vehicle_duration dt) {
+  m_world.integrate(m_pose, m_motors.get_command(), dt);
+}
+
+void SimVehicle::drive(float pwm_l, float pwm_r) {
+  m_motors.set_motor_speeds(braitenberg_direction(pwm_l),
+                            braitenberg_direction(pwm_r), std::fabs(pwm_l),
+                            std::fabs(pwm_r));
+}
+
+SimPose SimVehicle::get_pose(void) const { return m_pose; }
+
+VehicleContext& SimVehicle::get_context(void) { return m_ctx; }
+
+HostRadio& SimVehicle::get_radio(void) { return m_radio; }
+
+HostClock& SimVehicle::get_clock(void) { return m_clock; }
@@ -0,0 +1,82 @@
+#pragma once
+#include "../VehicleContext.h"
+#include "HostHal.h"
+#include "SimWorld.h"
+
+// Simulated vehicles use their slot as their radio ID, so only this many can
+// have IDs that don't clash with broadcast or a group.
+const size_t SIM_MAX_VEHICLES = RADIO_GROUP_ID_BASE;
+
+/**
+ * @brief A VehicleContext running on host hardware backends inside a
+ * SimWorld.
+ */
+class SimVehicle {
+ public:
+  /**
+   * @param world The world the vehicle drives around in.
+   * @param pose The starting pose of the vehicle.
+   * @param learner The store holding the learning state of the vehicle.
+   * @param slot The slot in `learner` that belongs to this vehicle. Also used
+   * as the vehicle's ID, so must be below `SIM_MAX_VEHICLES`.
+   * @param params Passed through to VehicleContext.
+   */
+  SimVehicle(const SimWorld& world, SimPose pose, LearnerStore& learner,
+             size_t slot, const VehicleParams& params = VehicleParams());
+
+  SimVehicle(const SimVehicle&) = delete;
+  SimVehicle& operator=(const SimVehicle&) = delete;
+
+  /**
+   * @brief Advances the vehicle by one tick: samples the world, runs an FSM
+   * and a comms cycle, then moves the vehicle according to its motors.
+   * Equivalent to `think` followed by `move`.
+   * @param dt Simulated time per tick.
+   */
+  void step(vehicle_duration dt);
+
+  /**
+   * @brief The first half of `step`: advances the clock, samples the world,
+   * and runs an FSM and a comms cycle.
+   * @param dt Simulated time per tick.
+   */
+  void think(vehicle_duration dt);
+
+  /**
+   * @brief Like `think`, but with LDR readings sensed by the caller, e.g. for
+   * a whole batch of vehicles with `SimWorld::sense_batch`.
+   * @param dt Simulated time per tick.
+   * @param levels The raw LDR readings at the vehicle's pose.
+   */
+  void think(vehicle_duration dt, LightLevels levels);
+
+  /**
+   * @brief The second half of `step`: moves the vehicle according to its
+   * motors.
+   * @param dt Simulated time per tick.
+   */
+  void move(vehicle_duration dt);
+
+  /**
+   * @brief Sets the motors from signed PWM duty cycles computed by a batched
+   * controller pass. Negative values drive the wheel in reverse.
+   */
+  void drive(float pwm_l, float pwm_r);
+
+  SimPose get_pose(void) const;
+  VehicleContext& get_context(void);
+  HostRadio& get_radio(void);
+  HostClock& get_clock(void);
+
+ private:
+  const SimWorld& m_world;
+  SimPose m_pose;
+
+  HostLightSensor m_sensors;
+  HostMotorDriver m_motors;
+  HostLeds m_leds;
+  HostClock m_clock;
+  HostRadio m_radio;
+
+  VehicleContext m_ctx;
+};
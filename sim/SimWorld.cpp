@@ -0,0 +1,174 @@
+#include "SimWorld.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Poses sensed per light field pass, sized to keep the scratch on the stack
+const size_t SENSE_BATCH_SIZE = 64;
+
+SimWorld::SimWorld(float width, float height)
+    : m_width(width), m_height(height) {}
+
+void SimWorld::add_light(SimLight light) {
+  m_lights.push_back(light);
+  if (m_light_field != nullptr) {
+    m_light_field->bake(m_lights, m_occluders);
+  }
+}
+
+void SimWorld::add_occluder(SimOccluder occluder) {
+  m_occluders.push_back(occluder);
+  if (m_light_field != nullptr) {
+    m_light_field->bake(m_lights, m_occluders);
+  }
+}
+
+void SimWorld::move_light(size_t index, float x, float y) {
+  SimLight before = m_lights[index];
+  m_lights[index].x = x;
+  m_lights[index].y = y;
+  if (m_light_field != nullptr) {
+    m_light_field->rebake_light(before, m_lights[index], m_lights,
+                                m_occluders);
+  }
+}
+
+void SimWorld::bake_light_field(float cell_size) {
+  if (cell_size <= 0.0f) {
+    m_light_field.reset();
+    return;
+  }
+
+  // Sensors stick out past the walls, so cover them too
+  float margin = m_sensor_offset + cell_size;
+  m_light_field = std::make_unique<LightField>(
+      -margin, -margin, m_width + 2.0f * margin, m_height + 2.0f * margin,
+      cell_size, m_ambient);
+  m_light_field->bake(m_lights, m_occluders);
+}
+
+float SimWorld::get_width(void) const { return m_width; }
+
+float SimWorld::get_height(void) const { return m_height; }
+
+const LightField* SimWorld::get_light_field(void) const {
+  return m_light_field.get();
+}
+
+float SimWorld::sense_point(float x, float y, float facing) const {
+  float level = m_ambient;
+  float cos_facing = std::cos(facing);
+  float sin_facing = std::sin(facing);
+  for (const SimLight& light : m_lights) {
+    if (!m_occluders.empty() &&
+        sim_light_occluded(light, m_occluders, x, y)) {
+      continue;
+    }
+    level += sim_light_level(light, x, y, cos_facing, sin_facing);
+  }
+  return std::min(level, 1.0f);
+}
+
+LightLevels SimWorld::sense(const SimPose& pose) const {
+  if (m_light_field != nullptr) {
+    LightLevels levels;
+    sense_batch(&pose, 1, &levels);
+    return levels;
+  }
+
+  float left_facing = pose.heading + m_sensor_angle;
+  float right_facing = pose.heading - m_sensor_angle;
+  return {
+      .lvl_left = sense_point(
+          pose.x + m_sensor_offset * std::cos(left_facing),
+          pose.y + m_sensor_offset * std::sin(left_facing), left_facing),
+      .lvl_right = sense_point(
+          pose.x + m_sensor_offset * std::cos(right_facing),
+          pose.y + m_sensor_offset * std::sin(right_facing), right_facing),
+  };
+}
+
+void SimWorld::sense_batch(const SimPose* poses, size_t count,
+                           LightLevels* out) const {
+  if (m_light_field == nullptr) {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = sense(poses[i]);
+    }
+    return;
+  }
+
+  // Left sensors first, then right sensors, so the field samples one flat
+  // batch of points. Both sensors are the heading rotated by the sensor
+  // angle, so only the heading needs a sine and cosine.
+  float cos_angle = std::cos(m_sensor_angle);
+  float sin_angle = std::sin(m_sensor_angle);
+  float x[2 * SENSE_BATCH_SIZE];
+  float y[2 * SENSE_BATCH_SIZE];
+  float facing[2 * SENSE_BATCH_SIZE];
+  float levels[2 * SENSE_BATCH_SIZE];
+  for (size_t begin = 0; begin < count; begin += SENSE_BATCH_SIZE) {
+    size_t n = std::min(SENSE_BATCH_SIZE, count - begin);
+    for (size_t i = 0; i < n; ++i) {
+      const SimPose& pose = poses[begin + i];
+      float cos_heading = std::cos(pose.heading);
+      float sin_heading = std::sin(pose.heading);
+      float left_dx = cos_heading * cos_angle - sin_heading * sin_angle;
+      float left_dy = sin_heading * cos_angle + cos_heading * sin_angle;
+      float right_dx = cos_heading * cos_angle + sin_heading * sin_angle;
+      float right_dy = sin_heading * cos_angle - cos_heading * sin_angle;
+      x[i] = pose.x + m_sensor_offset * left_dx;
+      y[i] = pose.y + m_sensor_offset * left_dy;
+      facing[i] = pose.heading + m_sensor_angle;
+      x[n + i] = pose.x + m_sensor_offset * right_dx;
+      y[n + i] = pose.y + m_sensor_offset * right_dy;
+      facing[n + i] = pose.heading - m_sensor_angle;
+    }
+
+    m_light_field->sample_batch(x, y, facing, 2 * n, levels);
+    for (size_t i = 0; i < n; ++i) {
+      out[begin + i] = {
+          .lvl_left = levels[i],
+          .lvl_right = levels[n + i],
+      };
+    }
+  }
+}
+
+void SimWorld::integrate(SimPose& pose, const MotorCommand& cmd,
+                         vehicle_duration dt) const {
+  auto wheel_speed = [this](Direction dir, float pwm) {
+    switch (dir) {
+      case FORWARD:
+        return pwm * m_max_wheel_speed;
+      case REVERSE:
+        return -pwm * m_max_wheel_speed;
+      case STOP:
+      default:
+        return 0.0f;
+    }
+  };
+  float v_l = wheel_speed(cmd.dir_l, cmd.pwm_l);
+  float v_r = wheel_speed(cmd.dir_r, cmd.pwm_r);
+
+  // Standard differential drive kinematics
+  float seconds = std::chrono::duration<float>(dt).count();
+  float v = (v_l + v_r) / 2.0f;
+  float omega = (v_r - v_l) / m_wheel_base;
+  float heading = pose.heading + omega * seconds;
+  float x = pose.x + v * std::cos(heading) * seconds;
+  float y = pose.y + v * std::sin(heading) * seconds;
+
+  // Bounce off the arena walls so vehicles don't get pinned against them
+  if (x < 0.0f || x > m_width) {
+    heading = static_cast<float>(M_PI) - heading;
+    x = std::clamp(x, 0.0f, m_width);
+  }
+  if (y < 0.0f || y > m_height) {
+    heading = -heading;
+    y = std::clamp(y, 0.0f, m_height);
+  }
+
+  pose.x = x;
+  pose.y = y;
+  pose.heading = std::remainder(heading, 2.0f * static_cast<float>(M_PI));
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "HostHal.h"
+#include "LightField.h"
+
+/**
+ * @brief Position and heading of a simulated vehicle.
+ * @param x Position along the x axis in metres.
+ * @param y Position along the y axis in metres.
+ * @param heading Heading in radians, counter-clockwise from the x axis.
+ */
+struct SimPose {
+  float x;
+  float y;
+  float heading;
+};
+
+/**
+ * @brief Simple 2D world with point lights and occluders in a walled,
+ * rectangular arena. Provides the LDR readings for a vehicle pose and
+ * integrates differential drive motion from motor commands.
+ */
+class SimWorld {
+ public:
+  /**
+   * @param width Width of the arena in metres.
+   * @param height Height of the arena in metres.
+   */
+  SimWorld(float width, float height);
+
+  /**
+   * @brief Adds a point light to the world. Re-bakes the whole light field,
+   * if there is one.
+   */
+  void add_light(SimLight light);
+
+  /**
+   * @brief Adds an occluder to the world. Re-bakes the whole light field, if
+   * there is one.
+   */
+  void add_occluder(SimOccluder occluder);
+
+  /**
+   * @brief Moves the `index`-th light added to `(x, y)`. Only re-bakes the
+   * parts of the light field the light reached before or reaches now.
+   * @note Must only be called between ticks, while no vehicle is stepping.
+   */
+  void move_light(size_t index, float x, float y);
+
+  /**
+   * @brief Bakes the lights and occluders into a `LightField` with nodes
+   * every `cell_size` metres, which `sense` and `sense_batch` sample from
+   * then on instead of evaluating every light. Readings then differ from the
+   * exact ones by the interpolation error, which shrinks with `cell_size`.
+   * @param cell_size Distance between nodes in metres, or 0 to go back to
+   * evaluating every light.
+   */
+  void bake_light_field(float cell_size);
+
+  /**
+   * @returns Raw LDR readings for a vehicle at `pose`, from 0.0 - 1.0
+   * (inclusive).
+   */
+  LightLevels sense(const SimPose& pose) const;
+
+  /**
+   * @brief Equivalent to calling `sense` on each of `count` poses, but
+   * samples the light field for all of them at once.
+   * @param out Written with the readings for each pose.
+   */
+  void sense_batch(const SimPose* poses, size_t count, LightLevels* out) const;
+
+  /**
+   * @brief Moves `pose` according to the motor command over `dt`. Vehicles
+   * bounce off the arena walls.
+   */
+  void integrate(SimPose& pose, const MotorCommand& cmd,
+                 vehicle_duration dt) const;
+
+  float get_width(void) const;
+  float get_height(void) const;
+
+  /**
+   * @returns The baked light field, or `nullptr` if there is none.
+   */
+  const LightField* get_light_field(void) const;
+
+ private:
+  const float m_width;
+  const float m_height;
+  std::vector<SimLight> m_lights;
+  std::vector<SimOccluder> m_occluders;
+  std::unique_ptr<LightField> m_light_field;
+
+  // Vehicle geometry and drive characteristics
+  const float m_wheel_base = 0.15f;      // metres
+  const float m_max_wheel_speed = 0.3f;  // metres per second at 100% PWM
+  const float m_sensor_offset = 0.08f;   // metres ahead of the axle
+  const float m_sensor_angle = 0.5f;     // radians either side of heading
+  const float m_ambient = 0.05f;
+
+  /**
+   * @returns The reading of a single LDR at `(x, y)` facing `facing`.
+   */
+  float sense_point(float x, float y, float facing) const;
+};
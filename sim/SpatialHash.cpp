@@ -0,0 +1,69 @@
+#include "SpatialHash.h"
+
+// Buckets to start with, before any points are added
+const size_t MIN_BUCKETS = 64;
+
+SpatialHash::SpatialHash(float cell_size)
+    : m_inv_cell_size(1.0f / cell_size), m_buckets(MIN_BUCKETS) {}
+
+void SpatialHash::update(size_t index, float x, float y) {
+  if (index >= m_points.size()) {
+    size_t first_new = m_points.size();
+    m_points.resize(index + 1);
+    for (size_t i = first_new; i <= index; ++i) {
+      m_points[i] = {0.0f, 0.0f, get_cell(0.0f), get_cell(0.0f), 0};
+      insert(static_cast<uint32_t>(i));
+    }
+    if (m_points.size() > m_buckets.size()) {
+      grow();
+    }
+  }
+
+  Point& point = m_points[index];
+  point.x = x;
+  point.y = y;
+  int32_t cx = get_cell(x);
+  int32_t cy = get_cell(y);
+  if (cx == point.cx && cy == point.cy) {
+    return;
+  }
+
+  remove(static_cast<uint32_t>(index));
+  point.cx = cx;
+  point.cy = cy;
+  insert(static_cast<uint32_t>(index));
+  ++m_num_moved;
+}
+
+size_t SpatialHash::get_size(void) const { return m_points.size(); }
+
+uint64_t SpatialHash::get_num_moved(void) const { return m_num_moved; }
+
+void SpatialHash::insert(uint32_t index) {
+  Point& point = m_points[index];
+  std::vector<uint32_t>& bucket = m_buckets[get_bucket(point.cx, point.cy)];
+  point.slot = static_cast<uint32_t>(bucket.size());
+  bucket.push_back(index);
+}
+
+void SpatialHash::remove(uint32_t index) {
+  // Move the bucket's last point into the slot instead of shifting the rest
+  const Point& point = m_points[index];
+  std::vector<uint32_t>& bucket = m_buckets[get_bucket(point.cx, point.cy)];
+  uint32_t last = bucket.back();
+  bucket[point.slot] = last;
+  m_points[last].slot = point.slot;
+  bucket.pop_back();
+}
+
+void SpatialHash::grow(void) {
+  size_t num_buckets = m_buckets.size();
+  while (num_buckets < m_points.size()) {
+    num_buckets *= 2;
+  }
+
+  m_buckets.assign(num_buckets, std::vector<uint32_t>());
+  for (size_t i = 0; i < m_points.size(); ++i) {
+    insert(static_cast<uint32_t>(i));
+  }
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Spatial hash of points in the plane, for finding the points within
+ * a radius. The plane is divided into square cells, and each cell hashes to
+ * one of a power of two buckets listing the points in it, so the plane
+ * doesn't need bounds. A point only moves between buckets when it crosses
+ * into another cell, so keeping the hash up to date with slowly moving
+ * vehicles costs little more than working out their cells.
+ */
+class SpatialHash {
+ public:
+  /**
+   * @param cell_size Side of a cell in metres. Queries are fastest when the
+   * radius is at most this.
+   */
+  explicit SpatialHash(float cell_size);
+
+  /**
+   * @brief Moves point `index` to `(x, y)`, adding it (and any points below
+   * it, at the origin) if it isn't in the hash yet.
+   */
+  void update(size_t index, float x, float y);
+
+  /**
+   * @brief Calls `fn(index)` for every point within `radius` of `(x, y)`,
+   * in no particular order.
+   */
+  template <typename F>
+  void for_each_within(float x, float y, float radius, F&& fn) const {
+    int32_t min_cx = get_cell(x - radius);
+    int32_t max_cx = get_cell(x + radius);
+    int32_t min_cy = get_cell(y - radius);
+    int32_t max_cy = get_cell(y + radius);
+    float radius_sq = radius * radius;
+    for (int32_t cy = min_cy; cy <= max_cy; ++cy) {
+      for (int32_t cx = min_cx; cx <= max_cx; ++cx) {
+        // Other cells can share the bucket, so skip their points.
+        for (uint32_t index : m_buckets[get_bucket(cx, cy)]) {
+          const Point& point = m_points[index];
+          if (point.cx != cx || point.cy != cy) {
+            continue;
+          }
+          float dx = x - point.x;
+          float dy = y - point.y;
+          if (dx * dx + dy * dy <= radius_sq) {
+            fn(static_cast<size_t>(index));
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * @returns The number of points in the hash.
+   */
+  size_t get_size(void) const;
+
+  /**
+   * @returns Total times a point moved into another cell.
+   */
+  uint64_t get_num_moved(void) const;
+
+ private:
+  struct Point {
+    float x;
+    float y;
+    int32_t cx;
+    int32_t cy;
+    // The point's position in its bucket
+    uint32_t slot;
+  };
+
+  const float m_inv_cell_size;
+  std::vector<Point> m_points;
+  std::vector<std::vector<uint32_t>> m_buckets;
+  uint64_t m_num_moved = 0;
+
+  int32_t get_cell(float coord) const {
+    return static_cast<int32_t>(std::floor(coord * m_inv_cell_size));
+  }
+
+  size_t get_bucket(int32_t cx, int32_t cy) const {
+    uint32_t hash = (static_cast<uint32_t>(cx) * 73856093u) ^
+                    (static_cast<uint32_t>(cy) * 19349663u);
+    return hash & (m_buckets.size() - 1);
+  }
+
+  void insert(uint32_t index);
+  void remove(uint32_t index);
+
+  /**
+   * @brief Doubles the buckets until there are at least as many as points,
+   * and moves every point to its new bucket.
+   */
+  void grow(void);
+};
@@ -0,0 +1,88 @@
+#include "SwarmEngine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+// Vehicles stepped per task. Large enough to amortize scheduling, small
+// enough to leave work to steal.
+const size_t VEHICLES_PER_TASK = 64;
+
+/**
+ * @returns `num_vehicles`, capped so every vehicle has its own radio ID.
+ */
+static size_t cap_num_vehicles(size_t num_vehicles) {
+  return std::min(num_vehicles, SIM_MAX_VEHICLES);
+}
+
+SwarmEngine::SwarmEngine(const SimWorld& world, size_t num_vehicles,
+                         float radio_range, uint32_t seed,
+                         unsigned num_threads)
+    : m_world(world),
+      m_learner(cap_num_vehicles(num_vehicles)),
+      m_pwm_l(cap_num_vehicles(num_vehicles)),
+      m_pwm_r(cap_num_vehicles(num_vehicles)),
+      m_pool(num_threads),
+      m_channel(radio_range) {
+  m_learner.set_deferred_updates(true);
+
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> x_dist(0.0f, world.get_width());
+  std::uniform_real_distribution<float> y_dist(0.0f, world.get_height());
+  std::uniform_real_distribution<float> heading_dist(-M_PI, M_PI);
+
+  num_vehicles = cap_num_vehicles(num_vehicles);
+  m_vehicles.reserve(num_vehicles);
+  for (size_t i = 0; i < num_vehicles; ++i) {
+    SimPose pose = {x_dist(rng), y_dist(rng), heading_dist(rng)};
+    m_vehicles.push_back(
+        std::make_unique<SimVehicle>(world, pose, m_learner, i));
+    m_vehicles.back()->get_context().set_batched_control(true);
+    m_vehicles.back()->get_context().seed_random(seed, i);
+  }
+}
+
+void SwarmEngine::step(vehicle_duration dt) {
+  m_pool.parallel_for(0, m_vehicles.size(), VEHICLES_PER_TASK,
+                      [&](size_t begin, size_t end) {
+                        // Sense the whole batch in one light field pass
+                        SimPose poses[VEHICLES_PER_TASK] = {};
+                        LightLevels levels[VEHICLES_PER_TASK];
+                        for (size_t i = begin; i < end; ++i) {
+                          poses[i - begin] = m_vehicles[i]->get_pose();
+                        }
+                        m_world.sense_batch(poses, end - begin, levels);
+                        for (size_t i = begin; i < end; ++i) {
+                          m_vehicles[i]->think(dt, levels[i - begin]);
+                        }
+
+                        // Then learn from this batch's transitions in one
+                        // pass over its slots.
+                        m_learner.update_probability_tables(begin, end);
+                        m_learner.normalize_probabilities(begin, end);
+
+                        // And drive the whole batch with one controller pass
+                        braitenberg_compute_batch(
+                            &m_learner.get_curr_states()[begin],
+                            &m_learner.get_light_lvls_curr()[begin],
+                            end - begin, &m_pwm_l[begin], &m_pwm_r[begin]);
+                        for (size_t i = begin; i < end; ++i) {
+                          m_vehicles[i]->drive(m_pwm_l[i], m_pwm_r[i]);
+                          m_vehicles[i]->move(dt);
+                        }
+                      });
+
+  m_channel.deliver(m_vehicles);
+}
+
+size_t SwarmEngine::get_num_vehicles(void) const { return m_vehicles.size(); }
+
+LearnerStore& SwarmEngine::get_learner(void) { return m_learner; }
+
+SimVehicle& SwarmEngine::get_vehicle(size_t index) {
+  return *m_vehicles[index];
+}
+
+const SimRadioChannel& SwarmEngine::get_channel(void) const {
+  return m_channel;
+}
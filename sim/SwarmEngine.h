@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "SimRadioChannel.h"
+#include "SimVehicle.h"
+#include "SimWorld.h"
+#include "WorkStealingPool.h"
+
+/**
+ * @brief Runs a swarm of simulated vehicles in a shared world. Each tick,
+ * every vehicle is stepped in parallel across a WorkStealingPool, then the
+ * radio channel delivers the messages sent during the tick.
+ * @note The learning state of all vehicles lives in one LearnerStore with
+ * deferred updates. Each batch of vehicles senses the world in one
+ * `SimWorld::sense_batch` call, and has its probability updates applied
+ * together right after the batch is stepped.
+ */
+class SwarmEngine {
+ public:
+  /**
+   * @param world The world all vehicles drive around in.
+   * @param num_vehicles Number of vehicles to create, placed at random poses.
+   * Capped at `SIM_MAX_VEHICLES`, so every vehicle has its own radio ID.
+   * @param radio_range Maximum distance in metres a message can travel.
+   * @param seed Seed for the starting poses, and for every vehicle's random
+   * stream.
+   * @param num_threads Number of threads to step vehicles on.
+   */
+  SwarmEngine(const SimWorld& world, size_t num_vehicles, float radio_range,
+              uint32_t seed,
+              unsigned num_threads = std::thread::hardware_concurrency());
+
+  /**
+   * @brief Advances every vehicle by one tick, then delivers messages.
+   * @param dt Simulated time per tick.
+   */
+  void step(vehicle_duration dt);
+
+  size_t get_num_vehicles(void) const;
+  LearnerStore& get_learner(void);
+  SimVehicle& get_vehicle(size_t index);
+  const SimRadioChannel& get_channel(void) const;
+
+ private:
+  const SimWorld& m_world;
+  LearnerStore m_learner;
+  std::vector<std::unique_ptr<SimVehicle>> m_vehicles;
+
+  // Motor outputs of the batched controller pass, indexed by vehicle
+  std::vector<float> m_pwm_l;
+  std::vector<float> m_pwm_r;
+  WorkStealingPool m_pool;
+  SimRadioChannel m_channel;
+};
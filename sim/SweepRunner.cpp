@@ -0,0 +1,328 @@
+#include "SweepRunner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include "../Pcg32.h"
+#include "SimRadioChannel.h"
+#include "SimVehicle.h"
+#include "SimWorld.h"
+
+// Same tick rate as the FSM thread on the vehicle.
+const auto FSM_TICK_RATE = 10ms;
+
+// Roughly the range of the nRF24L01P at 1 Mbps indoors.
+const float RADIO_RANGE = 5.0f;
+
+// Stream the starting poses of an episode are drawn from. Vehicles draw
+// from the streams of their slots, which never get this high.
+const uint64_t POSE_STREAM = UINT64_MAX >> 1;
+
+VehicleParams SweepPoint::to_params(void) const {
+  VehicleParams params;
+  params.learning_rate = learning_rate;
+  params.send_chance = send_chance;
+  for (int i = 0; i < NUM_STATES; ++i) {
+    params.min_durations[i] = vehicle_duration(
+        std::lround(VehicleStates::min_durations[i].count() * duration_scale));
+  }
+  return params;
+}
+
+double SweepPointStats::get_mean(void) const {
+  return num_episodes > 0 ? light_sum / num_episodes : 0.0;
+}
+
+double SweepPointStats::get_std_error(void) const {
+  if (num_episodes < 2) {
+    return INFINITY;
+  }
+  double mean = get_mean();
+  double variance = (light_sq_sum - num_episodes * mean * mean) /
+                    (num_episodes - 1);
+  return std::sqrt(std::max(variance, 0.0) / num_episodes);
+}
+
+SweepRunner::SweepRunner(const SweepConfig& config,
+                         std::vector<SweepPoint> points, unsigned num_threads)
+    : m_config(config),
+      m_points(std::move(points)),
+      m_stats(m_points.size()),
+      m_pool(num_threads) {}
+
+const std::vector<SweepPoint>& SweepRunner::get_points(void) const {
+  return m_points;
+}
+
+const std::vector<SweepPointStats>& SweepRunner::get_stats(void) const {
+  return m_stats;
+}
+
+size_t SweepRunner::get_best(void) const {
+  size_t best = 0;
+  for (size_t i = 1; i < m_stats.size(); ++i) {
+    if (m_stats[i].get_mean() < m_stats[best].get_mean()) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+uint32_t SweepRunner::get_episode_seed(size_t episode) const {
+  // One stream per episode, so seeds don't depend on how many points or
+  // rounds there are.
+  return Pcg32(m_config.seed, episode).next();
+}
+
+bool SweepRunner::run(const std::string& output_directory) {
+  m_runs_file = fopen((output_directory + "/runs.csv").c_str(), "w");
+  m_checkpoints_file =
+      fopen((output_directory + "/checkpoints.csv").c_str(), "w");
+  if (m_runs_file == nullptr || m_checkpoints_file == nullptr) {
+    if (m_runs_file != nullptr) {
+      fclose(m_runs_file);
+    }
+    if (m_checkpoints_file != nullptr) {
+      fclose(m_checkpoints_file);
+    }
+    return false;
+  }
+  fprintf(m_runs_file,
+          "point,episode,seed,mean_light,mean_reward,transitions,"
+          "messages_sent,converged_s,final_drift\n");
+  fprintf(m_checkpoints_file, "point,episode,time_s,mean_light,drift\n");
+
+  std::vector<size_t> active(m_points.size());
+  for (size_t i = 0; i < active.size(); ++i) {
+    active[i] = i;
+  }
+
+  for (size_t round = 0; round < m_config.max_rounds && !active.empty();
+       ++round) {
+    // Every episode of the round is an independent task, so the slow points
+    // (short durations, many messages) are balanced by stealing.
+    size_t per_round = m_config.episodes_per_round;
+    size_t first_episode = round * per_round;
+    std::vector<EpisodeResult> results(active.size() * per_round);
+    m_pool.parallel_for(0, results.size(), 1, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        results[i] =
+            run_episode(active[i / per_round], first_episode + i % per_round);
+      }
+    });
+
+    for (size_t i = 0; i < results.size(); ++i) {
+      SweepPointStats& stats = m_stats[active[i / per_round]];
+      ++stats.num_episodes;
+      stats.light_sum += results[i].mean_light;
+      stats.light_sq_sum += results[i].mean_light * results[i].mean_light;
+      if (results[i].converged_seconds >= 0) {
+        ++stats.num_converged;
+        stats.converged_seconds_sum += results[i].converged_seconds;
+      }
+    }
+
+    if (round + 1 >= m_config.min_rounds) {
+      drop_dominated(round);
+    }
+    active.erase(std::remove_if(active.begin(), active.end(),
+                                [&](size_t point) {
+                                  return m_stats[point].dropped_round >= 0;
+                                }),
+                 active.end());
+    printf("Round %zu: %zu of %zu points left\n", round + 1, active.size(),
+           m_points.size());
+    if (active.size() <= 1) {
+      break;
+    }
+  }
+
+  bool ok = (fclose(m_runs_file) == 0);
+  ok = (fclose(m_checkpoints_file) == 0) && ok;
+  m_runs_file = nullptr;
+  m_checkpoints_file = nullptr;
+  return write_points(output_directory + "/points.csv") && ok;
+}
+
+SweepRunner::EpisodeResult SweepRunner::run_episode(size_t point,
+                                                    size_t episode) {
+  // A 4 m x 4 m arena with a single light in the middle, like vehicle_sim.
+  SimWorld world(4.0f, 4.0f);
+  world.add_light({2.0f, 2.0f, 1.0f});
+
+  uint32_t seed = get_episode_seed(episode);
+  Pcg32 pose_rng(seed, POSE_STREAM);
+  VehicleParams params = m_points[point].to_params();
+  size_t num_vehicles = std::min(m_config.num_vehicles, SIM_MAX_VEHICLES);
+  LearnerStore learner(num_vehicles);
+  std::vector<std::unique_ptr<SimVehicle>> vehicles;
+  vehicles.reserve(num_vehicles);
+  for (size_t i = 0; i < num_vehicles; ++i) {
+    SimPose pose = {pose_rng.next_float() * world.get_width(),
+                    pose_rng.next_float() * world.get_height(),
+                    static_cast<float>((pose_rng.next_float() * 2.0f - 1.0f) *
+                                       M_PI)};
+    vehicles.push_back(
+        std::make_unique<SimVehicle>(world, pose, learner, i, params));
+    vehicles.back()->get_context().seed_random(seed, i);
+  }
+
+  SimRadioChannel channel(RADIO_RANGE);
+
+  // The tables at the last checkpoint, to measure how much they drift
+  std::vector<float> last_tables(num_vehicles * NUM_STATES * NUM_STATES);
+  auto measure_drift = [&](void) {
+    double drift = 0.0;
+    size_t k = 0;
+    for (size_t v = 0; v < num_vehicles; ++v) {
+      VehicleContext& ctx = vehicles[v]->get_context();
+      for (int i = 0; i < NUM_STATES; ++i) {
+        for (int j = 0; j < NUM_STATES; ++j, ++k) {
+          float prob = ctx.get_transition_probability(
+              static_cast<StateEnum>(i), static_cast<StateEnum>(j));
+          drift += std::fabs(prob - last_tables[k]);
+          last_tables[k] = prob;
+        }
+      }
+    }
+    return static_cast<float>(drift / last_tables.size());
+  };
+  measure_drift();
+
+  // Transitions are spotted by the entry time of the current state changing,
+  // and rewarded like `VehicleContext::calculate_reward` does.
+  std::vector<vehicle_duration> entry_times(num_vehicles);
+  std::vector<float> entry_lights(num_vehicles);
+  auto avg_light = [](LightLevels lvls) {
+    return (lvls.lvl_left + lvls.lvl_right) / 2.0f;
+  };
+  for (size_t v = 0; v < num_vehicles; ++v) {
+    entry_times[v] = learner.time_state_entry(v);
+    entry_lights[v] = avg_light(learner.light_lvl_entry(v));
+  }
+
+  long num_ticks = m_config.sim_seconds * 1000 / FSM_TICK_RATE.count();
+  long checkpoint_ticks = std::max<long>(
+      m_config.checkpoint_seconds * 1000 / FSM_TICK_RATE.count(), 1);
+  double light_sum = 0.0;
+  double checkpoint_light_sum = 0.0;
+  double reward_sum = 0.0;
+  uint64_t num_transitions = 0;
+  long converged_seconds = -1;
+  float drift = 0.0f;
+  std::vector<char> lines;
+
+  for (long tick = 1; tick <= num_ticks; ++tick) {
+    double tick_light = 0.0;
+    for (size_t v = 0; v < num_vehicles; ++v) {
+      vehicles[v]->step(FSM_TICK_RATE);
+      LightLevels raw = world.sense(vehicles[v]->get_pose());
+      tick_light += avg_light(raw);
+
+      if (learner.time_state_entry(v) != entry_times[v]) {
+        float light = avg_light(learner.light_lvl_entry(v));
+        reward_sum += entry_lights[v] - light;
+        ++num_transitions;
+        entry_times[v] = learner.time_state_entry(v);
+        entry_lights[v] = light;
+      }
+    }
+    channel.deliver(vehicles);
+
+    tick_light /= num_vehicles;
+    checkpoint_light_sum += tick_light;
+    if (tick > num_ticks / 2) {
+      light_sum += tick_light;
+    }
+
+    if (tick % checkpoint_ticks == 0) {
+      long time_seconds = tick * FSM_TICK_RATE.count() / 1000;
+      drift = measure_drift();
+      if (drift >= m_config.converged_drift) {
+        converged_seconds = -1;
+      } else if (converged_seconds < 0) {
+        converged_seconds = time_seconds;
+      }
+
+      char line[96];
+      int size = snprintf(line, sizeof(line), "%zu,%zu,%ld,%.5f,%.6f\n",
+                          point, episode, time_seconds,
+                          checkpoint_light_sum / checkpoint_ticks, drift);
+      lines.insert(lines.end(), line, line + size);
+      checkpoint_light_sum = 0.0;
+    }
+  }
+
+  EpisodeResult result = {
+      .mean_light = light_sum / std::max<long>(num_ticks - num_ticks / 2, 1),
+      .mean_reward = num_transitions > 0 ? reward_sum / num_transitions : 0.0,
+      .num_transitions = num_transitions,
+      .num_sent = channel.get_num_transmitted(),
+      .converged_seconds = converged_seconds,
+      .final_drift = drift,
+  };
+
+  std::lock_guard<std::mutex> lock(m_file_mutex);
+  fprintf(m_runs_file, "%zu,%zu,%u,%.5f,%.5f,%llu,%llu,%ld,%.6f\n", point,
+          episode, seed, result.mean_light, result.mean_reward,
+          (unsigned long long)result.num_transitions,
+          (unsigned long long)result.num_sent, result.converged_seconds,
+          result.final_drift);
+  fwrite(lines.data(), 1, lines.size(), m_checkpoints_file);
+  fflush(m_runs_file);
+  fflush(m_checkpoints_file);
+  return result;
+}
+
+void SweepRunner::drop_dominated(size_t round) {
+  // Lower light levels are better, so a point is dominated once even its
+  // optimistic bound is above the best point's pessimistic bound.
+  size_t best = SIZE_MAX;
+  for (size_t i = 0; i < m_stats.size(); ++i) {
+    if (m_stats[i].dropped_round < 0 &&
+        (best == SIZE_MAX ||
+         m_stats[i].get_mean() < m_stats[best].get_mean())) {
+      best = i;
+    }
+  }
+  if (best == SIZE_MAX) {
+    return;
+  }
+
+  double z = m_config.dominance_z;
+  double best_bound =
+      m_stats[best].get_mean() + z * m_stats[best].get_std_error();
+  for (SweepPointStats& stats : m_stats) {
+    if (stats.dropped_round < 0 &&
+        stats.get_mean() - z * stats.get_std_error() > best_bound) {
+      stats.dropped_round = static_cast<int>(round) + 1;
+    }
+  }
+}
+
+bool SweepRunner::write_points(const std::string& path) const {
+  FILE* file = fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    return false;
+  }
+
+  fprintf(file,
+          "point,learning_rate,send_chance,duration_scale,"
+          "episodes,mean_light,std_error,converged_fraction,"
+          "mean_converged_s,dropped_round\n");
+  for (size_t i = 0; i < m_points.size(); ++i) {
+    const SweepPoint& point = m_points[i];
+    const SweepPointStats& stats = m_stats[i];
+    fprintf(file, "%zu,%.5f,%.5f,%.5f,%zu,%.5f,%.5f,%.3f,%.1f,%d\n", i,
+            point.learning_rate, point.send_chance, point.duration_scale,
+            stats.num_episodes, stats.get_mean(), stats.get_std_error(),
+            static_cast<double>(stats.num_converged) /
+                std::max<size_t>(stats.num_episodes, 1),
+            stats.num_converged > 0
+                ? stats.converged_seconds_sum / stats.num_converged
+                : -1.0,
+            stats.dropped_round);
+  }
+  return fclose(file) == 0;
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../VehicleContext.h"
+#include "WorkStealingPool.h"
+
+/**
+ * @brief One configuration of the vehicle's tunable parameters to evaluate.
+ * @param learning_rate See `VehicleParams`.
+ * @param send_chance See `VehicleParams`.
+ * @param duration_scale Scales the minimum duration of every state.
+ */
+struct SweepPoint {
+  float learning_rate;
+  float send_chance;
+  float duration_scale;
+
+  VehicleParams to_params(void) const;
+};
+
+/**
+ * @brief How each point of a sweep is evaluated. An episode runs a small group
+ * of vehicles in the single light arena from a cold start. Episodes run in
+ * rounds of `episodes_per_round` per point, and the n-th episode of every
+ * point uses the same seed, so points are compared on the same starting poses
+ * and random streams.
+ */
+struct SweepConfig {
+  // Capped at `SIM_MAX_VEHICLES`
+  size_t num_vehicles = 4;
+  long sim_seconds = 600;
+
+  // How often the probability tables are compared to measure convergence
+  long checkpoint_seconds = 30;
+
+  // A run has converged once the mean absolute change of its probabilities
+  // between checkpoints stays below this for the rest of the episode
+  float converged_drift = 0.01f;
+
+  size_t episodes_per_round = 4;
+  size_t min_rounds = 2;
+  size_t max_rounds = 8;
+
+  // After `min_rounds`, a point is dropped once its optimistic bound (mean
+  // light level minus this many standard errors) is above the best point's
+  // pessimistic bound (mean plus this many standard errors)
+  double dominance_z = 2.0;
+
+  uint32_t seed = 1;
+};
+
+/**
+ * @brief The results of the episodes run for one point so far.
+ */
+struct SweepPointStats {
+  size_t num_episodes = 0;
+  double light_sum = 0.0;
+  double light_sq_sum = 0.0;
+  size_t num_converged = 0;
+  double converged_seconds_sum = 0.0;
+
+  // The round the point was dropped after, or -1 if it never was
+  int dropped_round = -1;
+
+  /**
+   * @returns The mean light level over the second half of the episodes,
+   * lower is better.
+   */
+  double get_mean(void) const;
+
+  /**
+   * @returns The standard error of `get_mean`.
+   */
+  double get_std_error(void) const;
+};
+
+/**
+ * @brief Evaluates many points of the vehicle's parameter space across all
+ * cores, and early stops the points that are clearly worse than the best one.
+ * Streams every episode's results to CSV files as they finish:
+ *
+ * - `runs.csv`: one row per episode, with its mean light level over the
+ *   second half, the mean reward of its transitions, when it converged and
+ *   how many messages were sent.
+ * - `checkpoints.csv`: one row per checkpoint of every episode, with the
+ *   light level since the last checkpoint and the drift of the tables.
+ * - `points.csv`: one row per point once the sweep is done.
+ */
+class SweepRunner {
+ public:
+  /**
+   * @param config How each point is evaluated.
+   * @param points The points to evaluate.
+   * @param num_threads Number of threads to run episodes on.
+   */
+  SweepRunner(const SweepConfig& config, std::vector<SweepPoint> points,
+              unsigned num_threads = std::thread::hardware_concurrency());
+
+  /**
+   * @brief Runs rounds of episodes until `max_rounds`, or until only one point
+   * is left.
+   * @param output_directory An existing directory to write the CSV files to.
+   * @returns `false` if the files could not be written.
+   */
+  bool run(const std::string& output_directory);
+
+  const std::vector<SweepPoint>& get_points(void) const;
+  const std::vector<SweepPointStats>& get_stats(void) const;
+
+  /**
+   * @returns The index of the point with the lowest mean light level.
+   */
+  size_t get_best(void) const;
+
+ private:
+  struct EpisodeResult {
+    double mean_light;
+    double mean_reward;
+    uint64_t num_transitions;
+    uint64_t num_sent;
+    // -1 if the episode never converged
+    long converged_seconds;
+    float final_drift;
+  };
+
+  const SweepConfig m_config;
+  const std::vector<SweepPoint> m_points;
+  std::vector<SweepPointStats> m_stats;
+  WorkStealingPool m_pool;
+
+  // Guards the CSV files, which every thread streams to
+  std::mutex m_file_mutex;
+  FILE* m_runs_file = nullptr;
+  FILE* m_checkpoints_file = nullptr;
+
+  /**
+   * @returns The seed of the `episode`-th episode of every point.
+   */
+  uint32_t get_episode_seed(size_t episode) const;
+
+  /**
+   * @brief Runs one episode of `point` and streams its results.
+   */
+  EpisodeResult run_episode(size_t point, size_t episode);
+
+  /**
+   * @brief Drops the active points whose mean is clearly worse than the best
+   * active point's.
+   * @param round The round that just finished.
+   */
+  void drop_dominated(size_t round);
+
+  bool write_points(const std::string& path) const;
+};
@@ -0,0 +1,127 @@
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(unsigned num_threads)
+    : m_num_threads(std::max(num_threads, 1u)) {
+  for (unsigned i = 0; i < m_num_threads; ++i) {
+    m_queues.push_back(std::make_unique<WorkerQueue>());
+  }
+
+  // Queue 0 belongs to the thread calling parallel_for, so only start the
+  // remaining workers.
+  for (unsigned i = 1; i < m_num_threads; ++i) {
+    m_threads.emplace_back(&WorkStealingPool::worker_proc, this, i);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_work_cv.notify_all();
+  for (std::thread& thread : m_threads) {
+    thread.join();
+  }
+}
+
+unsigned WorkStealingPool::get_num_threads(void) const {
+  return m_num_threads;
+}
+
+void WorkStealingPool::parallel_for(
+    size_t begin, size_t end, size_t grain,
+    const std::function<void(size_t, size_t)>& fn) {
+  if (begin >= end) {
+    return;
+  }
+  grain = std::max<size_t>(grain, 1);
+
+  // Publish the batch before any task becomes visible, since a worker still
+  // finishing the previous batch may pick up a new task straight away.
+  size_t num_tasks = (end - begin + grain - 1) / grain;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_fn = &fn;
+    m_tasks_remaining.store(num_tasks);
+  }
+
+  // Deal the chunks out round-robin so every worker starts with local work.
+  for (size_t i = 0; i < num_tasks; ++i) {
+    size_t chunk_begin = begin + i * grain;
+    WorkerQueue& queue = *m_queues[i % m_num_threads];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back({chunk_begin, std::min(chunk_begin + grain, end)});
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_generation;
+  }
+  m_work_cv.notify_all();
+
+  run_tasks(0);
+
+  // Wait for tasks stolen by other workers to finish.
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done_cv.wait(lock, [this] { return m_tasks_remaining.load() == 0; });
+  m_fn = nullptr;
+}
+
+void WorkStealingPool::worker_proc(unsigned index) {
+  uint64_t seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_work_cv.wait(lock, [&] {
+        return m_stopping || m_generation != seen_generation;
+      });
+      if (m_stopping) {
+        return;
+      }
+      seen_generation = m_generation;
+    }
+
+    run_tasks(index);
+  }
+}
+
+void WorkStealingPool::run_tasks(unsigned index) {
+  Task task;
+  while (try_take_task(index, task)) {
+    (*m_fn)(task.begin, task.end);
+
+    // The last task to finish wakes up parallel_for.
+    if (m_tasks_remaining.fetch_sub(1) == 1) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_done_cv.notify_all();
+    }
+  }
+}
+
+bool WorkStealingPool::try_take_task(unsigned index, Task& out) {
+  // Our own queue first, newest task for better cache locality...
+  {
+    WorkerQueue& own = *m_queues[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      out = own.tasks.back();
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  // ...then steal the oldest task from everyone else.
+  for (unsigned i = 1; i < m_num_threads; ++i) {
+    WorkerQueue& victim = *m_queues[(index + i) % m_num_threads];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      out = victim.tasks.front();
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed-size thread pool with per-worker task deques. Workers pop their
+ * own tasks from the back and steal from the front of other workers' deques
+ * when they run out, which keeps all cores busy even when vehicles take
+ * uneven amounts of time to step.
+ */
+class WorkStealingPool {
+ public:
+  /**
+   * @param num_threads Number of threads to run work on, including the thread
+   * that calls `parallel_for`. Defaults to one per hardware thread.
+   */
+  explicit WorkStealingPool(
+      unsigned num_threads = std::thread::hardware_concurrency());
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  /**
+   * @brief Calls `fn(begin, end)` on chunks of at most `grain` items covering
+   * `[begin, end)`, spread across all threads. Blocks until every chunk is
+   * done. The calling thread takes part in the work.
+   * @note Must not be called concurrently or from inside `fn`.
+   */
+  void parallel_for(size_t begin, size_t end, size_t grain,
+                    const std::function<void(size_t, size_t)>& fn);
+
+  /**
+   * @returns The number of threads work is spread across.
+   */
+  unsigned get_num_threads(void) const;
+
+ private:
+  struct Task {
+    size_t begin;
+    size_t end;
+  };
+
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  const unsigned m_num_threads;
+  std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+  std::vector<std::thread> m_threads;
+
+  // The batch currently being run by `parallel_for`
+  const std::function<void(size_t, size_t)>* m_fn = nullptr;
+  std::atomic<size_t> m_tasks_remaining{0};
+  uint64_t m_generation = 0;
+  bool m_stopping = false;
+  std::mutex m_mutex;
+  std::condition_variable m_work_cv;
+  std::condition_variable m_done_cv;
+
+  /**
+   * @brief Main loop of each worker thread.
+   */
+  void worker_proc(unsigned index);
+
+  /**
+   * @brief Runs tasks from worker `index`'s queue, then steals from the others
+   * until no tasks are left anywhere.
+   */
+  void run_tasks(unsigned index);
+
+  /**
+   * @brief Pops a task, from the back of our own queue or the front of
+   * another worker's queue.
+   * @returns `true` if a task was written to `out`.
+   */
+  bool try_take_task(unsigned index, Task& out);
+};
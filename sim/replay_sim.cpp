@@ -0,0 +1,92 @@
+// Replays a run recorded on the vehicle (with record-enabled) or by
+// vehicle_sim, as fast as possible, and prints the probability table it ends
+// with. The table evolves exactly as it did during the recorded run, so two
+// builds of the learner can be compared on the same inputs. Given a trace
+// file, it writes the binary trace stream of the replayed run, which
+// tools/trace_decode turns into CSV files.
+//
+// Usage: replay_sim <recording_file> [trace_file]
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "../TraceRecorder.h"
+#include "RunReplay.h"
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <recording_file> [trace_file]\n", argv[0]);
+    return 1;
+  }
+
+  FILE* in = fopen(argv[1], "rb");
+  if (in == nullptr) {
+    fprintf(stderr, "Could not open %s\n", argv[1]);
+    return 1;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t count;
+  while ((count = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+    data.insert(data.end(), chunk, chunk + count);
+  }
+  fclose(in);
+
+  RunReplay replay;
+  if (!replay.load(data.data(), data.size())) {
+    fprintf(stderr, "Could not load %s: %s\n", argv[1],
+            replay.get_error().c_str());
+    return 1;
+  }
+  printf("Replaying run recorded with seed %u\n", replay.get_seed());
+
+  VehicleContext& ctx = replay.get_context();
+  TraceRecorder fsm_trace(replay.get_clock());
+  TraceRecorder comms_trace(replay.get_clock());
+  FILE* trace_file = argc > 2 ? fopen(argv[2], "wb") : nullptr;
+  if (trace_file != nullptr) {
+    ctx.set_trace(&fsm_trace);
+    ctx.m_comms_ctx.set_trace(&comms_trace);
+  }
+
+  vehicle_duration start = replay.get_clock().now();
+  auto wall_start = std::chrono::steady_clock::now();
+  while (replay.step()) {
+    if (trace_file != nullptr) {
+      uint8_t buffer[16 * TRACE_FRAME_SIZE];
+      for (TraceRecorder* trace : {&fsm_trace, &comms_trace}) {
+        size_t size;
+        while ((size = trace->drain(buffer, sizeof(buffer))) > 0) {
+          fwrite(buffer, 1, size, trace_file);
+        }
+      }
+    }
+  }
+  if (trace_file != nullptr) {
+    fclose(trace_file);
+  }
+  auto wall_delta = std::chrono::steady_clock::now() - wall_start;
+  double wall_seconds = std::chrono::duration<double>(wall_delta).count();
+  double sim_seconds =
+      std::chrono::duration<double>(replay.get_clock().now() - start).count();
+
+  printf("Replayed %zu cycles and %zu payloads (%.0fs) in %.3fs (%.0fx real "
+         "time)\n",
+         replay.get_num_cycles(), replay.get_num_rx(), sim_seconds,
+         wall_seconds, sim_seconds / wall_seconds);
+  if (!replay.get_error().empty()) {
+    printf("Replay stopped: %s\n", replay.get_error().c_str());
+  }
+
+  for (int i = 0; i < NUM_STATES; ++i) {
+    printf("State %d |", i);
+    for (int j = 0; j < NUM_STATES; ++j) {
+      printf(" %.3f",
+             ctx.get_transition_probability(static_cast<StateEnum>(i),
+                                            static_cast<StateEnum>(j)));
+    }
+    printf("\n");
+  }
+
+  return replay.get_error().empty() ? 0 : 1;
+}
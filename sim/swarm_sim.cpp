@@ -0,0 +1,113 @@
+// Runs a swarm of simulated vehicles across all cores and prints how the
+// swarm is spread over the states, plus radio traffic. The lights are baked
+// into a light field with nodes every `light_cell_size` metres, or evaluated
+// directly for every sensor if it is 0.
+//
+// Usage: swarm_sim [num_vehicles] [simulated_seconds] [seed] [num_threads]
+//                  [light_cell_size]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "SwarmEngine.h"
+#include "SimWorld.h"
+
+// Same tick rate as the FSM thread on the vehicle.
+const auto FSM_TICK_RATE = 10ms;
+
+// Roughly the range of the nRF24L01P at 1 Mbps indoors.
+const float RADIO_RANGE = 5.0f;
+
+// Arena area per vehicle, so density stays the same as the swarm grows.
+const float AREA_PER_VEHICLE = 4.0f;
+
+int main(int argc, char** argv) {
+  size_t num_vehicles = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+  long sim_seconds = argc > 2 ? std::strtol(argv[2], nullptr, 10) : 600;
+  uint32_t seed = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1;
+  unsigned num_threads = argc > 4 ? std::strtoul(argv[4], nullptr, 10)
+                                  : std::thread::hardware_concurrency();
+  float light_cell_size = argc > 5 ? std::strtof(argv[5], nullptr) : 0.25f;
+
+  if (num_vehicles > SIM_MAX_VEHICLES) {
+    fprintf(stderr, "At most %zu vehicles can have their own radio IDs\n",
+            SIM_MAX_VEHICLES);
+    return 1;
+  }
+
+  // Square arena with one light per 100 vehicles on a regular grid.
+  float side = std::sqrt(AREA_PER_VEHICLE * num_vehicles);
+  SimWorld world(side, side);
+  int lights_per_side = std::max(1, static_cast<int>(side / 20.0f));
+  for (int i = 0; i < lights_per_side; ++i) {
+    for (int j = 0; j < lights_per_side; ++j) {
+      world.add_light({(i + 0.5f) * side / lights_per_side,
+                       (j + 0.5f) * side / lights_per_side, 1.0f});
+    }
+  }
+
+  if (light_cell_size > 0.0f) {
+    auto bake_start = std::chrono::steady_clock::now();
+    world.bake_light_field(light_cell_size);
+    auto bake_delta = std::chrono::steady_clock::now() - bake_start;
+    printf("Baked %d lights into a %.1f MB light field in %.3fs\n",
+           lights_per_side * lights_per_side,
+           world.get_light_field()->get_size() / 1e6,
+           std::chrono::duration<double>(bake_delta).count());
+  }
+
+  SwarmEngine swarm(world, num_vehicles, RADIO_RANGE, seed, num_threads);
+
+  long num_ticks = sim_seconds * 1000 / FSM_TICK_RATE.count();
+  auto wall_start = std::chrono::steady_clock::now();
+  for (long tick = 0; tick < num_ticks; ++tick) {
+    swarm.step(FSM_TICK_RATE);
+  }
+  auto wall_delta = std::chrono::steady_clock::now() - wall_start;
+  double wall_seconds = std::chrono::duration<double>(wall_delta).count();
+
+  printf("Simulated %zu vehicles for %lds in %.3fs on %u threads\n",
+         num_vehicles, sim_seconds, wall_seconds, num_threads);
+  printf("%.0f vehicle ticks per second\n",
+         num_vehicles * num_ticks / wall_seconds);
+  printf("Messages sent: %llu, received: %llu\n",
+         (unsigned long long)swarm.get_channel().get_num_transmitted(),
+         (unsigned long long)swarm.get_channel().get_num_received());
+
+  uint64_t rx_reports = 0;
+  uint64_t tx_dropped = 0;
+  uint64_t num_neighbors = 0;
+  uint64_t neighbor_received = 0;
+  uint64_t neighbor_lost = 0;
+  for (size_t i = 0; i < num_vehicles; ++i) {
+    const CommsContext& comms = swarm.get_vehicle(i).get_context().m_comms_ctx;
+    rx_reports += comms.get_num_rx_reports();
+    tx_dropped += comms.get_num_tx_dropped();
+
+    const NeighborTable& neighbors = comms.get_neighbors();
+    num_neighbors += neighbors.get_count();
+    for (int j = 0; j < neighbors.get_count(); ++j) {
+      neighbor_received += neighbors.get(j).num_received;
+      neighbor_lost += neighbors.get(j).num_lost;
+    }
+  }
+  printf("Reports aggregated: %llu, outgoing dropped by full mail: %llu\n",
+         (unsigned long long)rx_reports, (unsigned long long)tx_dropped);
+  printf("Neighbors per vehicle: %.2f, payloads lost from neighbors: %.1f%%\n",
+         (double)num_neighbors / num_vehicles,
+         100.0 * neighbor_lost /
+             std::max<uint64_t>(neighbor_received + neighbor_lost, 1));
+
+  size_t state_counts[NUM_STATES] = {0};
+  for (size_t i = 0; i < swarm.get_num_vehicles(); ++i) {
+    ++state_counts[swarm.get_vehicle(i).get_context().get_curr_state()];
+  }
+  for (int i = 0; i < NUM_STATES; ++i) {
+    printf("State %d | %zu vehicles\n", i, state_counts[i]);
+  }
+
+  return 0;
+}
@@ -0,0 +1,130 @@
+// Sweeps the vehicle's learning rate, send chance and state durations across
+// all cores to find the configuration that keeps vehicles darkest. Every
+// point runs seeded episodes of a few vehicles in the single light arena in
+// rounds, and points that are clearly worse than the best one are dropped
+// between rounds. Results are streamed to CSV files in the output directory
+// (see SweepRunner.h), and the best points are printed at the end.
+//
+// The search is either the built-in grid, or N points drawn at random from
+// the same ranges (log-uniform for the learning rate and durations).
+//
+// Usage: sweep_sim <output_directory> [grid|random:N] [episodes_per_round]
+//                  [simulated_seconds] [seed] [num_threads]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include "../Pcg32.h"
+#include "SweepRunner.h"
+
+const float GRID_LEARNING_RATES[] = {0.02f, 0.05f, 0.1f, 0.2f, 0.4f};
+const float GRID_SEND_CHANCES[] = {0.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+const float GRID_DURATION_SCALES[] = {0.5f, 1.0f, 2.0f};
+
+static std::vector<SweepPoint> make_grid(void) {
+  std::vector<SweepPoint> points;
+  for (float learning_rate : GRID_LEARNING_RATES) {
+    for (float send_chance : GRID_SEND_CHANCES) {
+      for (float duration_scale : GRID_DURATION_SCALES) {
+        points.push_back({learning_rate, send_chance, duration_scale});
+      }
+    }
+  }
+  return points;
+}
+
+static float log_uniform(Pcg32& rng, float min, float max) {
+  return min * std::pow(max / min, rng.next_float());
+}
+
+static std::vector<SweepPoint> make_random(size_t count, uint32_t seed) {
+  // A stream of its own, so the points don't overlap the episode seeds
+  Pcg32 rng(seed, 0xC0FFEE);
+  std::vector<SweepPoint> points;
+  for (size_t i = 0; i < count; ++i) {
+    points.push_back({log_uniform(rng, 0.01f, 0.5f), rng.next_float(),
+                      log_uniform(rng, 0.25f, 4.0f)});
+  }
+  return points;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr,
+            "Usage: %s <output_directory> [grid|random:N] "
+            "[episodes_per_round] [simulated_seconds] [seed] [num_threads]\n",
+            argv[0]);
+    return 1;
+  }
+
+  SweepConfig config;
+  std::string search = argc > 2 ? argv[2] : "grid";
+  if (argc > 3) {
+    config.episodes_per_round = std::strtoul(argv[3], nullptr, 10);
+  }
+  if (argc > 4) {
+    config.sim_seconds = std::strtol(argv[4], nullptr, 10);
+  }
+  if (argc > 5) {
+    config.seed = std::strtoul(argv[5], nullptr, 10);
+  }
+  unsigned num_threads = argc > 6 ? std::strtoul(argv[6], nullptr, 10)
+                                  : std::thread::hardware_concurrency();
+
+  std::vector<SweepPoint> points;
+  if (search == "grid") {
+    points = make_grid();
+  } else if (search.compare(0, 7, "random:") == 0) {
+    points = make_random(std::strtoul(search.c_str() + 7, nullptr, 10),
+                         config.seed);
+  }
+  if (points.empty() || config.episodes_per_round == 0) {
+    fprintf(stderr, "Nothing to sweep\n");
+    return 1;
+  }
+
+  printf("Sweeping %zu points, %zu episodes of %lds per round, on %u "
+         "threads\n",
+         points.size(), config.episodes_per_round, config.sim_seconds,
+         num_threads);
+
+  SweepRunner runner(config, points, num_threads);
+  auto wall_start = std::chrono::steady_clock::now();
+  if (!runner.run(argv[1])) {
+    fprintf(stderr, "Could not write results to %s\n", argv[1]);
+    return 1;
+  }
+  auto wall_delta = std::chrono::steady_clock::now() - wall_start;
+  double wall_seconds = std::chrono::duration<double>(wall_delta).count();
+
+  size_t num_episodes = 0;
+  for (const SweepPointStats& stats : runner.get_stats()) {
+    num_episodes += stats.num_episodes;
+  }
+  printf("Ran %zu episodes in %.3fs (%zu without early stopping)\n",
+         num_episodes, wall_seconds,
+         points.size() * config.episodes_per_round * config.max_rounds);
+
+  // Print the best few points, darkest first
+  std::vector<size_t> order(points.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  const std::vector<SweepPointStats>& stats = runner.get_stats();
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return stats[a].get_mean() < stats[b].get_mean();
+  });
+  printf("Point | learning_rate send_chance duration_scale | mean_light\n");
+  for (size_t i = 0; i < std::min<size_t>(order.size(), 5); ++i) {
+    const SweepPoint& point = points[order[i]];
+    printf("%5zu | %13.3f %11.3f %14.3f | %.4f +- %.4f\n", order[i],
+           point.learning_rate, point.send_chance, point.duration_scale,
+           stats[order[i]].get_mean(), stats[order[i]].get_std_error());
+  }
+
+  return 0;
+}
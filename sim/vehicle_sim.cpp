@@ -0,0 +1,137 @@
+// Runs a single simulated vehicle headless on the host, as fast as possible,
+// and prints the learned transition probabilities. Given a state directory,
+// it warm starts from the snapshot there and saves a new one at the end, like
+// the vehicle does across reboots. Given a trace file, it writes the same
+// binary trace stream the vehicle sends over its trace UART, and given a
+// recording file, the same recording of the run's inputs, which replay_sim
+// can replay. Finally prints how long the FSM and comms hot paths took on
+// this machine.
+//
+// Usage: vehicle_sim [simulated_seconds] [seed] [state_directory]
+//                    [trace_file] [recording_file]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "../LearnerSnapshot.h"
+#include "../Profiler.h"
+#include "../RunRecorder.h"
+#include "../TraceRecorder.h"
+#include "SimVehicle.h"
+#include "SimWorld.h"
+
+// Same tick rate as the FSM thread on the vehicle.
+const auto FSM_TICK_RATE = 10ms;
+
+int main(int argc, char** argv) {
+  long sim_seconds = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 3600;
+  unsigned seed = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1;
+
+  // A 4 m x 4 m arena with a single light in the middle.
+  SimWorld world(4.0f, 4.0f);
+  world.add_light({2.0f, 2.0f, 1.0f});
+  LearnerStore learner(1);
+  SimVehicle vehicle(world, {1.0f, 1.0f, 0.0f}, learner, 0);
+  vehicle.get_context().seed_random(seed, 0);
+
+  const char* const snapshot_key = "learner";
+  // Use "-" to skip the state directory and only trace.
+  std::unique_ptr<HostFileStorage> storage =
+      argc > 3 && std::string(argv[3]) != "-"
+          ? std::make_unique<HostFileStorage>(argv[3])
+          : nullptr;
+  uint8_t snapshot[SNAPSHOT_SIZE];
+  if (storage != nullptr) {
+    int size = storage->load(snapshot_key, snapshot, sizeof(snapshot));
+    bool restored = size > 0 && vehicle.get_context().restore_snapshot(
+                                    snapshot, static_cast<size_t>(size));
+    printf("%s\n", restored ? "Warm start from snapshot" : "Cold start");
+  }
+
+  // Like on the vehicle, one recorder for the FSM and one for comms.
+  TraceRecorder fsm_trace(vehicle.get_clock());
+  TraceRecorder comms_trace(vehicle.get_clock());
+  // Use "-" to skip the trace and only record.
+  FILE* trace_file = argc > 4 && std::string(argv[4]) != "-"
+                         ? fopen(argv[4], "wb")
+                         : nullptr;
+  if (trace_file != nullptr) {
+    vehicle.get_context().set_trace(&fsm_trace);
+    vehicle.get_context().m_comms_ctx.set_trace(&comms_trace);
+  }
+
+  // And one run recorder for each, started after the warm start like on the
+  // vehicle.
+  RunRecorder fsm_record(RUN_STREAM_FSM);
+  RunRecorder comms_record(RUN_STREAM_COMMS);
+  FILE* record_file = argc > 5 ? fopen(argv[5], "wb") : nullptr;
+  if (record_file != nullptr) {
+    fsm_record.record_seed(seed);
+    vehicle.get_context().set_recorder(&fsm_record);
+    vehicle.get_context().m_comms_ctx.set_recorder(&comms_record);
+  }
+
+  Profiler profiler;
+  vehicle.get_context().set_profiler(&profiler);
+  vehicle.get_context().m_comms_ctx.set_profiler(&profiler);
+
+  long num_ticks = sim_seconds * 1000 / FSM_TICK_RATE.count();
+  auto wall_start = std::chrono::steady_clock::now();
+  for (long tick = 0; tick < num_ticks; ++tick) {
+    vehicle.step(FSM_TICK_RATE);
+
+    if (trace_file != nullptr) {
+      uint8_t buffer[16 * TRACE_FRAME_SIZE];
+      for (TraceRecorder* trace : {&fsm_trace, &comms_trace}) {
+        size_t size;
+        while ((size = trace->drain(buffer, sizeof(buffer))) > 0) {
+          fwrite(buffer, 1, size, trace_file);
+        }
+      }
+    }
+    if (record_file != nullptr) {
+      uint8_t buffer[16 * RUN_MAX_FRAME_SIZE];
+      for (RunRecorder* record : {&fsm_record, &comms_record}) {
+        size_t size;
+        while ((size = record->drain(buffer, sizeof(buffer))) > 0) {
+          fwrite(buffer, 1, size, record_file);
+        }
+      }
+    }
+  }
+  if (trace_file != nullptr) {
+    fclose(trace_file);
+  }
+  if (record_file != nullptr) {
+    fclose(record_file);
+  }
+  auto wall_delta = std::chrono::steady_clock::now() - wall_start;
+  double wall_seconds = std::chrono::duration<double>(wall_delta).count();
+
+  printf("Simulated %lds in %.3fs (%.0fx real time)\n", sim_seconds,
+         wall_seconds, sim_seconds / wall_seconds);
+
+  if (storage != nullptr) {
+    learner_snapshot_save(learner, 0, snapshot);
+    if (!storage->store(snapshot_key, snapshot, SNAPSHOT_SIZE)) {
+      printf("Failed to save snapshot\n");
+    }
+  }
+
+  VehicleContext& ctx = vehicle.get_context();
+  for (int i = 0; i < NUM_STATES; ++i) {
+    printf("State %d |", i);
+    for (int j = 0; j < NUM_STATES; ++j) {
+      printf(" %.3f",
+             ctx.get_transition_probability(static_cast<StateEnum>(i),
+                                            static_cast<StateEnum>(j)));
+    }
+    printf("\n");
+  }
+
+  profiler.print_report();
+
+  return 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdio>
+
+/*
+ * Minimal checks for the host tests. Each test is its own program: failed
+ * checks are printed with their location, and `main` returns
+ * `test_result()` so a failing test exits with a non-zero status.
+ */
+
+inline int& test_failures(void) {
+  static int failures = 0;
+  return failures;
+}
+
+#define CHECK(cond)                                                  \
+  do {                                                               \
+    if (!(cond)) {                                                   \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+              #cond);                                                \
+      ++test_failures();                                             \
+    }                                                                \
+  } while (0)
+
+/**
+ * @returns 0 if every check passed, otherwise 1, after printing a summary
+ * headed with `name`.
+ */
+inline int test_result(const char* name) {
+  if (test_failures() == 0) {
+    printf("%s: passed\n", name);
+    return 0;
+  }
+  printf("%s: %d checks failed\n", name, test_failures());
+  return 1;
+}
@@ -0,0 +1,138 @@
+// Checks the probability table kernels in LearnerKernels.h on random rows:
+// the AVX2 versions must give bit-identical results to the scalar ones, and
+// normalized rows must sum to `PROB_ONE`, exactly for the Q15 learner.
+#include <cmath>
+#include <cstring>
+
+#include "../LearnerKernels.h"
+#include "../LearnerStore.h"
+#include "../Pcg32.h"
+#include "TestCheck.h"
+
+const int NUM_ROWS = 1000000;
+
+#ifndef LEARNER_FIXED_POINT
+/**
+ * @brief Fills the states of `row` with random values, some below the minimum
+ * probability or negative, and zeroes the padding.
+ */
+static void random_row(Pcg32& rng, float* row) {
+  for (int i = 0; i < LEARNER_ROW_STRIDE; ++i) {
+    row[i] = (i < NUM_STATES) ? rng.next_float() * 1.1f - 0.1f : 0.0f;
+  }
+}
+
+static void check_float_kernels(void) {
+  Pcg32 rng(1, 0);
+  int num_mismatched = 0;
+  float max_error = 0.0f;
+  for (int n = 0; n < NUM_ROWS; ++n) {
+    float scalar[LEARNER_ROW_STRIDE];
+    random_row(rng, scalar);
+    if (n % 1000 == 0) {
+      // Rows that have gone bad must reset to uniform either way
+      scalar[n / 1000 % NUM_STATES] = NAN;
+    }
+    int col = rng.next() % NUM_STATES;
+    float delta = rng.next_float() * 0.2f - 0.1f;
+
+    float vector[LEARNER_ROW_STRIDE];
+    memcpy(vector, scalar, sizeof(scalar));
+
+    learner_update_row_scalar(scalar, col, delta);
+    learner_normalize_row_scalar(scalar);
+#ifdef LEARNER_USE_AVX2
+    float sample = rng.next_float();
+    StateEnum scalar_state = learner_sample_row_scalar(scalar, sample);
+    learner_update_row_avx2(vector, col, delta);
+    learner_normalize_row_avx2(vector);
+    StateEnum vector_state = learner_sample_row_avx2(vector, sample);
+    if (memcmp(scalar, vector, sizeof(scalar)) != 0 ||
+        scalar_state != vector_state) {
+      ++num_mismatched;
+    }
+#endif
+
+    float sum = 0.0f;
+    for (int i = 0; i < NUM_STATES; ++i) {
+      CHECK(scalar[i] > 0.0f);
+      sum += scalar[i];
+    }
+    for (int i = NUM_STATES; i < LEARNER_ROW_STRIDE; ++i) {
+      CHECK(scalar[i] == 0.0f);
+    }
+    max_error = std::max(max_error, std::fabs(sum - 1.0f));
+  }
+
+  CHECK(num_mismatched == 0);
+  CHECK(max_error < 1e-6f);
+#ifndef LEARNER_USE_AVX2
+  printf("Built without AVX2, so only the scalar kernels were checked\n");
+#endif
+}
+#endif
+
+#ifdef LEARNER_FIXED_POINT
+/**
+ * @returns Whether the states of `row` sum to exactly `PROB_ONE`, none is 0
+ * and the padding is. Scaling can leave states below the minimum probability
+ * they were clamped to, as it does in the floating point learner.
+ */
+static bool is_normalized(const prob_t* row) {
+  uint32_t sum = 0;
+  bool valid = true;
+  for (int i = 0; i < LEARNER_ROW_STRIDE; ++i) {
+    if (i < NUM_STATES) {
+      sum += row[i];
+      valid = valid && row[i] > 0;
+    } else {
+      valid = valid && row[i] == 0;
+    }
+  }
+  return valid && sum == PROB_ONE;
+}
+
+static void check_fixed_point_kernels(void) {
+  // Uniform rows leave a remainder when PROB_ONE doesn't divide evenly
+  LearnerStore store(1);
+  for (int state = 0; state < NUM_STATES; ++state) {
+    CHECK(is_normalized(store.get_row(0, static_cast<StateEnum>(state))));
+  }
+
+  // Rows learned from many updates, including ones big enough to saturate
+  Pcg32 rng(1, 0);
+  prob_t learned[LEARNER_ROW_STRIDE];
+  memcpy(learned, store.get_row(0, IDLE), sizeof(learned));
+  int num_unnormalized = 0;
+  for (int n = 0; n < NUM_ROWS; ++n) {
+    int col = rng.next() % NUM_STATES;
+    reward_t delta = static_cast<reward_t>(rng.next() % (2 * PROB_ONE)) -
+                     static_cast<reward_t>(PROB_ONE);
+    learner_update_row_scalar(learned, col, n % 100 == 0 ? delta : delta / 64);
+    learner_normalize_row_scalar(learned);
+    num_unnormalized += is_normalized(learned) ? 0 : 1;
+  }
+  CHECK(num_unnormalized == 0);
+
+  // Rows of arbitrary values, as if restored from a bad snapshot
+  num_unnormalized = 0;
+  for (int n = 0; n < NUM_ROWS; ++n) {
+    prob_t row[LEARNER_ROW_STRIDE] = {0};
+    for (int i = 0; i < NUM_STATES; ++i) {
+      row[i] = static_cast<prob_t>(rng.next() >> (16 + rng.next() % 16));
+    }
+    learner_normalize_row_scalar(row);
+    num_unnormalized += is_normalized(row) ? 0 : 1;
+  }
+  CHECK(num_unnormalized == 0);
+}
+#endif
+
+int main(void) {
+#ifdef LEARNER_FIXED_POINT
+  check_fixed_point_kernels();
+#else
+  check_float_kernels();
+#endif
+  return test_result("learner_kernels_test");
+}
@@ -0,0 +1,154 @@
+// Checks that learner snapshots restore the calibration and probability
+// table they were saved from, through `HostFileStorage` like a warm start,
+// and that corrupt or mismatched snapshots are rejected without touching the
+// store.
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "../LearnerSnapshot.h"
+#include "../Pcg32.h"
+#include "../sim/HostHal.h"
+#include "TestCheck.h"
+
+static bool slots_equal(const LearnerStore& a, size_t slot_a,
+                        const LearnerStore& b, size_t slot_b) {
+  for (int state = 0; state < NUM_STATES; ++state) {
+    if (memcmp(a.get_row(slot_a, static_cast<StateEnum>(state)),
+               b.get_row(slot_b, static_cast<StateEnum>(state)),
+               NUM_STATES * sizeof(prob_t)) != 0) {
+      return false;
+    }
+  }
+  return memcmp(&a.light_lvl_min(slot_a), &b.light_lvl_min(slot_b),
+                sizeof(LightLevels)) == 0 &&
+         memcmp(&a.light_lvl_max(slot_a), &b.light_lvl_max(slot_b),
+                sizeof(LightLevels)) == 0;
+}
+
+/**
+ * @brief Gives slot 0 of `learner` a learned table and a calibration.
+ */
+static void learn(LearnerStore& learner) {
+  Pcg32 rng(1, 0);
+  for (int i = 0; i < 1000; ++i) {
+    learner.prev_state(0) = learner.curr_state(0);
+    learner.curr_state(0) = static_cast<StateEnum>(rng.next() % NUM_STATES);
+    learner.submit_update(
+        0, reward_from_float((rng.next_float() - 0.5f) * 0.1f));
+  }
+  learner.light_lvl_min(0) = {0.125f, 0.25f};
+  learner.light_lvl_max(0) = {0.75f, 0.875f};
+}
+
+/**
+ * @brief Rewrites the CRC of `snapshot` to match its contents.
+ */
+static void fix_crc(uint8_t* snapshot) {
+  uint32_t crc = crc32(snapshot, SNAPSHOT_SIZE - 4);
+  for (int i = 0; i < 4; ++i) {
+    snapshot[SNAPSHOT_SIZE - 4 + i] = static_cast<uint8_t>(crc >> (8 * i));
+  }
+}
+
+static void check_round_trip(const LearnerStore& learned) {
+  uint8_t snapshot[SNAPSHOT_SIZE];
+  learner_snapshot_save(learned, 0, snapshot);
+
+  // Restoring into another slot of a fresh store gives the same slot
+  LearnerStore restored(2);
+  CHECK(learner_snapshot_load(restored, 1, snapshot, SNAPSHOT_SIZE));
+  CHECK(slots_equal(learned, 0, restored, 1));
+
+  // Saving again gives the same bytes
+  uint8_t again[SNAPSHOT_SIZE];
+  learner_snapshot_save(restored, 1, again);
+  CHECK(memcmp(snapshot, again, SNAPSHOT_SIZE) == 0);
+}
+
+static void check_file_storage(const LearnerStore& learned) {
+  char dir_template[] = "/tmp/learner_snapshot_test.XXXXXX";
+  const char* dir = mkdtemp(dir_template);
+  CHECK(dir != nullptr);
+  if (dir == nullptr) {
+    return;
+  }
+
+  HostFileStorage storage(dir);
+  uint8_t buffer[SNAPSHOT_SIZE];
+  CHECK(storage.load("snapshot", buffer, sizeof(buffer)) == -1);
+
+  uint8_t snapshot[SNAPSHOT_SIZE];
+  learner_snapshot_save(learned, 0, snapshot);
+  CHECK(storage.store("snapshot", snapshot, sizeof(snapshot)));
+
+  // Like a reboot: a new store warm starts from what was stored
+  int size = storage.load("snapshot", buffer, sizeof(buffer));
+  CHECK(size == SNAPSHOT_SIZE);
+  LearnerStore restored(1);
+  CHECK(learner_snapshot_load(restored, 0, buffer, size));
+  CHECK(slots_equal(learned, 0, restored, 0));
+
+  std::string path = std::string(dir) + "/snapshot.bin";
+  remove(path.c_str());
+  rmdir(dir);
+}
+
+static void check_rejected(const LearnerStore& learned) {
+  uint8_t snapshot[SNAPSHOT_SIZE];
+  learner_snapshot_save(learned, 0, snapshot);
+  LearnerStore fresh(1);
+  LearnerStore target(1);
+
+  // Every single bit flip is caught, by the CRC or the header checks
+  int num_accepted = 0;
+  for (int byte = 0; byte < SNAPSHOT_SIZE; ++byte) {
+    for (int bit = 0; bit < 8; ++bit) {
+      snapshot[byte] ^= 1 << bit;
+      num_accepted +=
+          learner_snapshot_load(target, 0, snapshot, SNAPSHOT_SIZE) ? 1 : 0;
+      snapshot[byte] ^= 1 << bit;
+    }
+  }
+  CHECK(num_accepted == 0);
+
+  // As are truncated and oversized snapshots
+  CHECK(!learner_snapshot_load(target, 0, snapshot, SNAPSHOT_SIZE - 1));
+  uint8_t oversized[SNAPSHOT_SIZE + 1] = {0};
+  memcpy(oversized, snapshot, SNAPSHOT_SIZE);
+  CHECK(!learner_snapshot_load(target, 0, oversized, sizeof(oversized)));
+
+  // Snapshots from other firmware are rejected even with a valid CRC: the
+  // version, probability format and number of states must all match.
+  for (int offset : {4, 5, 6}) {
+    uint8_t other[SNAPSHOT_SIZE];
+    memcpy(other, snapshot, SNAPSHOT_SIZE);
+    ++other[offset];
+    fix_crc(other);
+    CHECK(!learner_snapshot_load(target, 0, other, SNAPSHOT_SIZE));
+  }
+
+  // And so are tables that don't hold probabilities
+  uint8_t invalid[SNAPSHOT_SIZE];
+  memcpy(invalid, snapshot, SNAPSHOT_SIZE);
+  memset(&invalid[SNAPSHOT_HEADER_SIZE + SNAPSHOT_CALIBRATION_SIZE], 0,
+         sizeof(prob_t));
+  fix_crc(invalid);
+  CHECK(!learner_snapshot_load(target, 0, invalid, SNAPSHOT_SIZE));
+
+  // None of them changed the store
+  CHECK(slots_equal(fresh, 0, target, 0));
+}
+
+int main(void) {
+  LearnerStore learned(1);
+  learn(learned);
+
+  check_round_trip(learned);
+  check_file_storage(learned);
+  check_rejected(learned);
+  return test_result("learner_snapshot_test");
+}
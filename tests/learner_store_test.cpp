@@ -0,0 +1,72 @@
+// Checks that deferred updates, applied by the batched passes after every
+// slot has moved on to its next state, learn the same tables as updates
+// applied immediately on each transition.
+#include <cstring>
+
+#include "../LearnerStore.h"
+#include "../Pcg32.h"
+#include "TestCheck.h"
+
+const size_t NUM_SLOTS = 4;
+const int NUM_TRANSITIONS = 2000;
+
+static StateEnum random_state(Pcg32& rng) {
+  return static_cast<StateEnum>(rng.next() % NUM_STATES);
+}
+
+static bool tables_equal(const LearnerStore& a, const LearnerStore& b,
+                         size_t slot) {
+  for (int state = 0; state < NUM_STATES; ++state) {
+    if (memcmp(a.get_row(slot, static_cast<StateEnum>(state)),
+               b.get_row(slot, static_cast<StateEnum>(state)),
+               LEARNER_ROW_STRIDE * sizeof(prob_t)) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(void) {
+  LearnerStore immediate(NUM_SLOTS);
+  LearnerStore deferred(NUM_SLOTS);
+  deferred.set_deferred_updates(true);
+
+  Pcg32 rng(1, 0);
+  for (int i = 0; i < NUM_TRANSITIONS; ++i) {
+    for (size_t slot = 0; slot < NUM_SLOTS; ++slot) {
+      // Like `VehicleContext::transition_to`: reward the transition from the
+      // previous state into the current one, then move on to the next state.
+      StateEnum next = random_state(rng);
+      reward_t delta = reward_from_float((rng.next_float() - 0.5f) * 0.1f);
+      for (LearnerStore* store : {&immediate, &deferred}) {
+        store->submit_update(slot, delta);
+        store->prev_state(slot) = store->curr_state(slot);
+        store->curr_state(slot) = next;
+      }
+    }
+    deferred.update_probability_tables(0, NUM_SLOTS);
+    deferred.normalize_probabilities(0, NUM_SLOTS);
+  }
+
+  for (size_t slot = 0; slot < NUM_SLOTS; ++slot) {
+    CHECK(tables_equal(immediate, deferred, slot));
+  }
+
+  // The same transition must update the same row either way.
+  LearnerStore single(1);
+  LearnerStore batched(1);
+  batched.set_deferred_updates(true);
+  for (LearnerStore* store : {&single, &batched}) {
+    store->prev_state(0) = IDLE;
+    store->curr_state(0) = COWARD;
+    store->submit_update(0, reward_from_float(0.1f));
+    store->prev_state(0) = COWARD;
+    store->curr_state(0) = LOVE;
+  }
+  batched.update_probability_tables(0, 1);
+  batched.normalize_probabilities(0, 1);
+  CHECK(single.get_row(0, IDLE)[COWARD] > PROB_ONE / NUM_STATES);
+  CHECK(tables_equal(single, batched, 0));
+
+  return test_result("learner_store_test");
+}
@@ -0,0 +1,112 @@
+// Checks that replaying a recorded run on the host ends with exactly the
+// probability table the recorded vehicle learned. The recorded vehicle warm
+// starts from a snapshot and shares a radio channel with two others, so the
+// replay covers the restored start, received payloads and the influence they
+// have on sampling.
+#include <memory>
+#include <vector>
+
+#include "../LearnerSnapshot.h"
+#include "../RunRecorder.h"
+#include "../sim/RunReplay.h"
+#include "../sim/SimRadioChannel.h"
+#include "../sim/SimVehicle.h"
+#include "../sim/SimWorld.h"
+#include "TestCheck.h"
+
+const auto TICK = 10ms;
+const long NUM_TICKS = 60000;  // 10 simulated minutes
+const uint32_t SEED = 7;
+
+static void drain(RunRecorder& recorder, std::vector<uint8_t>& out) {
+  uint8_t buffer[16 * RUN_MAX_FRAME_SIZE];
+  size_t size;
+  while ((size = recorder.drain(buffer, sizeof(buffer))) > 0) {
+    out.insert(out.end(), buffer, buffer + size);
+  }
+}
+
+/**
+ * @brief Runs a small swarm, recording vehicle 0.
+ * @param recording Written with the recording.
+ * @param learned Written with the probabilities vehicle 0 ends with.
+ */
+static void record_run(std::vector<uint8_t>& recording,
+                       std::vector<float>& learned) {
+  SimWorld world(4.0f, 4.0f);
+  world.add_light({2.0f, 2.0f, 1.0f});
+  LearnerStore learner(3);
+  std::vector<std::unique_ptr<SimVehicle>> vehicles;
+  const SimPose poses[] = {
+      {1.0f, 1.0f, 0.0f}, {3.0f, 1.0f, 1.5f}, {2.0f, 3.0f, 3.0f}};
+  for (size_t i = 0; i < 3; ++i) {
+    vehicles.push_back(
+        std::make_unique<SimVehicle>(world, poses[i], learner, i));
+    vehicles[i]->get_context().seed_random(SEED, i);
+  }
+  SimRadioChannel channel(10.0f);
+
+  // Warm start vehicle 0 from what vehicle 1 learned in a first run
+  for (long tick = 0; tick < NUM_TICKS / 4; ++tick) {
+    vehicles[1]->step(TICK);
+  }
+  uint8_t snapshot[SNAPSHOT_SIZE];
+  learner_snapshot_save(learner, 1, snapshot);
+  CHECK(vehicles[0]->get_context().restore_snapshot(snapshot, SNAPSHOT_SIZE));
+
+  RunRecorder fsm_record(RUN_STREAM_FSM);
+  RunRecorder comms_record(RUN_STREAM_COMMS);
+  fsm_record.record_seed(SEED);
+  VehicleContext& ctx = vehicles[0]->get_context();
+  ctx.set_recorder(&fsm_record);
+  ctx.m_comms_ctx.set_recorder(&comms_record);
+
+  for (long tick = 0; tick < NUM_TICKS; ++tick) {
+    for (std::unique_ptr<SimVehicle>& vehicle : vehicles) {
+      vehicle->step(TICK);
+    }
+    channel.deliver(vehicles);
+    drain(fsm_record, recording);
+    drain(comms_record, recording);
+  }
+
+  for (int i = 0; i < NUM_STATES; ++i) {
+    for (int j = 0; j < NUM_STATES; ++j) {
+      learned.push_back(ctx.get_transition_probability(
+          static_cast<StateEnum>(i), static_cast<StateEnum>(j)));
+    }
+  }
+}
+
+int main(void) {
+  std::vector<uint8_t> recording;
+  std::vector<float> learned;
+  record_run(recording, learned);
+
+  RunReplay replay;
+  CHECK(replay.load(recording.data(), recording.size()));
+  CHECK(replay.get_seed() == SEED);
+  while (replay.step()) {
+  }
+  CHECK(replay.get_error().empty());
+  CHECK(replay.get_num_cycles() == static_cast<size_t>(NUM_TICKS));
+  CHECK(replay.get_num_rx() > 0);
+
+  std::vector<float> replayed;
+  for (int i = 0; i < NUM_STATES; ++i) {
+    for (int j = 0; j < NUM_STATES; ++j) {
+      replayed.push_back(replay.get_context().get_transition_probability(
+          static_cast<StateEnum>(i), static_cast<StateEnum>(j)));
+    }
+  }
+  CHECK(replayed == learned);
+
+  // The table moved away from where it started, so the check means something
+  LearnerStore fresh(1);
+  CHECK(learned[0] != prob_to_float(fresh.get_row(0, IDLE)[0]));
+
+  if (!replay.get_error().empty()) {
+    printf("Replay stopped: %s\n", replay.get_error().c_str());
+  }
+  return test_result("run_replay_test");
+}
@@ -0,0 +1,149 @@
+// Checks that payloads packed by `WireEncoder` decode with `WireView` to the
+// same reports, within the 8-bit quantization of the light levels, and that
+// malformed or newer payloads are handled as WireCodec.h describes.
+#include <cmath>
+#include <cstring>
+
+#include "../Pcg32.h"
+#include "../StateRegistry.h"
+#include "../WireCodec.h"
+#include "TestCheck.h"
+
+// Quantizing to 8 bits rounds to the nearest of 255 steps
+const float MAX_LVL_ERROR = 0.5f / 255.0f + 1e-6f;
+
+static bool lvls_match(LightLevels a, LightLevels b) {
+  return std::fabs(a.lvl_left - b.lvl_left) <= MAX_LVL_ERROR &&
+         std::fabs(a.lvl_right - b.lvl_right) <= MAX_LVL_ERROR;
+}
+
+static void check_round_trip(void) {
+  Pcg32 rng(1, 0);
+  for (int n = 0; n < 10000; ++n) {
+    CommsMsg msgs[WIRE_MAX_RECORDS];
+    uint16_t sender_id = static_cast<uint16_t>(rng.next());
+    uint16_t seq = static_cast<uint16_t>(rng.next());
+    int count = 1 + rng.next() % WIRE_MAX_RECORDS;
+
+    char buffer[MSG_SIZE];
+    WireEncoder encoder(buffer, sender_id, seq);
+    for (int i = 0; i < count; ++i) {
+      msgs[i] = {
+          .prev_lvls = {rng.next_float(), rng.next_float()},
+          .curr_lvls = {rng.next_float(), rng.next_float()},
+          .prev_state = static_cast<StateEnum>(rng.next() % NUM_STATES),
+          .sender_id = 0,
+      };
+      CHECK(encoder.add(msgs[i]));
+    }
+    CHECK(encoder.get_count() == count);
+
+    WireView view(buffer);
+    CHECK(view.is_valid());
+    CHECK(view.get_sender_id() == sender_id);
+    CHECK(view.get_seq() == seq);
+    CHECK(view.get_count() == count);
+    for (int i = 0; i < view.get_count() && i < count; ++i) {
+      CommsMsg msg = view.get_record(i);
+      CHECK(lvls_match(msg.prev_lvls, msgs[i].prev_lvls));
+      CHECK(lvls_match(msg.curr_lvls, msgs[i].curr_lvls));
+      CHECK(msg.prev_state == msgs[i].prev_state);
+      CHECK(msg.sender_id == sender_id);
+    }
+
+    // The padding after the records is zeroed
+    for (int i = WIRE_HEADER_SIZE + count * WIRE_RECORD_SIZE; i < MSG_SIZE;
+         ++i) {
+      CHECK(buffer[i] == 0);
+    }
+  }
+}
+
+static void check_full_payload(void) {
+  char buffer[MSG_SIZE];
+  WireEncoder encoder(buffer, 1, 0);
+  CommsMsg msg = {
+      .prev_lvls = {0.0f, 1.0f},
+      .curr_lvls = {-0.5f, 2.0f},
+      .prev_state = LOVE,
+      .sender_id = 0,
+  };
+  for (int i = 0; i < WIRE_MAX_RECORDS; ++i) {
+    CHECK(!encoder.is_full());
+    CHECK(encoder.add(msg));
+  }
+  CHECK(encoder.is_full());
+  CHECK(!encoder.add(msg));
+  CHECK(encoder.get_count() == WIRE_MAX_RECORDS);
+
+  // Levels outside 0.0 - 1.0 are clamped
+  WireView view(buffer);
+  CHECK(view.is_valid());
+  CommsMsg decoded = view.get_record(WIRE_MAX_RECORDS - 1);
+  CHECK(decoded.prev_lvls.lvl_left == 0.0f);
+  CHECK(decoded.prev_lvls.lvl_right == 1.0f);
+  CHECK(decoded.curr_lvls.lvl_left == 0.0f);
+  CHECK(decoded.curr_lvls.lvl_right == 1.0f);
+}
+
+static void check_invalid_payloads(void) {
+  char buffer[MSG_SIZE];
+  WireEncoder encoder(buffer, 1, 0);
+  encoder.add({{0.5f, 0.5f}, {0.5f, 0.5f}, COWARD, 0});
+
+  char bad[MSG_SIZE];
+  memcpy(bad, buffer, MSG_SIZE);
+  bad[0] = 0;  // Unknown version
+  CHECK(!WireView(bad).is_valid());
+
+  memcpy(bad, buffer, MSG_SIZE);
+  bad[2] = WIRE_RECORD_SIZE - 1;  // Records can't shrink
+  CHECK(!WireView(bad).is_valid());
+
+  memcpy(bad, buffer, MSG_SIZE);
+  bad[1] = WIRE_MAX_RECORDS + 1;  // More records than fit
+  CHECK(!WireView(bad).is_valid());
+
+  // An all-zero payload, e.g. noise, is rejected
+  memset(bad, 0, MSG_SIZE);
+  CHECK(!WireView(bad).is_valid());
+}
+
+static void check_newer_records(void) {
+  // A newer sender appends a field to each record. Older decoders skip it.
+  const int record_size = WIRE_RECORD_SIZE + 2;
+  char buffer[MSG_SIZE] = {0};
+  buffer[0] = WIRE_VERSION + 1;
+  buffer[1] = 2;
+  buffer[2] = record_size;
+  buffer[3] = 0x34;
+  buffer[4] = 0x12;
+  for (int i = 0; i < 2; ++i) {
+    uint8_t* record =
+        reinterpret_cast<uint8_t*>(&buffer[WIRE_HEADER_SIZE + i * record_size]);
+    record[0] = 0;
+    record[1] = 51;
+    record[2] = 102;
+    record[3] = 255;
+    record[4] = static_cast<uint8_t>(i == 0 ? AGGRESSIVE : EXPLORER);
+    record[5] = 0xAA;
+    record[6] = 0xBB;
+  }
+
+  WireView view(buffer);
+  CHECK(view.is_valid());
+  CHECK(view.get_sender_id() == 0x1234);
+  CHECK(view.get_count() == 2);
+  CHECK(view.get_record(0).prev_state == AGGRESSIVE);
+  CHECK(view.get_record(1).prev_state == EXPLORER);
+  CHECK(std::fabs(view.get_record(1).prev_lvls.lvl_right - 0.2f) < 1e-6f);
+  CHECK(view.get_record(1).curr_lvls.lvl_right == 1.0f);
+}
+
+int main(void) {
+  check_round_trip();
+  check_full_payload();
+  check_invalid_payloads();
+  check_newer_records();
+  return test_result("wire_codec_test");
+}
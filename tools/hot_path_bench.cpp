@@ -0,0 +1,529 @@
+// Micro-benchmarks for the learning and comms hot paths, run on the host
+// backends, and for sensing the simulated world. Each benchmark is repeated
+// with twice the iterations until it runs for at least the minimum time, then
+// reports the time and the number of heap allocations per operation. The
+// batched learner passes and light field sampling are swept over batch sizes
+// (vehicles per pass). NUM_STATES is fixed by the state registry, so it is
+// reported with the results rather than swept.
+//
+// Usage: hot_path_bench [json_file] [min_time_ms]
+//
+// Prints a table, and given a JSON file, writes the results there so runs of
+// different builds can be diffed.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../CommsContext.h"
+#include "../LearnerStore.h"
+#include "../Pcg32.h"
+#include "../VehicleContext.h"
+#include "../WireCodec.h"
+#include "../sim/HostHal.h"
+#include "../sim/SimWorld.h"
+
+// Heap allocations so far, counted by the replaced global operator new. The
+// benchmarks run on one thread.
+static uint64_t num_allocs = 0;
+
+void* operator new(size_t size) {
+  ++num_allocs;
+  void* ptr = malloc(size > 0 ? size : 1);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+// Batch sizes the batched learner passes are swept over
+const size_t BATCH_SIZES[] = {1, 16, 256, 4096};
+
+// Operations between untimed housekeeping, e.g. draining outgoing mail
+// before it fills up
+const int CHUNK = 8;
+
+// Keeps results alive so the compiler can't drop the work that made them
+static volatile uint32_t sink;
+
+struct BenchResult {
+  std::string name;
+  size_t batch;
+  uint64_t iterations;
+  double ns_per_op;
+  double allocs_per_op;
+};
+
+/**
+ * @brief Measures the time and allocations of only the code between `start`
+ * and `stop`, so benchmarks can do housekeeping in between.
+ */
+class Stopwatch {
+ public:
+  void start(void) {
+    m_allocs_start = num_allocs;
+    m_start = std::chrono::steady_clock::now();
+  }
+  void stop(void) {
+    m_elapsed += std::chrono::steady_clock::now() - m_start;
+    m_allocs += num_allocs - m_allocs_start;
+  }
+  double get_ns(void) const {
+    return std::chrono::duration<double, std::nano>(m_elapsed).count();
+  }
+  uint64_t get_allocs(void) const { return m_allocs; }
+
+ private:
+  std::chrono::steady_clock::time_point m_start;
+  std::chrono::steady_clock::duration m_elapsed{0};
+  uint64_t m_allocs_start = 0;
+  uint64_t m_allocs = 0;
+};
+
+static std::vector<BenchResult> results;
+static double min_time_ns = 200e6;
+
+/**
+ * @brief Runs `body(iterations, stopwatch)` with doubling iterations until the
+ * stopwatch shows at least the minimum time, then records the result.
+ * @param ops_per_iteration How many operations each iteration does, e.g. the
+ * batch size.
+ */
+template <typename F>
+static void run_bench(const std::string& name, size_t batch,
+                      size_t ops_per_iteration, F&& body) {
+  for (uint64_t iterations = 1;; iterations *= 2) {
+    Stopwatch stopwatch;
+    body(iterations, stopwatch);
+
+    if (stopwatch.get_ns() >= min_time_ns || iterations >= (1ull << 40)) {
+      double ops = static_cast<double>(iterations) * ops_per_iteration;
+      results.push_back(
+          {name, batch, iterations, stopwatch.get_ns() / ops,
+           stopwatch.get_allocs() / ops});
+      const BenchResult& result = results.back();
+      printf("%-32s %6zu %12llu %10.2f ns/op %8.3f allocs/op\n",
+             result.name.c_str(), result.batch,
+             (unsigned long long)result.iterations, result.ns_per_op,
+             result.allocs_per_op);
+      return;
+    }
+  }
+}
+
+/**
+ * @brief A single vehicle on the host backends, as on the vehicle: one
+ * learner slot with immediate updates.
+ */
+struct BenchVehicle {
+  HostLightSensor sensors;
+  HostMotorDriver motors;
+  HostLeds leds;
+  HostClock clock;
+  HostRadio radio{1};
+  LearnerStore learner{1};
+  VehicleContext ctx{sensors, motors, leds, clock, radio, learner, 0, 1};
+
+  BenchVehicle() { ctx.seed_random(1, 0); }
+
+  /**
+   * @brief Transmits everything queued and throws it away.
+   */
+  void drain_radio(void) {
+    while (ctx.m_comms_ctx.run_comms_cycle()) {
+    }
+    HostRadio::payload payload;
+    uint16_t dest;
+    while (radio.take_transmitted(payload, dest)) {
+    }
+  }
+
+  /**
+   * @brief Receives a few full payloads from another vehicle, so every state
+   * has recent reports.
+   */
+  void receive_reports(void);
+};
+
+/**
+ * @brief Fills `buffer` with a full payload from vehicle `sender_id`,
+ * reporting every state in turn as having led to darkness.
+ */
+static void make_payload(char* buffer, uint16_t sender_id, uint16_t seq) {
+  WireEncoder encoder(buffer, sender_id, seq);
+  for (int i = 0; !encoder.is_full(); ++i) {
+    CommsMsg msg = {
+        .prev_lvls = {0.8f, 0.7f},
+        .curr_lvls = {0.2f, 0.3f},
+        .prev_state = static_cast<StateEnum>(i % NUM_STATES),
+        .sender_id = sender_id,
+    };
+    encoder.add(msg);
+  }
+}
+
+void BenchVehicle::receive_reports(void) {
+  char payload[MSG_SIZE];
+  for (uint16_t seq = 0; seq < 4; ++seq) {
+    make_payload(payload, 2, seq);
+    radio.inject(payload, MSG_SIZE);
+    drain_radio();
+  }
+}
+
+static void bench_vehicle(void) {
+  run_bench("run_fsm_cycle", 1, 1, [](uint64_t n, Stopwatch& sw) {
+    BenchVehicle vehicle;
+    Pcg32 rng(2);
+    for (uint64_t i = 0; i < n; i += CHUNK) {
+      sw.start();
+      for (int j = 0; j < CHUNK && i + j < n; ++j) {
+        vehicle.clock.advance(10ms);
+        vehicle.sensors.set_levels({rng.next_float(), rng.next_float()});
+        vehicle.ctx.run_fsm_cycle();
+      }
+      sw.stop();
+      vehicle.drain_radio();
+    }
+  });
+
+  run_bench("transition_to", 1, 1, [](uint64_t n, Stopwatch& sw) {
+    BenchVehicle vehicle;
+    Pcg32 rng(3);
+    for (uint64_t i = 0; i < n; i += CHUNK) {
+      sw.start();
+      for (int j = 0; j < CHUNK && i + j < n; ++j) {
+        vehicle.ctx.transition_to(
+            static_cast<StateEnum>(rng.next() % NUM_STATES));
+      }
+      sw.stop();
+      vehicle.drain_radio();
+    }
+  });
+
+  run_bench("update_probability_table", 1, 1, [](uint64_t n, Stopwatch& sw) {
+    BenchVehicle vehicle;
+    reward_t reward = reward_from_float(0.01f);
+    sw.start();
+    for (uint64_t i = 0; i < n; ++i) {
+      vehicle.ctx.update_probability_table(i & 1 ? reward : -reward);
+    }
+    sw.stop();
+  });
+
+  run_bench("sample_next_state", 1, 1, [](uint64_t n, Stopwatch& sw) {
+    BenchVehicle vehicle;
+    uint32_t acc = 0;
+    sw.start();
+    for (uint64_t i = 0; i < n; ++i) {
+      acc += vehicle.ctx.sample_next_state();
+    }
+    sw.stop();
+    sink = acc;
+  });
+
+  // With recent reports on every state, so influence_probabilities shifts
+  // the row and it is sampled directly instead of through the alias table.
+  run_bench("sample_next_state/influenced", 1, 1,
+            [](uint64_t n, Stopwatch& sw) {
+              BenchVehicle vehicle;
+              vehicle.receive_reports();
+              uint32_t acc = 0;
+              sw.start();
+              for (uint64_t i = 0; i < n; ++i) {
+                acc += vehicle.ctx.sample_next_state();
+              }
+              sw.stop();
+              sink = acc;
+            });
+
+  // Reading the influence summary and shifting the current row, on its own
+  run_bench("influence_probabilities", 1, 1, [](uint64_t n, Stopwatch& sw) {
+    BenchVehicle vehicle;
+    vehicle.receive_reports();
+    const prob_t* row =
+        vehicle.learner.get_row(0, vehicle.ctx.get_curr_state());
+    reward_t influenced[NUM_STATES];
+    uint32_t acc = 0;
+    sw.start();
+    for (uint64_t i = 0; i < n; ++i) {
+      acc += vehicle.ctx.influence_probabilities(row, influenced);
+      acc += static_cast<uint32_t>(influenced[i % NUM_STATES]);
+    }
+    sw.stop();
+    sink = acc;
+  });
+}
+
+static void bench_learner_batches(void) {
+  for (size_t batch : BATCH_SIZES) {
+    // Every slot transitions once per pass, between random states.
+    auto setup = [batch](LearnerStore& learner) {
+      Pcg32 rng(4);
+      learner.set_deferred_updates(true);
+      for (size_t slot = 0; slot < batch; ++slot) {
+        learner.prev_state(slot) =
+            static_cast<StateEnum>(rng.next() % NUM_STATES);
+        learner.curr_state(slot) =
+            static_cast<StateEnum>(rng.next() % NUM_STATES);
+      }
+    };
+    auto submit = [batch](LearnerStore& learner, uint64_t i) {
+      reward_t reward = reward_from_float(i & 1 ? 0.001f : -0.001f);
+      for (size_t slot = 0; slot < batch; ++slot) {
+        learner.submit_update(slot, reward);
+      }
+    };
+
+    run_bench("update_probability_tables", batch, batch,
+              [&](uint64_t n, Stopwatch& sw) {
+                LearnerStore learner(batch);
+                setup(learner);
+                for (uint64_t i = 0; i < n; ++i) {
+                  submit(learner, i);
+                  sw.start();
+                  learner.update_probability_tables(0, batch);
+                  sw.stop();
+                  learner.normalize_probabilities(0, batch);
+                }
+              });
+
+    run_bench("normalize_probabilities", batch, batch,
+              [&](uint64_t n, Stopwatch& sw) {
+                LearnerStore learner(batch);
+                setup(learner);
+                for (uint64_t i = 0; i < n; ++i) {
+                  submit(learner, i);
+                  learner.update_probability_tables(0, batch);
+                  sw.start();
+                  learner.normalize_probabilities(0, batch);
+                  sw.stop();
+                }
+              });
+
+    // Rows are updated between passes, so every sample rebuilds its alias
+    // table first, as after a transition.
+    run_bench("sample_state", batch, batch, [&](uint64_t n, Stopwatch& sw) {
+      LearnerStore learner(batch);
+      setup(learner);
+      Pcg32 rng(5);
+      uint32_t acc = 0;
+      for (uint64_t i = 0; i < n; ++i) {
+        submit(learner, i);
+        learner.update_probability_tables(0, batch);
+        learner.normalize_probabilities(0, batch);
+        sw.start();
+        for (size_t slot = 0; slot < batch; ++slot) {
+#ifdef LEARNER_FIXED_POINT
+          sample_t sample = static_cast<sample_t>(rng.next() >> 16);
+#else
+          sample_t sample = rng.next_float();
+#endif
+          acc += learner.sample_state(slot, learner.prev_state(slot), sample);
+        }
+        sw.stop();
+      }
+      sink = acc;
+    });
+  }
+}
+
+static void bench_comms(void) {
+  CommsMsg msg = {
+      .prev_lvls = {0.8f, 0.7f},
+      .curr_lvls = {0.2f, 0.3f},
+      .prev_state = COWARD,
+      .sender_id = 0,
+  };
+
+  run_bench("try_queue_send", 1, 1, [&](uint64_t n, Stopwatch& sw) {
+    BenchVehicle vehicle;
+    for (uint64_t i = 0; i < n; i += CHUNK) {
+      sw.start();
+      for (int j = 0; j < CHUNK && i + j < n; ++j) {
+        vehicle.ctx.m_comms_ctx.try_queue_send(msg);
+      }
+      sw.stop();
+      vehicle.drain_radio();
+    }
+  });
+
+  // One full payload packed from outgoing mail and transmitted per cycle
+  run_bench("run_comms_cycle/tx", 1, 1, [&](uint64_t n, Stopwatch& sw) {
+    BenchVehicle vehicle;
+    CommsContext& comms = vehicle.ctx.m_comms_ctx;
+    for (uint64_t i = 0; i < n; ++i) {
+      for (int j = 0; j < WIRE_MAX_RECORDS; ++j) {
+        comms.try_queue_send(msg);
+      }
+      sw.start();
+      comms.run_comms_cycle();
+      sw.stop();
+      vehicle.drain_radio();
+    }
+  });
+
+  // One full payload received, decoded and folded into the influence
+  // summary per cycle
+  run_bench("run_comms_cycle/rx", 1, 1, [&](uint64_t n, Stopwatch& sw) {
+    BenchVehicle vehicle;
+    CommsContext& comms = vehicle.ctx.m_comms_ctx;
+    char payload[MSG_SIZE];
+    for (uint64_t i = 0; i < n; ++i) {
+      make_payload(payload, 2, static_cast<uint16_t>(i));
+      vehicle.radio.inject(payload, MSG_SIZE);
+      sw.start();
+      comms.run_comms_cycle();
+      sw.stop();
+    }
+  });
+
+  run_bench("wire_encode", 1, 1, [&](uint64_t n, Stopwatch& sw) {
+    char payload[MSG_SIZE];
+    uint32_t acc = 0;
+    sw.start();
+    for (uint64_t i = 0; i < n; ++i) {
+      WireEncoder encoder(payload, 1, static_cast<uint16_t>(i));
+      while (encoder.add(msg)) {
+      }
+      acc += static_cast<uint8_t>(payload[MSG_SIZE - 1]);
+    }
+    sw.stop();
+    sink = acc;
+  });
+
+  run_bench("wire_decode", 1, 1, [&](uint64_t n, Stopwatch& sw) {
+    char payload[MSG_SIZE];
+    make_payload(payload, 2, 0);
+    uint32_t acc = 0;
+    sw.start();
+    for (uint64_t i = 0; i < n; ++i) {
+      WireView view(payload);
+      if (!view.is_valid()) {
+        continue;
+      }
+      for (int j = 0; j < view.get_count(); ++j) {
+        acc += view.get_record(j).prev_state;
+      }
+    }
+    sw.stop();
+    sink = acc;
+  });
+}
+
+/**
+ * @returns `true` if the results were written to `path` as JSON.
+ */
+static bool write_json(const char* path) {
+  FILE* file = fopen(path, "w");
+  if (file == nullptr) {
+    return false;
+  }
+
+#ifdef LEARNER_FIXED_POINT
+  const char* fixed_point = "true";
+#else
+  const char* fixed_point = "false";
+#endif
+#ifdef LEARNER_USE_AVX2
+  const char* avx2 = "true";
+#else
+  const char* avx2 = "false";
+#endif
+  fprintf(file, "{\n");
+  fprintf(file, "  \"num_states\": %d,\n", NUM_STATES);
+  fprintf(file, "  \"fixed_point\": %s,\n", fixed_point);
+  fprintf(file, "  \"avx2\": %s,\n", avx2);
+  fprintf(file, "  \"min_time_ms\": %.0f,\n", min_time_ns / 1e6);
+  fprintf(file, "  \"results\": [\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchResult& result = results[i];
+    fprintf(file,
+            "    {\"name\": \"%s\", \"batch\": %zu, \"iterations\": %llu, "
+            "\"ns_per_op\": %.3f, \"allocs_per_op\": %.4f}%s\n",
+            result.name.c_str(), result.batch,
+            (unsigned long long)result.iterations, result.ns_per_op,
+            result.allocs_per_op, i + 1 < results.size() ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+  return fclose(file) == 0;
+}
+
+static void bench_world(void) {
+  // A 64 m x 64 m arena with a light every 16 m, as in a swarm of 1000
+  auto make_world = [](SimWorld& world) {
+    for (int i = 0; i < 4; ++i) {
+      for (int j = 0; j < 4; ++j) {
+        world.add_light({8.0f + 16.0f * i, 8.0f + 16.0f * j, 1.0f});
+      }
+    }
+  };
+  SimWorld exact(64.0f, 64.0f);
+  SimWorld baked(64.0f, 64.0f);
+  make_world(exact);
+  make_world(baked);
+  baked.bake_light_field(0.25f);
+
+  Pcg32 rng(6);
+  std::vector<SimPose> poses(4096);
+  for (SimPose& pose : poses) {
+    pose = {rng.next_float() * 64.0f, rng.next_float() * 64.0f,
+            (rng.next_float() * 2.0f - 1.0f) * static_cast<float>(M_PI)};
+  }
+  std::vector<LightLevels> levels(poses.size());
+
+  run_bench("sense/exact", 1, 1, [&](uint64_t n, Stopwatch& sw) {
+    float acc = 0.0f;
+    sw.start();
+    for (uint64_t i = 0; i < n; ++i) {
+      acc += exact.sense(poses[i % poses.size()]).lvl_left;
+    }
+    sw.stop();
+    sink = static_cast<uint32_t>(acc);
+  });
+
+  for (size_t batch : BATCH_SIZES) {
+    run_bench("sense_batch/light_field", batch, batch,
+              [&](uint64_t n, Stopwatch& sw) {
+                sw.start();
+                for (uint64_t i = 0; i < n; ++i) {
+                  baked.sense_batch(poses.data(), batch, levels.data());
+                }
+                sw.stop();
+                sink = static_cast<uint32_t>(levels[0].lvl_left);
+              });
+  }
+
+  // Shuffle one light back and forth by 10 cm
+  run_bench("move_light/light_field", 1, 1, [&](uint64_t n, Stopwatch& sw) {
+    sw.start();
+    for (uint64_t i = 0; i < n; ++i) {
+      baked.move_light(5, i & 1 ? 24.1f : 24.0f, 24.0f);
+    }
+    sw.stop();
+  });
+}
+
+int main(int argc, char** argv) {
+  if (argc > 2) {
+    min_time_ns = std::strtod(argv[2], nullptr) * 1e6;
+  }
+
+  printf("%-32s %6s %12s\n", "benchmark", "batch", "iterations");
+  bench_vehicle();
+  bench_learner_batches();
+  bench_comms();
+  bench_world();
+
+  if (argc > 1 && !write_json(argv[1])) {
+    fprintf(stderr, "Could not write %s\n", argv[1]);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,120 @@
+// Decodes a binary trace stream, as sent over the vehicle's trace UART or
+// written by vehicle_sim, into one CSV file per record type with a column per
+// field, ready to load into a dataframe.
+//
+// Usage: trace_decode <trace_file> <output_directory>
+//
+// Writes transitions.csv, rewards.csv, probs.csv, msgs_sent.csv,
+// msgs_received.csv and overflows.csv. Probabilities and rewards are written
+// as decimals whether the vehicle used floats or Q15. Records from the FSM
+// and comms threads are interleaved in chunks, so sort by time_ms if order
+// matters.
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../TraceRecorder.h"
+
+// Scale of Q15 values, as in LearnerKernels.h
+const float Q15_ONE = 32768.0f;
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "Usage: %s <trace_file> <output_directory>\n", argv[0]);
+    return 1;
+  }
+
+  FILE* in = fopen(argv[1], "rb");
+  if (in == nullptr) {
+    fprintf(stderr, "Could not open %s\n", argv[1]);
+    return 1;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t count;
+  while ((count = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+    data.insert(data.end(), chunk, chunk + count);
+  }
+  fclose(in);
+
+  std::string dir = argv[2];
+  FILE* transitions = fopen((dir + "/transitions.csv").c_str(), "w");
+  FILE* rewards = fopen((dir + "/rewards.csv").c_str(), "w");
+  FILE* probs = fopen((dir + "/probs.csv").c_str(), "w");
+  FILE* msgs_sent = fopen((dir + "/msgs_sent.csv").c_str(), "w");
+  FILE* msgs_received = fopen((dir + "/msgs_received.csv").c_str(), "w");
+  FILE* overflows = fopen((dir + "/overflows.csv").c_str(), "w");
+  if (!transitions || !rewards || !probs || !msgs_sent || !msgs_received ||
+      !overflows) {
+    fprintf(stderr, "Could not create the CSV files in %s\n", argv[2]);
+    return 1;
+  }
+  fprintf(transitions, "time_ms,from,to\n");
+  fprintf(rewards, "time_ms,state,from,reward\n");
+  fprintf(probs, "time_ms,row,col,prob\n");
+  fprintf(msgs_sent, "time_ms,state,light_delta\n");
+  fprintf(msgs_received, "time_ms,state,sender,light_delta\n");
+  fprintf(overflows, "time_ms,lost\n");
+
+  // Until a format record says otherwise, assume floats.
+  bool fixed_point = false;
+  size_t num_records = 0;
+  size_t num_skipped = 0;
+  size_t pos = 0;
+  while (pos + TRACE_FRAME_SIZE <= data.size()) {
+    TraceRecord record;
+    if (!trace_decode(&data[pos], record)) {
+      // Not a frame boundary, e.g. after bytes were lost. Resync.
+      ++pos;
+      ++num_skipped;
+      continue;
+    }
+    pos += TRACE_FRAME_SIZE;
+    ++num_records;
+
+    float number = fixed_point ? static_cast<int32_t>(record.value) / Q15_ONE
+                               : trace_float(record.value);
+    switch (record.type) {
+      case TRACE_FORMAT:
+        fixed_point = record.value != 0;
+        break;
+      case TRACE_TRANSITION:
+        fprintf(transitions, "%u,%u,%u\n", record.time_ms, record.state,
+                record.arg);
+        break;
+      case TRACE_REWARD:
+        fprintf(rewards, "%u,%u,%u,%g\n", record.time_ms, record.state,
+                record.arg, number);
+        break;
+      case TRACE_PROB:
+        fprintf(probs, "%u,%u,%u,%g\n", record.time_ms, record.state,
+                record.arg, number);
+        break;
+      case TRACE_MSG_SENT:
+        fprintf(msgs_sent, "%u,%u,%g\n", record.time_ms, record.state,
+                trace_float(record.value));
+        break;
+      case TRACE_MSG_RECEIVED:
+        fprintf(msgs_received, "%u,%u,%u,%g\n", record.time_ms, record.state,
+                record.arg, trace_float(record.value));
+        break;
+      case TRACE_OVERFLOW:
+        fprintf(overflows, "%u,%u\n", record.time_ms, record.value);
+        break;
+      default:
+        // From a newer recorder; skip it.
+        break;
+    }
+  }
+
+  fclose(transitions);
+  fclose(rewards);
+  fclose(probs);
+  fclose(msgs_sent);
+  fclose(msgs_received);
+  fclose(overflows);
+
+  printf("Decoded %zu records, skipped %zu bytes\n", num_records,
+         num_skipped + (data.size() - pos));
+  return 0;
+}